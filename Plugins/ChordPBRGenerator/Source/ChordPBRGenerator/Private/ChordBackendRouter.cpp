@@ -0,0 +1,192 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordBackendRouter.h"
+
+#include "ChordPBRGeneratorModule.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+	// Recent runs count most: a server that got busy or a model that is now resident shows up within a few jobs.
+	constexpr double LatencySmoothing = 0.3;
+	constexpr double FirstCooldownSeconds = 30.0;
+	constexpr double MaxCooldownSeconds = 600.0;
+
+	// Stand-ins until a route has run once; roughly what the bundled templates take on a single consumer GPU.
+	double GetPriorSeconds(const FChordTxt2ImgRoute& Route)
+	{
+		if (Route.bGemini)
+		{
+			return 20.0;
+		}
+		switch (Route.Quality)
+		{
+		case EChordQualityTier::Draft: return 10.0;
+		case EChordQualityTier::High: return 60.0;
+		default: return 25.0;
+		}
+	}
+}
+
+FString FChordTxt2ImgRoute::GetKey() const
+{
+	return bGemini ? TEXT("Gemini") : FString::Printf(TEXT("ComfyUI|%s"), *FPaths::GetCleanFilename(TemplatePath));
+}
+
+FChordBackendRouter& FChordBackendRouter::Get()
+{
+	static FChordBackendRouter Router;
+	return Router;
+}
+
+FChordTxt2ImgRoute FChordBackendRouter::GetDefaultComfyRoute(const UChordPBRSettings& Settings)
+{
+	FChordTxt2ImgRoute Route;
+	Route.TemplatePath = Settings.Txt2ImgApiPromptPath;
+	Route.Binding = Settings.Txt2ImgBinding;
+	return Route;
+}
+
+TArray<FChordTxt2ImgRoute> FChordBackendRouter::GetCandidates(const UChordPBRSettings& Settings, bool bAllowGemini)
+{
+	TArray<FChordTxt2ImgRoute> Candidates;
+	if (bAllowGemini && !Settings.GeminiApiKey.IsEmpty())
+	{
+		FChordTxt2ImgRoute& Gemini = Candidates.AddDefaulted_GetRef();
+		Gemini.bGemini = true;
+		Gemini.Quality = Settings.GeminiQuality;
+	}
+
+	for (const FChordTxt2ImgRouteTemplate& Template : Settings.Txt2ImgRouteTemplates)
+	{
+		if (!Template.TemplatePath.IsEmpty())
+		{
+			FChordTxt2ImgRoute& Route = Candidates.AddDefaulted_GetRef();
+			Route.TemplatePath = Template.TemplatePath;
+			Route.Binding = Template.Binding;
+			Route.Quality = Template.Quality;
+		}
+	}
+	if (Settings.Txt2ImgRouteTemplates.Num() == 0)
+	{
+		Candidates.Add(GetDefaultComfyRoute(Settings));
+	}
+	return Candidates;
+}
+
+double FChordBackendRouter::GetExpectedSeconds(const FChordTxt2ImgRoute& Route) const
+{
+	const FRouteStats* RouteStats = Stats.Find(Route.GetKey());
+	return RouteStats && RouteStats->NumSamples > 0 ? RouteStats->AverageSeconds : GetPriorSeconds(Route);
+}
+
+FChordTxt2ImgRoute FChordBackendRouter::ChooseRoute(const UChordPBRSettings& Settings, bool bAllowGemini) const
+{
+	if (Settings.Txt2ImgBackend != ETxt2ImgBackend::Auto)
+	{
+		FChordTxt2ImgRoute Route = GetDefaultComfyRoute(Settings);
+		Route.bGemini = bAllowGemini && Settings.Txt2ImgBackend == ETxt2ImgBackend::GeminiAPI;
+		return Route;
+	}
+
+	const TArray<FChordTxt2ImgRoute> Candidates = GetCandidates(Settings, bAllowGemini);
+	if (Candidates.Num() == 0)
+	{
+		return GetDefaultComfyRoute(Settings);
+	}
+
+	FScopeLock Lock(&Mutex);
+	const double Now = FPlatformTime::Seconds();
+	auto IsHealthy = [this, Now](const FChordTxt2ImgRoute& Route)
+	{
+		const FRouteStats* RouteStats = Stats.Find(Route.GetKey());
+		return !RouteStats || RouteStats->CooldownUntil <= Now;
+	};
+
+	// The quality floor gives way only when nothing at or above it is healthy.
+	TArray<const FChordTxt2ImgRoute*> Eligible;
+	for (const FChordTxt2ImgRoute& Route : Candidates)
+	{
+		if (Route.Quality >= Settings.MinRouteQuality && IsHealthy(Route))
+		{
+			Eligible.Add(&Route);
+		}
+	}
+	if (Eligible.Num() == 0)
+	{
+		for (const FChordTxt2ImgRoute& Route : Candidates)
+		{
+			if (IsHealthy(Route))
+			{
+				Eligible.Add(&Route);
+			}
+		}
+	}
+	if (Eligible.Num() == 0)
+	{
+		// Everything failed recently; the one that comes out of its cooldown first is the best bet.
+		const FChordTxt2ImgRoute* Soonest = &Candidates[0];
+		for (const FChordTxt2ImgRoute& Route : Candidates)
+		{
+			if (Stats.FindChecked(Route.GetKey()).CooldownUntil < Stats.FindChecked(Soonest->GetKey()).CooldownUntil)
+			{
+				Soonest = &Route;
+			}
+		}
+		return *Soonest;
+	}
+
+	const double Target = Settings.RouteLatencyTargetSeconds;
+	const FChordTxt2ImgRoute* Best = nullptr;
+	for (const FChordTxt2ImgRoute* Route : Eligible)
+	{
+		if (!Best)
+		{
+			Best = Route;
+			continue;
+		}
+
+		const double Seconds = GetExpectedSeconds(*Route);
+		const double BestSeconds = GetExpectedSeconds(*Best);
+		const bool bMeetsTarget = Target > 0.0 && Seconds <= Target;
+		const bool bBestMeetsTarget = Target > 0.0 && BestSeconds <= Target;
+		if (bMeetsTarget != bBestMeetsTarget)
+		{
+			Best = bMeetsTarget ? Route : Best;
+		}
+		else if (bMeetsTarget && Route->Quality != Best->Quality)
+		{
+			Best = Route->Quality > Best->Quality ? Route : Best;
+		}
+		else if (Seconds < BestSeconds)
+		{
+			Best = Route;
+		}
+	}
+
+	UE_LOG(LogChordPBRGenerator, Verbose, TEXT("Routing image generation to %s (expected %.1f s)."), *Best->GetKey(), GetExpectedSeconds(*Best));
+	return *Best;
+}
+
+void FChordBackendRouter::Record(const FString& RouteKey, bool bSucceeded, double Seconds)
+{
+	FScopeLock Lock(&Mutex);
+	FRouteStats& RouteStats = Stats.FindOrAdd(RouteKey);
+	if (!bSucceeded)
+	{
+		++RouteStats.NumFailures;
+		++RouteStats.ConsecutiveFailures;
+		const double Cooldown = FMath::Min(FirstCooldownSeconds * FMath::Pow(2.0, static_cast<double>(RouteStats.ConsecutiveFailures - 1)), MaxCooldownSeconds);
+		RouteStats.CooldownUntil = FPlatformTime::Seconds() + Cooldown;
+		UE_LOG(LogChordPBRGenerator, Log, TEXT("%s failed after %.1f s (%d in a row); skipping it for %.0f s."), *RouteKey, Seconds, RouteStats.ConsecutiveFailures, Cooldown);
+		return;
+	}
+
+	RouteStats.AverageSeconds = RouteStats.NumSamples == 0 ? Seconds : FMath::Lerp(RouteStats.AverageSeconds, Seconds, LatencySmoothing);
+	++RouteStats.NumSamples;
+	RouteStats.ConsecutiveFailures = 0;
+	RouteStats.CooldownUntil = 0.0;
+	UE_LOG(LogChordPBRGenerator, Verbose, TEXT("%s took %.1f s (average %.1f s over %d, %d failed)."), *RouteKey, Seconds, RouteStats.AverageSeconds, RouteStats.NumSamples, RouteStats.NumFailures);
+}
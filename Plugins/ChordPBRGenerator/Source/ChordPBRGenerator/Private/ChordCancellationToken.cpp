@@ -0,0 +1,70 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordCancellationToken.h"
+
+#include "Misc/ScopeLock.h"
+
+void FChordCancellationToken::Cancel()
+{
+	TArray<TFunction<void()>> ToRun;
+	{
+		FScopeLock Lock(&Mutex);
+		if (bCancelled)
+		{
+			return;
+		}
+		bCancelled = true;
+		Callbacks.GenerateValueArray(ToRun);
+		Callbacks.Reset();
+	}
+
+	// Outside the lock: callbacks may cancel HTTP requests whose completion handlers unregister themselves.
+	for (TFunction<void()>& Callback : ToRun)
+	{
+		Callback();
+	}
+}
+
+FChordCancellationToken::FCallbackHandle FChordCancellationToken::Register(TFunction<void()> Callback)
+{
+	{
+		FScopeLock Lock(&Mutex);
+		if (!bCancelled)
+		{
+			const FCallbackHandle Handle = NextHandle++;
+			Callbacks.Add(Handle, MoveTemp(Callback));
+			return Handle;
+		}
+	}
+
+	Callback();
+	return 0;
+}
+
+void FChordCancellationToken::Unregister(FCallbackHandle Handle)
+{
+	if (Handle == 0)
+	{
+		return;
+	}
+
+	FScopeLock Lock(&Mutex);
+	Callbacks.Remove(Handle);
+}
+
+FChordCancellationToken::FScopedCallback::FScopedCallback(const TSharedPtr<FChordCancellationToken, ESPMode::ThreadSafe>& InToken, TFunction<void()> Callback)
+	: Token(InToken)
+{
+	if (Token.IsValid())
+	{
+		Handle = Token->Register(MoveTemp(Callback));
+	}
+}
+
+FChordCancellationToken::FScopedCallback::~FScopedCallback()
+{
+	if (Token.IsValid())
+	{
+		Token->Unregister(Handle);
+	}
+}
@@ -0,0 +1,182 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordImageTiling.h"
+
+namespace
+{
+	void ComputeAxisPositions(int32 Extent, int32 Side, int32 Overlap, TArray<int32>& OutPositions)
+	{
+		if (Extent <= Side)
+		{
+			OutPositions.Add(0);
+			return;
+		}
+
+		// The last tile is pulled back to end on the border, so it overlaps its neighbour by more than Overlap.
+		const int32 Step = FMath::Max(1, Side - Overlap);
+		for (int32 Position = 0; ; Position += Step)
+		{
+			if (Position + Side >= Extent)
+			{
+				OutPositions.Add(Extent - Side);
+				break;
+			}
+			OutPositions.Add(Position);
+		}
+	}
+
+	// Fades towards every side that has a neighbouring tile; sides on the image border keep full weight.
+	void ComputeAxisWeights(int32 Start, int32 Side, int32 Extent, int32 Overlap, TArray<float>& OutWeights)
+	{
+		OutWeights.SetNumUninitialized(Side);
+		for (int32 Index = 0; Index < Side; ++Index)
+		{
+			float Weight = 1.0f;
+			if (Overlap > 0 && Start > 0)
+			{
+				Weight = FMath::Min(Weight, (Index + 0.5f) / Overlap);
+			}
+			if (Overlap > 0 && Start + Side < Extent)
+			{
+				Weight = FMath::Min(Weight, (Side - Index - 0.5f) / Overlap);
+			}
+			OutWeights[Index] = Weight;
+		}
+	}
+
+	FORCEINLINE VectorRegister4Float LoadTexel(const TArray64<uint8>& BGRA, int32 MapWidth, int32 X, int32 Y)
+	{
+		return VectorLoadByte4(&BGRA[(static_cast<int64>(Y) * MapWidth + X) * 4]);
+	}
+
+	VectorRegister4Float SampleBilinear(const TArray64<uint8>& BGRA, int32 MapWidth, int32 MapHeight, float U, float V)
+	{
+		U = FMath::Clamp(U, 0.0f, static_cast<float>(MapWidth - 1));
+		V = FMath::Clamp(V, 0.0f, static_cast<float>(MapHeight - 1));
+		const int32 X0 = FMath::FloorToInt(U);
+		const int32 Y0 = FMath::FloorToInt(V);
+		const int32 X1 = FMath::Min(X0 + 1, MapWidth - 1);
+		const int32 Y1 = FMath::Min(Y0 + 1, MapHeight - 1);
+		const VectorRegister4Float FracX = VectorSetFloat1(U - X0);
+		const VectorRegister4Float FracY = VectorSetFloat1(V - Y0);
+
+		const VectorRegister4Float Top00 = LoadTexel(BGRA, MapWidth, X0, Y0);
+		const VectorRegister4Float Top = VectorMultiplyAdd(VectorSubtract(LoadTexel(BGRA, MapWidth, X1, Y0), Top00), FracX, Top00);
+		const VectorRegister4Float Bottom01 = LoadTexel(BGRA, MapWidth, X0, Y1);
+		const VectorRegister4Float Bottom = VectorMultiplyAdd(VectorSubtract(LoadTexel(BGRA, MapWidth, X1, Y1), Bottom01), FracX, Bottom01);
+		return VectorMultiplyAdd(VectorSubtract(Bottom, Top), FracY, Top);
+	}
+}
+
+TArray<FChordImageTile> FChordImageTiling::ComputeTiles(int32 Width, int32 Height, int32 TileSize, int32 Overlap)
+{
+	TArray<FChordImageTile> Tiles;
+	const int32 Side = FMath::Min3(TileSize, Width, Height);
+	if (Side <= 0)
+	{
+		return Tiles;
+	}
+
+	const int32 ClampedOverlap = FMath::Clamp(Overlap, 0, Side / 2);
+	TArray<int32> Columns;
+	TArray<int32> Rows;
+	ComputeAxisPositions(Width, Side, ClampedOverlap, Columns);
+	ComputeAxisPositions(Height, Side, ClampedOverlap, Rows);
+
+	for (const int32 Y : Rows)
+	{
+		for (const int32 X : Columns)
+		{
+			FChordImageTile& Tile = Tiles.AddDefaulted_GetRef();
+			Tile.X = X;
+			Tile.Y = Y;
+			Tile.Size = Side;
+		}
+	}
+	return Tiles;
+}
+
+void FChordImageTiling::CropTile(const TArray64<uint8>& BGRA, int32 Width, const FChordImageTile& Tile, TArray<FColor>& OutPixels)
+{
+	OutPixels.SetNumUninitialized(Tile.Size * Tile.Size);
+	for (int32 Row = 0; Row < Tile.Size; ++Row)
+	{
+		const int64 SourceOffset = (static_cast<int64>(Tile.Y + Row) * Width + Tile.X) * 4;
+		FMemory::Memcpy(&OutPixels[Row * Tile.Size], &BGRA[SourceOffset], Tile.Size * sizeof(FColor));
+	}
+}
+
+FChordTileStitcher::FChordTileStitcher(int32 InWidth, int32 InHeight, int32 InOverlap)
+	: Width(InWidth)
+	, Height(InHeight)
+	, Overlap(InOverlap)
+{
+	Accumulated.SetNumZeroed(static_cast<int64>(Width) * Height * 4);
+}
+
+void FChordTileStitcher::AddTile(const FChordImageTile& Tile, const TArray64<uint8>& BGRA, int32 MapWidth, int32 MapHeight)
+{
+	if (MapWidth <= 0 || MapHeight <= 0 || BGRA.Num() < static_cast<int64>(MapWidth) * MapHeight * 4
+		|| Tile.X < 0 || Tile.Y < 0 || Tile.X + Tile.Size > Width || Tile.Y + Tile.Size > Height)
+	{
+		return;
+	}
+
+	const int32 ClampedOverlap = FMath::Clamp(Overlap, 0, Tile.Size / 2);
+	TArray<float> WeightsX;
+	TArray<float> WeightsY;
+	ComputeAxisWeights(Tile.X, Tile.Size, Width, ClampedOverlap, WeightsX);
+	ComputeAxisWeights(Tile.Y, Tile.Size, Height, ClampedOverlap, WeightsY);
+
+	const bool bSameSize = MapWidth == Tile.Size && MapHeight == Tile.Size;
+	const float ScaleX = static_cast<float>(MapWidth) / Tile.Size;
+	const float ScaleY = static_cast<float>(MapHeight) / Tile.Size;
+
+	// Alpha is replaced by 1 so the fourth lane accumulates the weight alongside the colour.
+	const VectorRegister4Float ColorMask = MakeVectorRegister(1.0f, 1.0f, 1.0f, 0.0f);
+	const VectorRegister4Float WeightLane = MakeVectorRegister(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (int32 LocalY = 0; LocalY < Tile.Size; ++LocalY)
+	{
+		float* Row = &Accumulated[(static_cast<int64>(Tile.Y + LocalY) * Width + Tile.X) * 4];
+		const float V = (LocalY + 0.5f) * ScaleY - 0.5f;
+		for (int32 LocalX = 0; LocalX < Tile.Size; ++LocalX)
+		{
+			VectorRegister4Float Texel = bSameSize
+				? LoadTexel(BGRA, MapWidth, LocalX, LocalY)
+				: SampleBilinear(BGRA, MapWidth, MapHeight, (LocalX + 0.5f) * ScaleX - 0.5f, V);
+			Texel = VectorMultiplyAdd(Texel, ColorMask, WeightLane);
+
+			float* Pixel = Row + LocalX * 4;
+			const VectorRegister4Float Weight = VectorSetFloat1(WeightsX[LocalX] * WeightsY[LocalY]);
+			VectorStore(VectorMultiplyAdd(Texel, Weight, VectorLoad(Pixel)), Pixel);
+		}
+	}
+}
+
+void FChordTileStitcher::Finish(bool bRenormalize, TArray<FColor>& OutPixels) const
+{
+	const int32 NumPixels = Width * Height;
+	OutPixels.SetNumUninitialized(NumPixels);
+
+	const VectorRegister4Float MinWeight = VectorSetFloat1(UE_SMALL_NUMBER);
+	const VectorRegister4Float ByteToUnit = VectorSetFloat1(2.0f / 255.0f);
+	const VectorRegister4Float HalfByte = VectorSetFloat1(127.5f);
+	const VectorRegister4Float MinusOne = VectorSetFloat1(-1.0f);
+	const VectorRegister4Float RoundBias = VectorSetFloat1(0.5f);
+
+	for (int32 PixelIdx = 0; PixelIdx < NumPixels; ++PixelIdx)
+	{
+		const VectorRegister4Float Sum = VectorLoad(&Accumulated[static_cast<int64>(PixelIdx) * 4]);
+		VectorRegister4Float Color = VectorDivide(Sum, VectorMax(VectorReplicate(Sum, 3), MinWeight));
+		if (bRenormalize)
+		{
+			VectorRegister4Float Normal = VectorMultiplyAdd(Color, ByteToUnit, MinusOne);
+			Normal = VectorMultiply(Normal, VectorReciprocalSqrtAccurate(VectorMax(VectorDot3(Normal, Normal), MinWeight)));
+			Color = VectorMultiplyAdd(Normal, HalfByte, HalfByte);
+		}
+
+		VectorStoreByte4(VectorAdd(Color, RoundBias), &OutPixels[PixelIdx]);
+		OutPixels[PixelIdx].A = 255;
+	}
+}
@@ -11,68 +11,256 @@
 
 namespace
 {
-	UTexture2D* CreateTextureFromRaw(const TArray64<uint8>& RawData, int32 Width, int32 Height, const FString& DebugName)
+	// The source pixels one output pixel covers along an axis, with their coverage in Weights[WeightOffset...].
+	struct FBoxFilterTap
 	{
-		if (Width <= 0 || Height <= 0 || RawData.Num() == 0)
-		{
-			return nullptr;
-		}
+		int32 First = 0;
+		int32 Count = 0;
+		int32 WeightOffset = 0;
+	};
 
-		UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
-		if (!Texture || !Texture->GetPlatformData() || Texture->GetPlatformData()->Mips.Num() == 0)
+	void ComputeBoxFilterTaps(int32 SourceExtent, int32 TargetExtent, TArray<FBoxFilterTap>& OutTaps, TArray<float>& OutWeights)
+	{
+		const double Scale = static_cast<double>(SourceExtent) / TargetExtent;
+		OutTaps.SetNum(TargetExtent);
+		OutWeights.Reset();
+		for (int32 Index = 0; Index < TargetExtent; ++Index)
 		{
-			return nullptr;
+			const double Begin = Index * Scale;
+			const double End = FMath::Min((Index + 1) * Scale, static_cast<double>(SourceExtent));
+			FBoxFilterTap& Tap = OutTaps[Index];
+			Tap.First = FMath::FloorToInt(Begin);
+			Tap.WeightOffset = OutWeights.Num();
+			for (int32 Source = Tap.First; Source < End; ++Source)
+			{
+				const double Coverage = FMath::Min(End, Source + 1.0) - FMath::Max(Begin, static_cast<double>(Source));
+				OutWeights.Add(static_cast<float>(Coverage / Scale));
+			}
+			Tap.Count = OutWeights.Num() - Tap.WeightOffset;
 		}
+	}
+}
+
+UTexture2D* FChordImageUtils::CreateTextureFromPixels(const TArray64<uint8>& BGRA, int32 Width, int32 Height, const FString& DebugName)
+{
+	if (Width <= 0 || Height <= 0 || BGRA.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if (!Texture || !Texture->GetPlatformData() || Texture->GetPlatformData()->Mips.Num() == 0)
+	{
+		return nullptr;
+	}
 
 #if WITH_EDITORONLY_DATA
-		Texture->MipGenSettings = TMGS_NoMipmaps;
+	Texture->MipGenSettings = TMGS_NoMipmaps;
 #endif
-		Texture->SRGB = true;
-		Texture->CompressionSettings = TC_HDR;
+	Texture->SRGB = true;
+	Texture->CompressionSettings = TC_HDR;
 
-		FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
-		void* Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
-		const int64 BufferSize = static_cast<int64>(Width) * static_cast<int64>(Height) * sizeof(FColor);
-		if (BufferSize <= RawData.Num())
-		{
-			FMemory::Memcpy(Data, RawData.GetData(), BufferSize);
-		}
-		Mip.BulkData.Unlock();
-		Texture->UpdateResource();
+	UpdateTexturePixels(Texture, BGRA, Width, Height);
 
-		if (!DebugName.IsEmpty())
-		{
-			Texture->Rename(*DebugName);
-		}
+	if (!DebugName.IsEmpty())
+	{
+		Texture->Rename(*DebugName);
+	}
+
+	return Texture;
+}
+
+bool FChordImageUtils::UpdateTexturePixels(UTexture2D* Texture, const TArray64<uint8>& BGRA, int32 Width, int32 Height)
+{
+	if (!Texture || !Texture->GetPlatformData() || Texture->GetPlatformData()->Mips.Num() == 0
+		|| Texture->GetSizeX() != Width || Texture->GetSizeY() != Height)
+	{
+		return false;
+	}
 
-		return Texture;
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	void* Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	const int64 BufferSize = static_cast<int64>(Width) * static_cast<int64>(Height) * sizeof(FColor);
+	if (BufferSize <= BGRA.Num())
+	{
+		FMemory::Memcpy(Data, BGRA.GetData(), BufferSize);
 	}
+	Mip.BulkData.Unlock();
+	Texture->UpdateResource();
+	return true;
 }
 
-UTexture2D* FChordImageUtils::CreateTextureFromImage(const TArray<uint8>& ImageData, const FString& DebugName)
+bool FChordImageUtils::DecodeImage(const TArray<uint8>& ImageData, TArray64<uint8>& OutBGRA, int32& OutWidth, int32& OutHeight)
 {
 	if (ImageData.Num() == 0)
 	{
-		return nullptr;
+		return false;
 	}
 
-	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
-	const TArray<EImageFormat> Formats = { EImageFormat::PNG, EImageFormat::JPEG, EImageFormat::BMP, EImageFormat::EXR };
+	IImageWrapperModule* ImageWrapperModule = IsInGameThread()
+		? &FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"))
+		: FModuleManager::GetModulePtr<IImageWrapperModule>(TEXT("ImageWrapper"));
+	if (!ImageWrapperModule)
+	{
+		return false;
+	}
 
+	const TArray<EImageFormat> Formats = { EImageFormat::PNG, EImageFormat::JPEG, EImageFormat::BMP, EImageFormat::EXR };
 	for (EImageFormat Format : Formats)
 	{
-		TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule.CreateImageWrapper(Format);
+		TSharedPtr<IImageWrapper> Wrapper = ImageWrapperModule->CreateImageWrapper(Format);
 		if (Wrapper.IsValid() && Wrapper->SetCompressed(ImageData.GetData(), ImageData.Num()))
 		{
-			TArray64<uint8> RawData;
-			if (Wrapper->GetRaw(ERGBFormat::BGRA, 8, RawData))
+			if (Wrapper->GetRaw(ERGBFormat::BGRA, 8, OutBGRA))
 			{
-				return CreateTextureFromRaw(RawData, Wrapper->GetWidth(), Wrapper->GetHeight(), DebugName);
+				OutWidth = Wrapper->GetWidth();
+				OutHeight = Wrapper->GetHeight();
+				return OutWidth > 0 && OutHeight > 0;
 			}
 		}
 	}
 
-	return nullptr;
+	return false;
+}
+
+void FChordImageUtils::DownscalePixels(const TArray64<uint8>& BGRA, int32 Width, int32 Height, int32 NewWidth, int32 NewHeight, TArray<FColor>& OutPixels)
+{
+	OutPixels.Reset();
+	if (Width <= 0 || Height <= 0 || NewWidth <= 0 || NewHeight <= 0 || BGRA.Num() < static_cast<int64>(Width) * Height * 4)
+	{
+		return;
+	}
+
+	TArray<FBoxFilterTap> TapsX;
+	TArray<FBoxFilterTap> TapsY;
+	TArray<float> WeightsX;
+	TArray<float> WeightsY;
+	ComputeBoxFilterTaps(Width, NewWidth, TapsX, WeightsX);
+	ComputeBoxFilterTaps(Height, NewHeight, TapsY, WeightsY);
+
+	// Rows are filtered horizontally once into Filtered; a row straddling two output rows is reused by the second.
+	TArray<VectorRegister4Float> Filtered;
+	TArray<VectorRegister4Float> Accumulated;
+	Filtered.SetNumUninitialized(NewWidth);
+	Accumulated.SetNumUninitialized(NewWidth);
+	int32 FilteredRow = INDEX_NONE;
+
+	OutPixels.SetNumUninitialized(NewWidth * NewHeight);
+	const VectorRegister4Float RoundBias = VectorSetFloat1(0.5f);
+	for (int32 Y = 0; Y < NewHeight; ++Y)
+	{
+		const FBoxFilterTap& TapY = TapsY[Y];
+		for (int32 X = 0; X < NewWidth; ++X)
+		{
+			Accumulated[X] = VectorZeroFloat();
+		}
+
+		for (int32 RowTap = 0; RowTap < TapY.Count; ++RowTap)
+		{
+			const int32 SourceRow = TapY.First + RowTap;
+			if (SourceRow != FilteredRow)
+			{
+				const uint8* Row = &BGRA[static_cast<int64>(SourceRow) * Width * 4];
+				for (int32 X = 0; X < NewWidth; ++X)
+				{
+					const FBoxFilterTap& TapX = TapsX[X];
+					VectorRegister4Float Sum = VectorZeroFloat();
+					for (int32 ColumnTap = 0; ColumnTap < TapX.Count; ++ColumnTap)
+					{
+						Sum = VectorMultiplyAdd(VectorLoadByte4(Row + (TapX.First + ColumnTap) * 4), VectorSetFloat1(WeightsX[TapX.WeightOffset + ColumnTap]), Sum);
+					}
+					Filtered[X] = Sum;
+				}
+				FilteredRow = SourceRow;
+			}
+
+			const VectorRegister4Float WeightY = VectorSetFloat1(WeightsY[TapY.WeightOffset + RowTap]);
+			for (int32 X = 0; X < NewWidth; ++X)
+			{
+				Accumulated[X] = VectorMultiplyAdd(Filtered[X], WeightY, Accumulated[X]);
+			}
+		}
+
+		FColor* OutRow = &OutPixels[Y * NewWidth];
+		for (int32 X = 0; X < NewWidth; ++X)
+		{
+			VectorStoreByte4(VectorAdd(Accumulated[X], RoundBias), &OutRow[X]);
+		}
+	}
+}
+
+bool FChordImageUtils::DownscaleImageToFit(const TArray<uint8>& ImageData, int32 MaxSide, TArray<uint8>& OutPngData, FString& OutError)
+{
+	OutPngData.Reset();
+	int32 Width = 0;
+	int32 Height = 0;
+	if (MaxSide <= 0)
+	{
+		return true;
+	}
+	if (!GetImageSize(ImageData, Width, Height))
+	{
+		OutError = TEXT("Unreadable image.");
+		return false;
+	}
+	if (Width <= MaxSide && Height <= MaxSide)
+	{
+		return true;
+	}
+
+	TArray64<uint8> BGRA;
+	if (!DecodeImage(ImageData, BGRA, Width, Height))
+	{
+		OutError = TEXT("Failed to decode image.");
+		return false;
+	}
+
+	const double Scale = static_cast<double>(MaxSide) / FMath::Max(Width, Height);
+	const int32 NewWidth = FMath::Clamp(FMath::RoundToInt(Width * Scale), 1, MaxSide);
+	const int32 NewHeight = FMath::Clamp(FMath::RoundToInt(Height * Scale), 1, MaxSide);
+	TArray<FColor> Pixels;
+	DownscalePixels(BGRA, Width, Height, NewWidth, NewHeight, Pixels);
+	return EncodePixelsToPng(Pixels, NewWidth, NewHeight, OutPngData, OutError);
+}
+
+bool FChordImageUtils::GetImageSize(const TArray<uint8>& ImageData, int32& OutWidth, int32& OutHeight)
+{
+	if (ImageData.Num() == 0)
+	{
+		return false;
+	}
+
+	IImageWrapperModule* ImageWrapperModule = IsInGameThread()
+		? &FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"))
+		: FModuleManager::GetModulePtr<IImageWrapperModule>(TEXT("ImageWrapper"));
+	if (!ImageWrapperModule)
+	{
+		return false;
+	}
+
+	const EImageFormat Format = ImageWrapperModule->DetectImageFormat(ImageData.GetData(), ImageData.Num());
+	TSharedPtr<IImageWrapper> Wrapper = Format != EImageFormat::Invalid ? ImageWrapperModule->CreateImageWrapper(Format) : nullptr;
+	if (!Wrapper.IsValid() || !Wrapper->SetCompressed(ImageData.GetData(), ImageData.Num()))
+	{
+		return false;
+	}
+
+	OutWidth = Wrapper->GetWidth();
+	OutHeight = Wrapper->GetHeight();
+	return OutWidth > 0 && OutHeight > 0;
+}
+
+UTexture2D* FChordImageUtils::CreateTextureFromImage(const TArray<uint8>& ImageData, const FString& DebugName)
+{
+	TArray64<uint8> RawData;
+	int32 Width = 0;
+	int32 Height = 0;
+	if (!DecodeImage(ImageData, RawData, Width, Height))
+	{
+		return nullptr;
+	}
+
+	return CreateTextureFromPixels(RawData, Width, Height, DebugName);
 }
 
 bool FChordImageUtils::EncodeTextureToPng(UTexture2D* Texture, TArray<uint8>& OutPngData, FString& OutError)
@@ -93,15 +281,26 @@ bool FChordImageUtils::EncodeTextureToPng(UTexture2D* Texture, TArray<uint8>& Ou
 	FMemory::Memcpy(SrcData.GetData(), Data, SrcData.Num() * sizeof(FColor));
 	Mip.BulkData.Unlock();
 
+	return EncodePixelsToPng(SrcData, Width, Height, OutPngData, OutError);
+}
+
+bool FChordImageUtils::EncodePixelsToPng(const TArray<FColor>& Pixels, int32 Width, int32 Height, TArray<uint8>& OutPngData, FString& OutError)
+{
+	if (Width <= 0 || Height <= 0 || Pixels.Num() != Width * Height)
+	{
+		OutError = TEXT("Invalid pixel buffer.");
+		return false;
+	}
+
 #if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 5
 	// UE 5.5+ requires TArray64 for output and uses PNGCompressImageArray
 	TArray64<uint8> TempPngData;
-	FImageUtils::PNGCompressImageArray(Width, Height, SrcData, TempPngData);
+	FImageUtils::PNGCompressImageArray(Width, Height, Pixels, TempPngData);
 	OutPngData.Empty(TempPngData.Num());
 	OutPngData.Append(TempPngData.GetData(), TempPngData.Num());
 #else
 	// UE 5.4 and earlier uses CompressImageArray with regular TArray
-	FImageUtils::CompressImageArray(Width, Height, SrcData, OutPngData);
+	FImageUtils::CompressImageArray(Width, Height, Pixels, OutPngData);
 #endif
 	if (OutPngData.Num() == 0)
 	{
@@ -0,0 +1,1327 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordJob.h"
+
+#include "Async/Async.h"
+#include "ChordBackendRouter.h"
+#include "ChordImageTiling.h"
+#include "ChordImageUtils.h"
+#include "ChordJobJournal.h"
+#include "ChordJobScheduler.h"
+#include "ChordPBRGeneratorModule.h"
+#include "ChordPBRSettings.h"
+#include "ComfyServerPool.h"
+#include "ComfyWorkflowUtils.h"
+#include "GeminiApiClient.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/Package.h"
+
+namespace
+{
+	const TCHAR* const PBRChannelNames[] = { TEXT("BaseColor"), TEXT("Normal"), TEXT("Roughness"), TEXT("Metallic"), TEXT("Height") };
+
+	struct FDownloadedImage
+	{
+		// Index into PBRChannelNames for a PBR map.
+		int32 Channel = INDEX_NONE;
+		FString Name;
+		TArray<uint8> Data;
+		FString FilePath;
+	};
+
+	/** Working state shared by the stages of one ComfyUI job. Each stage runs after the previous one finished. */
+	struct FComfyJobContext
+	{
+		TSharedPtr<FComfyUIClient> Client;
+		TSharedPtr<FComfyOutputPrefetcher> Prefetcher;
+		FComfyImageReference Uploaded;
+		// Uploaded was copied from a pre-upload rather than sent by this job; the server may have lost it since.
+		bool bUploadedEarlier = false;
+		TSharedPtr<FJsonObject> History;
+		FComfyPromptResponse Response;
+		int32 Seed = -1;
+		// TextToImage: the template and bindings of the route the job was built for, and whether CHORD rides along.
+		FString Txt2ImgTemplate;
+		FComfyTxt2ImgBinding Txt2ImgBinding;
+		bool bFused = false;
+		// Start of the current attempt, for the router's latency statistics.
+		double RouteStart = 0.0;
+		// Set once Gemini delivered the image; after a Gemini failure the ComfyUI fallback stages run instead.
+		bool bGeminiSucceeded = false;
+		// The source scaled down to ChordInputResolution; empty while the original fits or is not resized yet.
+		TArray<uint8> ResizedSourcePng;
+		// Names of the generated images (txt2img; the pixels go straight to the job) and PBR maps in PBRChannelNames order.
+		TArray<FDownloadedImage> Downloaded;
+		TArray<FDownloadedImage> DownloadedMaps;
+
+		// ImageToPBRBatch: one entry per request image, in branch order.
+		TArray<FComfyImageReference> BatchUploaded;
+		TArray<TArray<FDownloadedImage>> BatchMaps;
+		TArray<FName> BatchLabels;
+		int32 BatchStride = 0;
+
+		// Tiled ImageToPBR: the source cut into tiles, which then run like a batch, and per tile the raw maps in
+		// PBRChannelNames order.
+		TArray<FChordJobBatchImage> Tiles;
+		TArray<FChordImageTile> TileLayout;
+		int32 SourceWidth = 0;
+		int32 SourceHeight = 0;
+		TArray<TArray<TArray<uint8>>> TileMaps;
+
+		FCriticalSection StreamedMutex;
+		TMap<FString, TArray<uint8>> Streamed;
+	};
+
+	using FComfyJobContextRef = TSharedRef<FComfyJobContext, ESPMode::ThreadSafe>;
+
+	void ConfigurePBRTexture(UTexture2D* Texture, const FString& Channel)
+	{
+		if (!Texture)
+		{
+			return;
+		}
+
+		if (Channel == TEXT("Normal"))
+		{
+			Texture->SRGB = false;
+			Texture->CompressionSettings = TC_Normalmap;
+		}
+		else if (Channel == TEXT("BaseColor"))
+		{
+			Texture->SRGB = true;
+			Texture->CompressionSettings = TC_Default;
+		}
+		else if (Channel == TEXT("Height"))
+		{
+			Texture->SRGB = false;
+			Texture->CompressionSettings = TC_Grayscale;
+		}
+		else
+		{
+			Texture->SRGB = false;
+			Texture->CompressionSettings = TC_Masks;
+		}
+
+		Texture->PostEditChange();
+		Texture->UpdateResource();
+	}
+
+	UTexture2D* CreateNamedTexture(const TArray<uint8>& Data, const FString& Name)
+	{
+		UTexture2D* Texture = FChordImageUtils::CreateTextureFromImage(Data, Name);
+		if (Texture)
+		{
+			const FName UniqueName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *Name);
+			Texture->Rename(*UniqueName.ToString());
+		}
+		return Texture;
+	}
+
+	// Decodes a generated image on the calling thread, then adds it to the job's outputs on the game thread and tells
+	// listeners right away. Game-thread tasks run in order, so every image lands before the job's next stage.
+	void DeliverGeneratedImage(const FChordJobRef& Job, int32 Seed, bool bFusedMaps, FDownloadedImage&& Item)
+	{
+		TArray64<uint8> Pixels;
+		int32 Width = 0;
+		int32 Height = 0;
+		const bool bDecoded = FChordImageUtils::DecodeImage(Item.Data, Pixels, Width, Height);
+		if (bDecoded)
+		{
+			Item.Data.Empty();
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Job, Seed, bFusedMaps, Item = MoveTemp(Item), Pixels = MoveTemp(Pixels), Width, Height, bDecoded]()
+		{
+			if (Job->IsCancelled())
+			{
+				return;
+			}
+
+			// Without the ImageWrapper module the thread pool cannot decode; the game thread loads it.
+			UTexture2D* Texture = bDecoded ? FChordImageUtils::CreateTextureFromPixels(Pixels, Width, Height, FString()) : FChordImageUtils::CreateTextureFromImage(Item.Data, FString());
+			if (!Texture)
+			{
+				UE_LOG(LogChordPBRGenerator, Warning, TEXT("Failed to decode %s."), *Item.Name);
+				return;
+			}
+			Texture->Rename(*MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *Item.Name).ToString());
+
+			FChordJobImageOutput& Output = Job->OutputImages.AddDefaulted_GetRef();
+			Output.Label = Item.Name;
+			Output.Texture = TStrongObjectPtr<UTexture2D>(Texture);
+			Output.Seed = Seed;
+			Output.bFusedMaps = bFusedMaps;
+			FChordJobScheduler::Get().NotifyImageReady(Job, Job->OutputImages.Num() - 1);
+		});
+	}
+
+	// Channels == nullptr takes the maps streamed over the socket. Also writes each map to the PBR cache.
+	bool DownloadPBRMaps(FChordJob& Job, FComfyJobContext& Context, const TMap<FString, FComfyImageReference>* Channels, const FString& SourceLabel, TArray<FDownloadedImage>& OutMaps, FName& OutLabel, FString& OutError)
+	{
+		const UChordPBRSettings& Settings = Job.GetSettings();
+		FString Error;
+		Job.SetStatus(TEXT("Downloading PBR maps..."));
+		const FString SafeLabel = FPaths::MakeValidFileName(SourceLabel.IsEmpty() ? Context.Response.PromptId : SourceLabel);
+		const FString CacheDir = FPaths::Combine(Settings.SavedCacheRoot, TEXT("PBR"), SafeLabel);
+		for (int32 ChannelIdx = 0; ChannelIdx < static_cast<int32>(UE_ARRAY_COUNT(PBRChannelNames)); ++ChannelIdx)
+		{
+			const TCHAR* ChannelName = PBRChannelNames[ChannelIdx];
+			if (!Settings.ChordOutputChannels.IsEnabled(ChannelName))
+			{
+				continue;
+			}
+			if (Job.IsCancelled())
+			{
+				OutError = TEXT("Cancelled.");
+				return false;
+			}
+
+			FDownloadedImage Item;
+			Item.Channel = ChannelIdx;
+			FString SourceFileName = Context.Response.PromptId;
+			if (!Channels)
+			{
+				FScopeLock Lock(&Context.StreamedMutex);
+				TArray<uint8>* StreamedData = Context.Streamed.Find(ChannelName);
+				if (!StreamedData)
+				{
+					OutError = FString::Printf(TEXT("Download PBR maps: Missing streamed channel %s."), ChannelName);
+					return false;
+				}
+				Item.Data = MoveTemp(*StreamedData);
+			}
+			else
+			{
+				const FComfyImageReference* Ref = Channels->Find(ChannelName);
+				if (!Ref)
+				{
+					OutError = FString::Printf(TEXT("Download PBR maps: Missing channel %s."), ChannelName);
+					return false;
+				}
+				if (!Context.Prefetcher->Fetch(*Ref, Item.Data, Error))
+				{
+					OutError = FString::Printf(TEXT("Download PBR maps: %s"), *Error);
+					return false;
+				}
+				SourceFileName = Ref->Filename;
+			}
+
+			const FString BaseName = !SourceLabel.IsEmpty() ? SourceLabel : FPaths::GetBaseFilename(SourceFileName);
+			const FString SafeBaseName = FPaths::MakeValidFileName(BaseName);
+			Item.Name = FString::Printf(TEXT("%s_%s"), *SafeBaseName, ChannelName);
+
+			IFileManager::Get().MakeDirectory(*CacheDir, true);
+			const FString TargetPath = FPaths::Combine(CacheDir, FString::Printf(TEXT("PBR_%s_%s.png"), *SafeBaseName, ChannelName));
+			if (FFileHelper::SaveArrayToFile(Item.Data, *TargetPath))
+			{
+				Item.FilePath = TargetPath;
+			}
+			OutMaps.Add(MoveTemp(Item));
+		}
+
+		OutLabel = *FString::Printf(TEXT("PBR_%s"), *SafeLabel);
+		return true;
+	}
+
+	// Game thread. Fills MapSet from downloaded maps; channels that were not generated stay empty.
+	void CreatePBRTextures(FChordPBRMapSet& MapSet, const TArray<FDownloadedImage>& Maps)
+	{
+		struct FChannelSlot
+		{
+			TStrongObjectPtr<UTexture2D>* Texture;
+			FString* Path;
+		};
+		FChannelSlot Slots[] =
+		{
+			{ &MapSet.BaseColor, &MapSet.BaseColorPath },
+			{ &MapSet.Normal, &MapSet.NormalPath },
+			{ &MapSet.Roughness, &MapSet.RoughnessPath },
+			{ &MapSet.Metallic, &MapSet.MetallicPath },
+			{ &MapSet.Height, &MapSet.HeightPath }
+		};
+		static_assert(UE_ARRAY_COUNT(Slots) == UE_ARRAY_COUNT(PBRChannelNames), "One slot per PBR channel.");
+
+		for (const FDownloadedImage& Item : Maps)
+		{
+			if (Item.Channel < 0 || Item.Channel >= static_cast<int32>(UE_ARRAY_COUNT(Slots)))
+			{
+				continue;
+			}
+			if (UTexture2D* Texture = CreateNamedTexture(Item.Data, Item.Name))
+			{
+				ConfigurePBRTexture(Texture, PBRChannelNames[Item.Channel]);
+				Slots[Item.Channel].Texture->Reset(Texture);
+				*Slots[Item.Channel].Path = Item.FilePath;
+			}
+		}
+	}
+
+	FChordJobStage MakeSelectServerStage(const FComfyJobContextRef& Context, const FString& TemplateKey)
+	{
+		FChordJobStage Stage;
+		Stage.Name = TEXT("Select server");
+		Stage.Run = [Context, TemplateKey](FChordJob& Job, FString& OutError)
+		{
+			// Built here rather than at submission so the job timeout only counts time actually spent running.
+			const TSharedRef<FComfyUIClient> DefaultClient = MakeShared<FComfyUIClient>(Job.GetSettings(), Job.GetCancellationToken());
+			DefaultClient->SetJobPriority(Job.GetRequest().Priority);
+			DefaultClient->SetPromotionSignal(Job.GetPromotionSignal());
+
+			FString Error;
+			Context->Client = FComfyServerPool::Get().AcquireClient(DefaultClient, Job.GetSettings(), TemplateKey, Error);
+			if (!Context->Client.IsValid())
+			{
+				OutError = FString::Printf(TEXT("Select server: %s"), *Error);
+				return false;
+			}
+
+			// Start each download the moment its output node finishes instead of after the whole graph.
+			Context->Prefetcher = MakeShared<FComfyOutputPrefetcher>(Context->Client.ToSharedRef());
+			return true;
+		};
+		return Stage;
+	}
+
+	bool QueueAndWait(FChordJob& Job, FComfyJobContext& Context, const TSharedPtr<FJsonObject>& Prompt, const FString& TemplateKey, const TCHAR* What, FComfyExecutionCallbacks Callbacks, FString& OutError)
+	{
+		const TSharedRef<FComfyUIClient> Client = Context.Client.ToSharedRef();
+		const TSharedRef<FComfyOutputPrefetcher> Prefetcher = Context.Prefetcher.ToSharedRef();
+		const FString WhatLabel = What;
+
+		Callbacks.OnProgress = [&Job, WhatLabel](float Progress)
+		{
+			Job.SetStatus(FString::Printf(TEXT("Generating %s... %d%%"), *WhatLabel, FMath::RoundToInt(Progress * 100.0f)));
+		};
+		Callbacks.OnOutputImages = [Prefetcher](const FString& NodeId, const TArray<FComfyImageReference>& OutputImages)
+		{
+			Prefetcher->Prefetch(OutputImages);
+		};
+		Callbacks.OnQueued = [&Job, Client, TemplateKey, WhatLabel, bFused = Context.bFused](const FComfyPromptResponse& Queued)
+		{
+			FComfyServerPool::Get().NoteTemplateQueued(Client->GetBaseUrl(), TemplateKey);
+			FChordJobJournal::Get().Record(Job, Client->GetBaseUrl(), Queued, TemplateKey, bFused);
+			Job.NoteQueuedPrompt(Client, Queued);
+			Job.SetStatus(FString::Printf(TEXT("Queued %s prompt %s. Waiting for outputs..."), *WhatLabel, *Queued.PromptId));
+		};
+
+		FString Error;
+		const bool bCompleted = Client->QueuePromptAndWait(Prompt, Context.Response, Context.History, Error, Callbacks);
+		Job.ClearQueuedPrompt();
+		if (!bCompleted)
+		{
+			const FString Stage = Context.Response.PromptId.IsEmpty() ? TEXT("Queue prompt failed") : FString::Printf(TEXT("Wait for prompt %s"), *Context.Response.PromptId);
+			OutError = FString::Printf(TEXT("%s: %s"), *Stage, *Error);
+			return false;
+		}
+		return true;
+	}
+
+	FChordJobStage MakeReattachStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Stage;
+		Stage.Name = TEXT("Reattach");
+		Stage.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const FChordJobReattach& Reattach = Job.GetRequest().Reattach;
+			const TSharedRef<FComfyUIClient> Client = MakeShared<FComfyUIClient>(Job.GetSettings(), Job.GetCancellationToken())->WithBaseUrl(Reattach.ServerUrl);
+			Context->Client = Client;
+			Context->Prefetcher = MakeShared<FComfyOutputPrefetcher>(Client);
+			Context->Response.PromptId = Reattach.PromptId;
+			Context->Response.ClientId = Reattach.ClientId;
+			Job.NoteQueuedPrompt(Client, Context->Response);
+			Job.SetStatus(FString::Printf(TEXT("Reattaching to prompt %s from an earlier session..."), *Reattach.PromptId));
+
+			FComfyExecutionCallbacks Callbacks;
+			Callbacks.OnProgress = [&Job](float Progress)
+			{
+				Job.SetStatus(FString::Printf(TEXT("Finishing earlier prompt... %d%%"), FMath::RoundToInt(Progress * 100.0f)));
+			};
+
+			FString Error;
+			const bool bCompleted = Client->ReattachToPrompt(Reattach.PromptId, Reattach.ClientId, Context->History, Error, Callbacks);
+			Job.ClearQueuedPrompt();
+			if (!bCompleted)
+			{
+				OutError = FString::Printf(TEXT("Reattach to prompt %s: %s"), *Reattach.PromptId, *Error);
+				return false;
+			}
+			return true;
+		};
+		return Stage;
+	}
+
+	FChordJobStage MakeTextToImageExecuteStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Execute;
+		Execute.Name = TEXT("Execute");
+		Execute.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			const FChordJobRequest& Request = Job.GetRequest();
+			static TAtomic<uint32> SeedCounter{ 0 };
+			const int32 Seed = Request.Seed >= 0 ? Request.Seed : static_cast<int32>((FPlatformTime::Cycles64() + SeedCounter++) & static_cast<uint64>(INT32_MAX));
+			Context->Seed = Seed;
+			Job.SetStatus(FString::Printf(TEXT("Submitting %s prompt (seed %d)..."), Request.bDraft ? TEXT("draft") : TEXT("image"), Seed));
+
+			// Drafts are never fused: nobody wants maps for an image that is most likely thrown away.
+			TSharedPtr<FJsonObject> Prompt;
+			bool bPatched = false;
+			if (Request.bDraft)
+			{
+				bPatched = FComfyWorkflowUtils::PatchTxt2ImgDraftPrompt(Settings, Request.Prompt, Seed, Request.Label, Prompt, OutError);
+			}
+			else if (Context->bFused)
+			{
+				bPatched = FComfyWorkflowUtils::BuildFusedTxt2ImgChordPrompt(Settings, Request.Prompt, Seed, Request.Label, Prompt, OutError);
+			}
+			else
+			{
+				bPatched = FComfyWorkflowUtils::PatchTxt2ImgTemplate(Context->Txt2ImgTemplate, Context->Txt2ImgBinding, Request.Prompt, Seed, Request.Label, Prompt, OutError);
+			}
+			if (!bPatched)
+			{
+				return false;
+			}
+			// A kept draft renders only its own image, sampled with the noise it had in the draft's batch.
+			const int32 BatchSize = Request.bKeptDraft ? Request.DraftBatchSize : Settings.Txt2ImgBatchSize;
+			if (BatchSize > 0 && !FComfyWorkflowUtils::SetTxt2ImgBatchSize(Prompt, BatchSize))
+			{
+				UE_LOG(LogChordPBRGenerator, Warning, TEXT("The image template has no latent batch_size input; generating its default batch."));
+			}
+			if (Request.bKeptDraft && !FComfyWorkflowUtils::SelectTxt2ImgBatchImage(Prompt, Request.DraftBatchIndex))
+			{
+				UE_LOG(LogChordPBRGenerator, Warning, TEXT("The image template has no empty latent to pick from; rendering the draft's whole batch."));
+			}
+
+			FComfyExecutionCallbacks Callbacks;
+			if (Settings.bShowLivePreviews)
+			{
+				const FChordJobRef JobRef = Job.AsShared();
+				Callbacks.OnBinaryImage = [JobRef](const FString& NodeId, const TArray<uint8>& ImageData)
+				{
+					FChordJobScheduler::Get().NotifyPreviewFrame(JobRef, ImageData);
+				};
+			}
+			return QueueAndWait(Job, *Context, Prompt, Context->Txt2ImgTemplate, Request.bDraft ? TEXT("draft") : TEXT("image"), MoveTemp(Callbacks), OutError);
+		};
+		return Execute;
+	}
+
+	// CHORD resizes its input anyway; scaling on the client first keeps big scans off the wire and out of the
+	// server's decoder. Any failure just uploads the original.
+	const TArray<uint8>& GetUploadSource(const FChordJob& Job, const TArray<uint8>& SourcePng, TArray<uint8>& ResizedPng)
+	{
+		FString Error;
+		if (ResizedPng.Num() == 0 && !FChordImageUtils::DownscaleImageToFit(SourcePng, Job.GetSettings().ChordInputResolution, ResizedPng, Error))
+		{
+			UE_LOG(LogChordPBRGenerator, Verbose, TEXT("Uploading %s at full size: %s"), *Job.GetRequest().Label, *Error);
+		}
+		return ResizedPng.Num() > 0 ? ResizedPng : SourcePng;
+	}
+
+	bool UploadSourceImage(FChordJob& Job, FComfyJobContext& Context, FString& OutError)
+	{
+		Job.SetStatus(TEXT("Uploading source image..."));
+		FString Error;
+		const TArray<uint8>& SourcePng = GetUploadSource(Job, Job.GetRequest().SourcePng, Context.ResizedSourcePng);
+		if (!Context.Client->UploadImage(SourcePng, Context.Uploaded, Error))
+		{
+			OutError = FString::Printf(TEXT("Upload failed: %s"), *Error);
+			return false;
+		}
+		Context.bUploadedEarlier = false;
+		return true;
+	}
+
+	// The server refused the prompt because a LoadImage input names a file it does not have, so the pre-uploaded
+	// copy is gone (restart, cleaned input folder) and sending the image again can help.
+	bool IsSourceImageRejected(const FComfyPromptResponse& Response)
+	{
+		return Response.NodeErrors.ContainsByPredicate([](const FComfyPromptNodeError& Error)
+		{
+			return Error.ClassType == TEXT("LoadImage") && (Error.InputName.IsEmpty() || Error.InputName == TEXT("image"));
+		});
+	}
+
+	FChordJobStage MakePBRUploadStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Upload;
+		Upload.Name = TEXT("Upload");
+		Upload.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			// The tab uploads new images while idle; reuse that copy if it went to the server this job landed on and
+			// holds exactly the bytes this job would send. Upload names are content hashes, so the name tells.
+			const FComfyImageReference* PreUploaded = Job.GetRequest().PreUploadedSources.Find(Context->Client->GetBaseUrl());
+			if (PreUploaded && PreUploaded->Filename == FComfyUIClient::GetUploadName(GetUploadSource(Job, Job.GetRequest().SourcePng, Context->ResizedSourcePng)))
+			{
+				Context->Uploaded = *PreUploaded;
+				Context->bUploadedEarlier = true;
+				return true;
+			}
+			return UploadSourceImage(Job, *Context, OutError);
+		};
+		return Upload;
+	}
+
+	FChordJobStage MakePBRExecuteStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Execute;
+		Execute.Name = TEXT("Execute");
+		Execute.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			auto PatchPrompt = [&Settings, &Context](TSharedPtr<FJsonObject>& OutPrompt, FString& OutPatchError)
+			{
+				FString Error;
+				if (!FComfyWorkflowUtils::PatchChordPrompt(Settings, Context->Uploaded, OutPrompt, Error))
+				{
+					OutPatchError = FString::Printf(TEXT("Template error: %s"), *Error);
+					return false;
+				}
+				return true;
+			};
+
+			TSharedPtr<FJsonObject> Prompt;
+			if (!PatchPrompt(Prompt, OutError))
+			{
+				return false;
+			}
+
+			FComfyExecutionCallbacks Callbacks;
+			if (Settings.bStreamChordOutputsOverWebSocket)
+			{
+				const UChordPBRSettings* SettingsPtr = &Settings;
+				Callbacks.OnBinaryImage = [Context, SettingsPtr](const FString& NodeId, const TArray<uint8>& ImageData)
+				{
+					FString ChannelName;
+					if (FComfyWorkflowUtils::ResolvePBRChannelForNode(*SettingsPtr, NodeId, ChannelName))
+					{
+						FScopeLock Lock(&Context->StreamedMutex);
+						Context->Streamed.Add(ChannelName, ImageData);
+					}
+				};
+				Callbacks.bBinaryImagesRequired = true;
+			}
+
+			const bool bCompleted = QueueAndWait(Job, *Context, Prompt, Settings.ChordImg2PbrApiPromptPath, TEXT("PBR"), Callbacks, OutError);
+			if (bCompleted || !Context->bUploadedEarlier || !IsSourceImageRejected(Context->Response) || Job.IsCancelled())
+			{
+				return bCompleted;
+			}
+
+			// The server no longer has the pre-uploaded file. Send the image again and retry once.
+			UE_LOG(LogChordPBRGenerator, Log, TEXT("Pre-uploaded source %s was rejected (%s); uploading it again."), *Context->Uploaded.Filename, *OutError);
+			if (!UploadSourceImage(Job, *Context, OutError) || !PatchPrompt(Prompt, OutError))
+			{
+				return false;
+			}
+			return QueueAndWait(Job, *Context, Prompt, Settings.ChordImg2PbrApiPromptPath, TEXT("PBR"), MoveTemp(Callbacks), OutError);
+		};
+		return Execute;
+	}
+
+	// Times the stages from the first one's start to the last one's end and reports the outcome to the router.
+	// Cancelled attempts say nothing about the route. A fused prompt also runs CHORD, so only its failures count.
+	void RecordRouteOutcome(TArray<FChordJobStage>& Stages, const FComfyJobContextRef& Context, const FString& RouteKey)
+	{
+		for (int32 StageIdx = 0; StageIdx < Stages.Num(); ++StageIdx)
+		{
+			const bool bFirst = StageIdx == 0;
+			const bool bLast = StageIdx == Stages.Num() - 1;
+			Stages[StageIdx].Run = [Context, RouteKey, bFirst, bLast, Run = MoveTemp(Stages[StageIdx].Run)](FChordJob& Job, FString& OutError)
+			{
+				if (bFirst)
+				{
+					Context->RouteStart = FPlatformTime::Seconds();
+				}
+				const bool bSucceeded = Run(Job, OutError);
+				if (!Job.IsCancelled() && (!bSucceeded || (bLast && !Context->bFused)))
+				{
+					FChordBackendRouter::Get().Record(RouteKey, bSucceeded, FPlatformTime::Seconds() - Context->RouteStart);
+				}
+				return bSucceeded;
+			};
+		}
+	}
+
+	TArray<FChordJobStage> BuildComfyTextToImageStages(const FChordJob& Job, const FComfyJobContextRef& Context, const FChordTxt2ImgRoute& Route)
+	{
+		const UChordPBRSettings& Settings = Job.GetSettings();
+		const FChordJobRequest& Request = Job.GetRequest();
+		const bool bDraftTemplate = Request.bDraft && !Settings.DraftTxt2ImgApiPromptPath.IsEmpty();
+		Context->Txt2ImgTemplate = bDraftTemplate ? Settings.DraftTxt2ImgApiPromptPath : Route.TemplatePath;
+		Context->Txt2ImgBinding = bDraftTemplate ? Settings.DraftTxt2ImgBinding : Route.Binding;
+		// The fused prompt is built around the regular image template; other routes stay image-only. A resumed prompt
+		// is read back the way it was built, whatever the settings say now.
+		Context->bFused = Request.Reattach.IsSet() && !Request.Reattach.TemplatePath.IsEmpty()
+			? Request.Reattach.bFused
+			: Settings.bFuseChordIntoTxt2Img && !Request.bDraft && Route.TemplatePath == Settings.Txt2ImgApiPromptPath;
+
+		TArray<FChordJobStage> Stages;
+		if (Request.Reattach.IsSet())
+		{
+			Stages.Add(MakeReattachStage(Context));
+		}
+		else
+		{
+			Stages.Add(MakeSelectServerStage(Context, Context->Txt2ImgTemplate));
+			Stages.Add(MakeTextToImageExecuteStage(Context));
+		}
+
+		FChordJobStage& Download = Stages.AddDefaulted_GetRef();
+		Download.Name = TEXT("Download");
+		Download.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			FString Error;
+			FComfyFusedPromptLayout FusedLayout;
+			if (Context->bFused && !FComfyWorkflowUtils::GetFusedPromptLayout(Settings, FusedLayout, Error))
+			{
+				OutError = FString::Printf(TEXT("Fused template: %s"), *Error);
+				return false;
+			}
+
+			// In a fused prompt only the txt2img SaveImage node holds generated images; the rest are PBR maps.
+			TArray<FComfyImageReference> Images;
+			if (!FComfyWorkflowUtils::ExtractImagesFromHistory(Settings, Context->History, Images, Error, FusedLayout.ImageNodeKey))
+			{
+				OutError = FString::Printf(TEXT("Parse outputs: %s"), *Error);
+				return false;
+			}
+
+			// Each image goes to the gallery as soon as it is in, not after the whole batch.
+			const FString& BaseLabel = Job.GetRequest().Label;
+			for (int32 ImageIdx = 0; ImageIdx < Images.Num() && !Job.IsCancelled(); ++ImageIdx)
+			{
+				Job.SetStatus(FString::Printf(TEXT("Downloading image %d of %d..."), ImageIdx + 1, Images.Num()));
+				FDownloadedImage Item;
+				if (Context->Prefetcher->Fetch(Images[ImageIdx], Item.Data, Error))
+				{
+					Item.Name = (Images.Num() > 1) ? FString::Printf(TEXT("%s_%02d"), *BaseLabel, ImageIdx + 1) : BaseLabel;
+					Context->Downloaded.AddDefaulted_GetRef().Name = Item.Name;
+					DeliverGeneratedImage(Job.AsShared(), Context->Seed, Context->bFused && Context->Downloaded.Num() == 1, MoveTemp(Item));
+				}
+			}
+
+			if (Context->Downloaded.Num() == 0)
+			{
+				OutError = FString::Printf(TEXT("Download images: %s"), Error.IsEmpty() ? TEXT("No images downloaded.") : *Error);
+				return false;
+			}
+
+			if (!Context->bFused)
+			{
+				return true;
+			}
+
+			// CHORD ran on the whole latent batch; SaveImage nodes list the first image's maps first.
+			TMap<FString, FComfyImageReference> Channels;
+			if (!FComfyWorkflowUtils::ExtractPBRFromHistory(Settings, Context->History, Channels, Error, FusedLayout.ChordNodeOffset))
+			{
+				OutError = FString::Printf(TEXT("Parse PBR outputs: %s"), *Error);
+				return false;
+			}
+			return DownloadPBRMaps(Job, *Context, &Channels, Context->Downloaded[0].Name, Context->DownloadedMaps, Job.OutputPBRMaps.Label, OutError);
+		};
+
+		// Drafts and resumed prompts are not what the router picks between.
+		if (!Request.bDraft && !Request.Reattach.IsSet())
+		{
+			RecordRouteOutcome(Stages, Context, Route.GetKey());
+		}
+
+		FChordJobStage& CreateTextures = Stages.AddDefaulted_GetRef();
+		CreateTextures.Name = TEXT("Create textures");
+		CreateTextures.bGameThread = true;
+		CreateTextures.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			// The images were added one by one while downloading; only the fused maps are left.
+			if (Job.OutputImages.Num() == 0)
+			{
+				OutError = TEXT("Failed to decode images.");
+				return false;
+			}
+
+			if (Context->DownloadedMaps.Num() > 0)
+			{
+				Job.OutputPBRMaps.SourceImage = Job.OutputImages[0].Texture.Get();
+				CreatePBRTextures(Job.OutputPBRMaps, Context->DownloadedMaps);
+			}
+			return true;
+		};
+
+		return Stages;
+	}
+
+	bool GenerateWithGemini(FChordJob& Job, FString& OutError)
+	{
+		const UChordPBRSettings& Settings = Job.GetSettings();
+		if (Settings.GeminiApiKey.IsEmpty())
+		{
+			OutError = TEXT("Gemini API key is not configured. Please set it in Project Settings > Plugins > ChordPBRGenerator.");
+			return false;
+		}
+
+		// Gemini has no batch input; a batch is that many requests, which the shared client runs side by side.
+		const int32 NumImages = FMath::Max(1, Settings.Txt2ImgBatchSize);
+		Job.SetStatus(NumImages > 1 ? FString::Printf(TEXT("Generating %d images with Gemini API..."), NumImages) : TEXT("Generating image with Gemini API..."));
+
+		// Completions run on the game thread.
+		struct FGeminiResult
+		{
+			FString Error;
+			int32 NumPending = 0;
+			int32 NumGenerated = 0;
+		};
+
+		TSharedRef<FEvent, ESPMode::ThreadSafe> Done = MakeShareable(FPlatformProcess::GetSynchEventFromPool(true), [](FEvent* Event)
+		{
+			FPlatformProcess::ReturnSynchEventToPool(Event);
+		});
+		TSharedRef<FGeminiResult, ESPMode::ThreadSafe> Result = MakeShared<FGeminiResult, ESPMode::ThreadSafe>();
+		Result->NumPending = NumImages;
+		const FChordJobRef JobRef = Job.AsShared();
+
+		// The timeout only exists to fail over sooner. It runs per request from when it is sent, so a batch queued
+		// behind the rate budget is not cut short.
+		const float Timeout = Settings.bFailoverGeminiToComfyUI ? Settings.GeminiFailoverTimeoutSeconds : 0.0f;
+		for (int32 ImageIdx = 0; ImageIdx < NumImages; ++ImageIdx)
+		{
+			const FString& BaseLabel = Job.GetRequest().Label;
+			const FString Label = NumImages > 1 ? FString::Printf(TEXT("%s_%02d"), *BaseLabel, ImageIdx + 1) : BaseLabel;
+			FGeminiApiClient::Get().GenerateImageAsync(Settings, Job.GetRequest().Prompt,
+				FOnGeminiImageGenerated::CreateLambda([JobRef, Result, Done, Label](UTexture2D* GeneratedTexture, const FString& Error)
+				{
+					if (!Error.IsEmpty() || !GeneratedTexture)
+					{
+						// The first failure is the one reported.
+						if (Result->Error.IsEmpty())
+						{
+							Result->Error = Error.IsEmpty() ? TEXT("Failed to generate image.") : Error;
+						}
+					}
+					else if (!JobRef->IsCancelled())
+					{
+						const FName UniqueName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *Label);
+						GeneratedTexture->Rename(*UniqueName.ToString());
+						FChordJobImageOutput& Output = JobRef->OutputImages.AddDefaulted_GetRef();
+						Output.Label = Label;
+						Output.Texture = TStrongObjectPtr<UTexture2D>(GeneratedTexture);
+						Output.bGemini = true;
+						++Result->NumGenerated;
+						FChordJobScheduler::Get().NotifyImageReady(JobRef, JobRef->OutputImages.Num() - 1);
+					}
+					if (--Result->NumPending == 0)
+					{
+						Done->Trigger();
+					}
+				}), Job.GetCancellationToken(), Timeout);
+		}
+
+		Done->Wait();
+		if (Result->NumGenerated > 0)
+		{
+			// The tab reports the short batch in its status line.
+			if (Result->NumGenerated < NumImages)
+			{
+				UE_LOG(LogChordPBRGenerator, Warning, TEXT("Gemini generated %d of %d images for %s: %s"), Result->NumGenerated, NumImages, *Job.GetRequest().Label, *Result->Error);
+			}
+			return true;
+		}
+
+		OutError = Result->Error;
+		return false;
+	}
+
+	TArray<FChordJobStage> BuildGeminiTextToImageStages(const FComfyJobContextRef& Context, const FString& RouteKey, bool bFailover)
+	{
+		TArray<FChordJobStage> Stages;
+		FChordJobStage& Generate = Stages.AddDefaulted_GetRef();
+		Generate.Name = TEXT("Generate");
+		Generate.Run = [Context, RouteKey, bFailover](FChordJob& Job, FString& OutError)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Context->bGeminiSucceeded = GenerateWithGemini(Job, OutError);
+			if (Job.IsCancelled())
+			{
+				return false;
+			}
+			FChordBackendRouter::Get().Record(RouteKey, Context->bGeminiSucceeded, FPlatformTime::Seconds() - Start);
+			if (Context->bGeminiSucceeded || !bFailover)
+			{
+				return Context->bGeminiSucceeded;
+			}
+
+			UE_LOG(LogChordPBRGenerator, Warning, TEXT("Gemini failed for %s (%s); generating it with ComfyUI instead."), *Job.GetRequest().Label, *OutError);
+			Job.SetStatus(TEXT("Gemini failed; falling back to ComfyUI..."));
+			OutError.Reset();
+			return true;
+		};
+		return Stages;
+	}
+
+	// The route a journaled prompt was built from. Older journals did not record it and get the regular template.
+	FChordTxt2ImgRoute GetReattachRoute(const UChordPBRSettings& Settings, const FChordJobReattach& Reattach)
+	{
+		FChordTxt2ImgRoute Route = FChordBackendRouter::GetDefaultComfyRoute(Settings);
+		if (Reattach.TemplatePath.IsEmpty() || Reattach.TemplatePath == Route.TemplatePath)
+		{
+			return Route;
+		}
+
+		Route.TemplatePath = Reattach.TemplatePath;
+		if (const FChordTxt2ImgRouteTemplate* Template = Settings.Txt2ImgRouteTemplates.FindByPredicate([&Reattach](const FChordTxt2ImgRouteTemplate& Candidate) { return Candidate.TemplatePath == Reattach.TemplatePath; }))
+		{
+			Route.Binding = Template->Binding;
+			Route.Quality = Template->Quality;
+		}
+		return Route;
+	}
+
+	TArray<FChordJobStage> BuildTextToImageStages(const FChordJob& Job)
+	{
+		const UChordPBRSettings& Settings = Job.GetSettings();
+		const FChordJobRequest& Request = Job.GetRequest();
+		const FComfyJobContextRef Context = MakeShared<FComfyJobContext, ESPMode::ThreadSafe>();
+
+		// A resumed prompt lives on a ComfyUI server whatever the backend is set to now; drafts need a ComfyUI template,
+		// and a kept draft's seed only reproduces it on the template the draft was made for.
+		if (Request.Reattach.IsSet())
+		{
+			return BuildComfyTextToImageStages(Job, Context, GetReattachRoute(Settings, Request.Reattach));
+		}
+		if (Request.bDraft || Request.bKeptDraft)
+		{
+			return BuildComfyTextToImageStages(Job, Context, FChordBackendRouter::GetDefaultComfyRoute(Settings));
+		}
+
+		const FChordTxt2ImgRoute Route = FChordBackendRouter::Get().ChooseRoute(Settings);
+		if (!Route.bGemini)
+		{
+			return BuildComfyTextToImageStages(Job, Context, Route);
+		}
+
+		TArray<FChordJobStage> Stages = BuildGeminiTextToImageStages(Context, Route.GetKey(), Settings.bFailoverGeminiToComfyUI);
+		if (Settings.bFailoverGeminiToComfyUI)
+		{
+			// Stages are fixed at submission, so the fallback is always there and steps aside once Gemini delivered.
+			const FChordTxt2ImgRoute Fallback = FChordBackendRouter::Get().ChooseRoute(Settings, false);
+			for (FChordJobStage& Stage : BuildComfyTextToImageStages(Job, Context, Fallback))
+			{
+				Stage.Run = [Context, Run = MoveTemp(Stage.Run)](FChordJob& InJob, FString& OutError)
+				{
+					return Context->bGeminiSucceeded || Run(InJob, OutError);
+				};
+				Stages.Add(MoveTemp(Stage));
+			}
+		}
+		return Stages;
+	}
+
+	FChordJobStage MakePBRCreateTexturesStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage CreateTextures;
+		CreateTextures.Name = TEXT("Create textures");
+		CreateTextures.bGameThread = true;
+		CreateTextures.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			FChordPBRMapSet& MapSet = Job.OutputPBRMaps;
+			MapSet.SourceImage = Job.GetRequest().SourceTexture;
+
+			// A resumed job has no gallery item to attach to; hand the source image back so one can be created.
+			const FChordJobRequest& Request = Job.GetRequest();
+			if (Request.Reattach.IsSet() && Request.SourcePng.Num() > 0)
+			{
+				if (UTexture2D* Source = CreateNamedTexture(Request.SourcePng, Request.Label))
+				{
+					FChordJobImageOutput& Output = Job.OutputImages.AddDefaulted_GetRef();
+					Output.Label = Request.Label;
+					Output.Texture = TStrongObjectPtr<UTexture2D>(Source);
+					MapSet.SourceImage = Source;
+				}
+			}
+
+			CreatePBRTextures(MapSet, Context->DownloadedMaps);
+			return true;
+		};
+		return CreateTextures;
+	}
+
+	// A batch job's request images, or the tiles a tiled job cut its source into.
+	const TArray<FChordJobBatchImage>& GetBatchSources(const FChordJob& Job, const FComfyJobContext& Context)
+	{
+		return Context.Tiles.Num() > 0 ? Context.Tiles : Job.GetRequest().BatchImages;
+	}
+
+	bool UploadBatchSources(FChordJob& Job, FComfyJobContext& Context, bool bAllowPreUploaded, FString& OutError)
+	{
+		const TArray<FChordJobBatchImage>& Images = GetBatchSources(Job, Context);
+		Context.BatchUploaded.Reset();
+		Context.bUploadedEarlier = false;
+		for (int32 ImageIdx = 0; ImageIdx < Images.Num(); ++ImageIdx)
+		{
+			if (Job.IsCancelled())
+			{
+				OutError = TEXT("Cancelled.");
+				return false;
+			}
+
+			const FChordJobBatchImage& Image = Images[ImageIdx];
+			FComfyImageReference& Uploaded = Context.BatchUploaded.AddDefaulted_GetRef();
+			// Tiles are cut at full resolution on purpose; only whole gallery images are scaled down.
+			TArray<uint8> ResizedPng;
+			const TArray<uint8>& SourcePng = Context.Tiles.Num() > 0 ? Image.SourcePng : GetUploadSource(Job, Image.SourcePng, ResizedPng);
+			const FComfyImageReference* PreUploaded = bAllowPreUploaded ? Image.PreUploadedSources.Find(Context.Client->GetBaseUrl()) : nullptr;
+			if (PreUploaded && PreUploaded->Filename == FComfyUIClient::GetUploadName(SourcePng))
+			{
+				Uploaded = *PreUploaded;
+				Context.bUploadedEarlier = true;
+				continue;
+			}
+
+			Job.SetStatus(FString::Printf(TEXT("Uploading source image %d of %d..."), ImageIdx + 1, Images.Num()));
+			FString Error;
+			if (!Context.Client->UploadImage(SourcePng, Uploaded, Error))
+			{
+				OutError = FString::Printf(TEXT("Upload %s failed: %s"), *Image.Label, *Error);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	FChordJobStage MakeBatchedUploadStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Upload;
+		Upload.Name = TEXT("Upload");
+		Upload.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			return UploadBatchSources(Job, *Context, true, OutError);
+		};
+		return Upload;
+	}
+
+	FChordJobStage MakeBatchedExecuteStage(const FComfyJobContextRef& Context)
+	{
+		FChordJobStage Execute;
+		Execute.Name = TEXT("Execute");
+		Execute.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			FString Error;
+			TSharedPtr<FJsonObject> Prompt;
+			if (!FComfyWorkflowUtils::BuildBatchedChordPrompt(Settings, Context->BatchUploaded, Prompt, Context->BatchStride, Error))
+			{
+				OutError = FString::Printf(TEXT("Template error: %s"), *Error);
+				return false;
+			}
+			const FString What = Context->Tiles.Num() > 0
+				? FString::Printf(TEXT("PBR tiles (%d)"), Context->BatchUploaded.Num())
+				: FString::Printf(TEXT("PBR batch (%d images)"), Context->BatchUploaded.Num());
+			const bool bCompleted = QueueAndWait(Job, *Context, Prompt, Settings.ChordImg2PbrApiPromptPath, *What, FComfyExecutionCallbacks(), OutError);
+			if (bCompleted || !Context->bUploadedEarlier || !IsSourceImageRejected(Context->Response) || Job.IsCancelled())
+			{
+				return bCompleted;
+			}
+
+			// Same recovery as a single PBR job: one lost pre-upload rejects the whole graph, so send every image.
+			UE_LOG(LogChordPBRGenerator, Log, TEXT("Batched CHORD prompt was rejected (%s); uploading its sources again."), *OutError);
+			if (!UploadBatchSources(Job, *Context, false, OutError))
+			{
+				return false;
+			}
+			if (!FComfyWorkflowUtils::BuildBatchedChordPrompt(Settings, Context->BatchUploaded, Prompt, Context->BatchStride, Error))
+			{
+				OutError = FString::Printf(TEXT("Template error: %s"), *Error);
+				return false;
+			}
+			return QueueAndWait(Job, *Context, Prompt, Settings.ChordImg2PbrApiPromptPath, *What, FComfyExecutionCallbacks(), OutError);
+		};
+		return Execute;
+	}
+
+	// Sources larger than a tile: CHORD runs on overlapping tiles in one batched prompt and the maps are stitched
+	// back together on the CPU, so the result keeps the source resolution.
+	TArray<FChordJobStage> BuildTiledImageToPBRStages(const FChordJob& Job)
+	{
+		const FComfyJobContextRef Context = MakeShared<FComfyJobContext, ESPMode::ThreadSafe>();
+		TArray<FChordJobStage> Stages;
+		Stages.Add(MakeSelectServerStage(Context, Job.GetSettings().ChordImg2PbrApiPromptPath));
+
+		FChordJobStage& Split = Stages.AddDefaulted_GetRef();
+		Split.Name = TEXT("Split");
+		Split.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			const FChordJobRequest& Request = Job.GetRequest();
+			Job.SetStatus(TEXT("Splitting source image into tiles..."));
+
+			TArray64<uint8> SourcePixels;
+			if (!FChordImageUtils::DecodeImage(Request.SourcePng, SourcePixels, Context->SourceWidth, Context->SourceHeight))
+			{
+				OutError = TEXT("Split: Failed to decode the source image.");
+				return false;
+			}
+
+			Context->TileLayout = FChordImageTiling::ComputeTiles(Context->SourceWidth, Context->SourceHeight, Settings.ChordTileSize, Settings.ChordTileOverlap);
+			for (int32 TileIdx = 0; TileIdx < Context->TileLayout.Num(); ++TileIdx)
+			{
+				const FChordImageTile& Tile = Context->TileLayout[TileIdx];
+				TArray<FColor> TilePixels;
+				FChordImageTiling::CropTile(SourcePixels, Context->SourceWidth, Tile, TilePixels);
+
+				FChordJobBatchImage& TileImage = Context->Tiles.AddDefaulted_GetRef();
+				TileImage.Label = FString::Printf(TEXT("%s_tile%02d"), *Request.Label, TileIdx);
+				FString Error;
+				if (!FChordImageUtils::EncodePixelsToPng(TilePixels, Tile.Size, Tile.Size, TileImage.SourcePng, Error))
+				{
+					OutError = FString::Printf(TEXT("Split: %s"), *Error);
+					return false;
+				}
+			}
+
+			UE_LOG(LogChordPBRGenerator, Log, TEXT("Split %s (%dx%d) into %d tiles of %d px."), *Request.Label, Context->SourceWidth, Context->SourceHeight,
+				Context->TileLayout.Num(), Context->TileLayout.Num() > 0 ? Context->TileLayout[0].Size : 0);
+			return Context->TileLayout.Num() > 0;
+		};
+
+		Stages.Add(MakeBatchedUploadStage(Context));
+		Stages.Add(MakeBatchedExecuteStage(Context));
+
+		FChordJobStage& Download = Stages.AddDefaulted_GetRef();
+		Download.Name = TEXT("Download");
+		Download.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			Context->TileMaps.SetNum(Context->TileLayout.Num());
+			for (int32 TileIdx = 0; TileIdx < Context->TileLayout.Num(); ++TileIdx)
+			{
+				Job.SetStatus(FString::Printf(TEXT("Downloading tile maps %d of %d..."), TileIdx + 1, Context->TileLayout.Num()));
+				FString Error;
+				TMap<FString, FComfyImageReference> Channels;
+				if (!FComfyWorkflowUtils::ExtractPBRFromHistory(Job.GetSettings(), Context->History, Channels, Error, TileIdx * Context->BatchStride, Context->BatchStride))
+				{
+					OutError = FString::Printf(TEXT("Parse PBR outputs of tile %d: %s"), TileIdx, *Error);
+					return false;
+				}
+
+				// Unlike a batch, every tile is needed: a missing one would leave a hole in the stitched maps.
+				for (const TCHAR* ChannelName : PBRChannelNames)
+				{
+					TArray<uint8>& Data = Context->TileMaps[TileIdx].AddDefaulted_GetRef();
+					if (!Job.GetSettings().ChordOutputChannels.IsEnabled(ChannelName))
+					{
+						continue;
+					}
+					if (Job.IsCancelled())
+					{
+						OutError = TEXT("Cancelled.");
+						return false;
+					}
+
+					const FComfyImageReference* Ref = Channels.Find(ChannelName);
+					if (!Ref || !Context->Prefetcher->Fetch(*Ref, Data, Error))
+					{
+						OutError = FString::Printf(TEXT("Download %s of tile %d: %s"), ChannelName, TileIdx, Ref ? *Error : TEXT("Missing channel."));
+						return false;
+					}
+				}
+			}
+			return true;
+		};
+
+		FChordJobStage& Stitch = Stages.AddDefaulted_GetRef();
+		Stitch.Name = TEXT("Stitch");
+		Stitch.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			const FString SafeLabel = FPaths::MakeValidFileName(Job.GetRequest().Label.IsEmpty() ? Context->Response.PromptId : Job.GetRequest().Label);
+			const FString CacheDir = FPaths::Combine(Settings.SavedCacheRoot, TEXT("PBR"), SafeLabel);
+			for (int32 ChannelIdx = 0; ChannelIdx < static_cast<int32>(UE_ARRAY_COUNT(PBRChannelNames)); ++ChannelIdx)
+			{
+				const FString ChannelName = PBRChannelNames[ChannelIdx];
+				if (!Settings.ChordOutputChannels.IsEnabled(ChannelName))
+				{
+					continue;
+				}
+				Job.SetStatus(FString::Printf(TEXT("Stitching %s..."), *ChannelName));
+
+				// One channel at a time keeps the float canvas to a single map's worth of memory.
+				FChordTileStitcher Stitcher(Context->SourceWidth, Context->SourceHeight, Settings.ChordTileOverlap);
+				for (int32 TileIdx = 0; TileIdx < Context->TileLayout.Num(); ++TileIdx)
+				{
+					if (Job.IsCancelled())
+					{
+						OutError = TEXT("Cancelled.");
+						return false;
+					}
+
+					TArray64<uint8> MapPixels;
+					int32 MapWidth = 0;
+					int32 MapHeight = 0;
+					if (!FChordImageUtils::DecodeImage(Context->TileMaps[TileIdx][ChannelIdx], MapPixels, MapWidth, MapHeight))
+					{
+						OutError = FString::Printf(TEXT("Stitch: Failed to decode %s of tile %d."), *ChannelName, TileIdx);
+						return false;
+					}
+					Stitcher.AddTile(Context->TileLayout[TileIdx], MapPixels, MapWidth, MapHeight);
+					Context->TileMaps[TileIdx][ChannelIdx].Empty();
+				}
+
+				TArray<FColor> Stitched;
+				Stitcher.Finish(ChannelName == TEXT("Normal"), Stitched);
+
+				FDownloadedImage Item;
+				Item.Channel = ChannelIdx;
+				FString Error;
+				if (!FChordImageUtils::EncodePixelsToPng(Stitched, Context->SourceWidth, Context->SourceHeight, Item.Data, Error))
+				{
+					OutError = FString::Printf(TEXT("Stitch %s: %s"), *ChannelName, *Error);
+					return false;
+				}
+				Item.Name = FString::Printf(TEXT("%s_%s"), *SafeLabel, *ChannelName);
+
+				IFileManager::Get().MakeDirectory(*CacheDir, true);
+				const FString TargetPath = FPaths::Combine(CacheDir, FString::Printf(TEXT("PBR_%s_%s.png"), *SafeLabel, *ChannelName));
+				if (FFileHelper::SaveArrayToFile(Item.Data, *TargetPath))
+				{
+					Item.FilePath = TargetPath;
+				}
+				Context->DownloadedMaps.Add(MoveTemp(Item));
+			}
+
+			Job.OutputPBRMaps.Label = *FString::Printf(TEXT("PBR_%s"), *SafeLabel);
+			return true;
+		};
+
+		Stages.Add(MakePBRCreateTexturesStage(Context));
+		return Stages;
+	}
+
+	TArray<FChordJobStage> BuildImageToPBRStages(const FChordJob& Job)
+	{
+		const FComfyJobContextRef Context = MakeShared<FComfyJobContext, ESPMode::ThreadSafe>();
+		TArray<FChordJobStage> Stages;
+		if (Job.GetRequest().Reattach.IsSet())
+		{
+			Stages.Add(MakeReattachStage(Context));
+		}
+		else
+		{
+			// Chosen before the upload: the source image has to live on the server that runs the prompt.
+			Stages.Add(MakeSelectServerStage(Context, Job.GetSettings().ChordImg2PbrApiPromptPath));
+			Stages.Add(MakePBRUploadStage(Context));
+			Stages.Add(MakePBRExecuteStage(Context));
+		}
+
+		FChordJobStage& Download = Stages.AddDefaulted_GetRef();
+		Download.Name = TEXT("Download");
+		Download.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const UChordPBRSettings& Settings = Job.GetSettings();
+			// A resumed job lost its socket with the old session; its outputs can only come from /history.
+			const bool bStreamOutputs = Settings.bStreamChordOutputsOverWebSocket && !Job.GetRequest().Reattach.IsSet();
+			FString Error;
+			TMap<FString, FComfyImageReference> Channels;
+			if (!bStreamOutputs && !FComfyWorkflowUtils::ExtractPBRFromHistory(Settings, Context->History, Channels, Error))
+			{
+				OutError = FString::Printf(TEXT("Parse PBR outputs: %s"), *Error);
+				return false;
+			}
+			return DownloadPBRMaps(Job, *Context, bStreamOutputs ? nullptr : &Channels, Job.GetRequest().Label, Context->DownloadedMaps, Job.OutputPBRMaps.Label, OutError);
+		};
+
+		Stages.Add(MakePBRCreateTexturesStage(Context));
+		return Stages;
+	}
+
+	TArray<FChordJobStage> BuildImageToPBRBatchStages(const FChordJob& Job)
+	{
+		const FComfyJobContextRef Context = MakeShared<FComfyJobContext, ESPMode::ThreadSafe>();
+		TArray<FChordJobStage> Stages;
+		Stages.Add(MakeSelectServerStage(Context, Job.GetSettings().ChordImg2PbrApiPromptPath));
+
+		Stages.Add(MakeBatchedUploadStage(Context));
+		Stages.Add(MakeBatchedExecuteStage(Context));
+
+		FChordJobStage& Download = Stages.AddDefaulted_GetRef();
+		Download.Name = TEXT("Download");
+		Download.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const TArray<FChordJobBatchImage>& Images = Job.GetRequest().BatchImages;
+			Context->BatchMaps.SetNum(Images.Num());
+			Context->BatchLabels.SetNum(Images.Num());
+			int32 NumDownloaded = 0;
+			FString FirstError;
+			for (int32 ImageIdx = 0; ImageIdx < Images.Num() && !Job.IsCancelled(); ++ImageIdx)
+			{
+				// A branch that failed to parse or download only costs its own image.
+				FString Error;
+				TMap<FString, FComfyImageReference> Channels;
+				const int32 Offset = ImageIdx * Context->BatchStride;
+				if (!FComfyWorkflowUtils::ExtractPBRFromHistory(Job.GetSettings(), Context->History, Channels, Error, Offset, Context->BatchStride)
+					|| !DownloadPBRMaps(Job, *Context, &Channels, Images[ImageIdx].Label, Context->BatchMaps[ImageIdx], Context->BatchLabels[ImageIdx], Error))
+				{
+					UE_LOG(LogChordPBRGenerator, Warning, TEXT("PBR batch: no maps for %s: %s"), *Images[ImageIdx].Label, *Error);
+					Context->BatchMaps[ImageIdx].Reset();
+					if (FirstError.IsEmpty())
+					{
+						FirstError = Error;
+					}
+					continue;
+				}
+				++NumDownloaded;
+			}
+
+			if (NumDownloaded == 0)
+			{
+				OutError = Job.IsCancelled() ? TEXT("Cancelled.") : FString::Printf(TEXT("Download PBR maps: %s"), *FirstError);
+				return false;
+			}
+			return true;
+		};
+
+		FChordJobStage& CreateTextures = Stages.AddDefaulted_GetRef();
+		CreateTextures.Name = TEXT("Create textures");
+		CreateTextures.bGameThread = true;
+		CreateTextures.Run = [Context](FChordJob& Job, FString& OutError)
+		{
+			const TArray<FChordJobBatchImage>& Images = Job.GetRequest().BatchImages;
+			for (int32 ImageIdx = 0; ImageIdx < Images.Num(); ++ImageIdx)
+			{
+				if (Context->BatchMaps[ImageIdx].Num() == 0)
+				{
+					continue;
+				}
+
+				FChordJobBatchOutput& Output = Job.OutputPBRBatch.AddDefaulted_GetRef();
+				Output.ImageId = Images[ImageIdx].ImageId;
+				Output.Maps.Label = Context->BatchLabels[ImageIdx];
+				Output.Maps.SourceImage = Images[ImageIdx].Texture;
+				CreatePBRTextures(Output.Maps, Context->BatchMaps[ImageIdx]);
+			}
+			return true;
+		};
+
+		return Stages;
+	}
+}
+
+FChordJob::FChordJob(FChordJobRequest&& InRequest, UChordPBRSettings* InSettingsSnapshot)
+	: Id(FGuid::NewGuid())
+	, Request(MoveTemp(InRequest))
+	, Settings(InSettingsSnapshot)
+	, CancellationToken(MakeShared<FChordCancellationToken, ESPMode::ThreadSafe>())
+	, PromotionSignal(MakeShared<FChordCancellationToken, ESPMode::ThreadSafe>())
+{
+	check(Settings);
+	Settings->AddToRoot();
+}
+
+FChordJob::~FChordJob()
+{
+	Settings->RemoveFromRoot();
+}
+
+FString FChordJob::GetStatus() const
+{
+	FScopeLock Lock(&Mutex);
+	return Status;
+}
+
+void FChordJob::SetStatus(const FString& InStatus)
+{
+	{
+		FScopeLock Lock(&Mutex);
+		Status = InStatus;
+	}
+	FChordJobScheduler::Get().NotifyJobChanged(AsShared());
+}
+
+void FChordJob::Cancel()
+{
+	CancellationToken->Cancel();
+	CancelQueuedPrompt();
+}
+
+void FChordJob::Detach()
+{
+	bDetached = true;
+	CancellationToken->Cancel();
+}
+
+void FChordJob::NoteQueuedPrompt(const TSharedRef<FComfyUIClient>& Client, const FComfyPromptResponse& Queued)
+{
+	{
+		FScopeLock Lock(&Mutex);
+		QueuedClient = Client;
+		QueuedPromptId = Queued.PromptId;
+	}
+
+	// The job may have been cancelled while /prompt was in flight.
+	if (IsCancelled() && !IsDetached())
+	{
+		CancelQueuedPrompt();
+	}
+}
+
+void FChordJob::ClearQueuedPrompt()
+{
+	FScopeLock Lock(&Mutex);
+	QueuedClient.Reset();
+	QueuedPromptId.Reset();
+}
+
+void FChordJob::CancelQueuedPrompt()
+{
+	TSharedPtr<FComfyUIClient> Client;
+	FString PromptId;
+	{
+		FScopeLock Lock(&Mutex);
+		Client = MoveTemp(QueuedClient);
+		PromptId = MoveTemp(QueuedPromptId);
+	}
+
+	if (!Client.IsValid() || PromptId.IsEmpty())
+	{
+		return;
+	}
+
+	Async(EAsyncExecution::ThreadPool, [Client, PromptId]()
+	{
+		FString CancelError;
+		if (!Client->CancelPrompt(PromptId, CancelError))
+		{
+			UE_LOG(LogChordPBRGenerator, Warning, TEXT("Failed to cancel prompt %s: %s"), *PromptId, *CancelError);
+		}
+	});
+}
+
+TArray<FChordJobStage> FChordJobStages::Build(const FChordJob& Job)
+{
+	if (Job.GetType() == EChordJobType::ImageToPBR)
+	{
+		return ShouldTile(Job.GetRequest(), Job.GetSettings()) ? BuildTiledImageToPBRStages(Job) : BuildImageToPBRStages(Job);
+	}
+	if (Job.GetType() == EChordJobType::ImageToPBRBatch)
+	{
+		return BuildImageToPBRBatchStages(Job);
+	}
+
+	return BuildTextToImageStages(Job);
+}
+
+bool FChordJobStages::ShouldTile(const FChordJobRequest& Request, const UChordPBRSettings& Settings)
+{
+	// A resumed prompt was queued whole; it is finished the way it was started.
+	int32 Width = 0;
+	int32 Height = 0;
+	return Request.Type == EChordJobType::ImageToPBR && Settings.ChordTileSize > 0 && !Request.Reattach.IsSet()
+		&& FChordImageUtils::GetImageSize(Request.SourcePng, Width, Height)
+		&& (Width > Settings.ChordTileSize || Height > Settings.ChordTileSize);
+}
@@ -0,0 +1,227 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordJobJournal.h"
+
+#include "ChordPBRGeneratorModule.h"
+#include "ChordPBRSettings.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	const TCHAR* LexJobType(EChordJobType Type)
+	{
+		return Type == EChordJobType::ImageToPBR ? TEXT("ImageToPBR") : TEXT("TextToImage");
+	}
+
+	TSharedRef<FJsonObject> EntryToJson(const FChordJournalEntry& Entry)
+	{
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("job_id"), Entry.JobId.ToString());
+		Json->SetStringField(TEXT("type"), LexJobType(Entry.Type));
+		Json->SetStringField(TEXT("prompt_id"), Entry.PromptId);
+		Json->SetStringField(TEXT("client_id"), Entry.ClientId);
+		Json->SetStringField(TEXT("server"), Entry.ServerUrl);
+		Json->SetStringField(TEXT("label"), Entry.Label);
+		Json->SetStringField(TEXT("stage"), Entry.Stage);
+		Json->SetStringField(TEXT("source_image"), Entry.SourceImagePath);
+		Json->SetStringField(TEXT("template"), Entry.TemplatePath);
+		Json->SetBoolField(TEXT("fused"), Entry.bFused);
+		Json->SetStringField(TEXT("chord_channels"), Entry.ChordOutputChannels);
+		return Json;
+	}
+
+	bool EntryFromJson(const TSharedPtr<FJsonObject>& Json, FChordJournalEntry& OutEntry)
+	{
+		if (!Json.IsValid() || !FGuid::Parse(Json->GetStringField(TEXT("job_id")), OutEntry.JobId))
+		{
+			return false;
+		}
+
+		OutEntry.Type = Json->GetStringField(TEXT("type")) == TEXT("ImageToPBR") ? EChordJobType::ImageToPBR : EChordJobType::TextToImage;
+		OutEntry.PromptId = Json->GetStringField(TEXT("prompt_id"));
+		OutEntry.ClientId = Json->GetStringField(TEXT("client_id"));
+		OutEntry.ServerUrl = Json->GetStringField(TEXT("server"));
+		OutEntry.Label = Json->GetStringField(TEXT("label"));
+		OutEntry.Stage = Json->GetStringField(TEXT("stage"));
+		OutEntry.SourceImagePath = Json->GetStringField(TEXT("source_image"));
+		// Missing in journals written before fused prompts were resumable.
+		Json->TryGetStringField(TEXT("template"), OutEntry.TemplatePath);
+		Json->TryGetBoolField(TEXT("fused"), OutEntry.bFused);
+		Json->TryGetStringField(TEXT("chord_channels"), OutEntry.ChordOutputChannels);
+		return !OutEntry.PromptId.IsEmpty() && !OutEntry.ServerUrl.IsEmpty();
+	}
+}
+
+FChordJobJournal& FChordJobJournal::Get()
+{
+	static FChordJobJournal Journal;
+	return Journal;
+}
+
+void FChordJobJournal::Record(const FChordJob& Job, const FString& ServerUrl, const FComfyPromptResponse& Queued, const FString& TemplatePath, bool bFused)
+{
+	// Streamed outputs are never written to the server's output folder, so there would be nothing to reattach to.
+	// Batches, tiled jobs and drafts are not journaled; they are cheap to request again.
+	if ((Job.GetType() == EChordJobType::ImageToPBR && Job.GetSettings().bStreamChordOutputsOverWebSocket) || Job.GetType() == EChordJobType::ImageToPBRBatch
+		|| FChordJobStages::ShouldTile(Job.GetRequest(), Job.GetSettings()) || Job.GetRequest().bDraft)
+	{
+		return;
+	}
+
+	FScopeLock Lock(&Mutex);
+	LoadIfNeeded();
+
+	FChordJournalEntry Entry;
+	Entry.JobId = Job.GetJournalId();
+	Entry.Type = Job.GetType();
+	Entry.PromptId = Queued.PromptId;
+	Entry.ClientId = Queued.ClientId;
+	Entry.ServerUrl = ServerUrl;
+	Entry.Label = Job.GetRequest().Label;
+	Entry.Stage = TEXT("Execute");
+	Entry.TemplatePath = TemplatePath;
+	Entry.bFused = bFused;
+	Entry.ChordOutputChannels = Job.GetSettings().ChordOutputChannels.ToKey();
+
+	if (Job.GetType() == EChordJobType::ImageToPBR)
+	{
+		const FString SourcePath = FPaths::Combine(JournalDir, Entry.JobId.ToString() + TEXT(".png"));
+		if (FFileHelper::SaveArrayToFile(Job.GetRequest().SourcePng, *SourcePath))
+		{
+			Entry.SourceImagePath = SourcePath;
+		}
+	}
+
+	Entries.RemoveAll([&Entry](const FChordJournalEntry& Existing)
+	{
+		return Existing.JobId == Entry.JobId;
+	});
+	Entries.Add(MoveTemp(Entry));
+	Save();
+}
+
+void FChordJobJournal::UpdateStage(const FGuid& JobId, const FString& Stage)
+{
+	FScopeLock Lock(&Mutex);
+	if (FChordJournalEntry* Entry = Entries.FindByPredicate([&JobId](const FChordJournalEntry& Existing) { return Existing.JobId == JobId; }))
+	{
+		if (Entry->Stage != Stage)
+		{
+			Entry->Stage = Stage;
+			Save();
+		}
+	}
+}
+
+void FChordJobJournal::Remove(const FGuid& JobId)
+{
+	FScopeLock Lock(&Mutex);
+	const int32 Index = Entries.IndexOfByPredicate([&JobId](const FChordJournalEntry& Existing) { return Existing.JobId == JobId; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (!Entries[Index].SourceImagePath.IsEmpty())
+	{
+		IFileManager::Get().Delete(*Entries[Index].SourceImagePath, false, false, true);
+	}
+	Entries.RemoveAt(Index);
+	OrphanedIds.Remove(JobId);
+	Save();
+}
+
+TArray<FChordJournalEntry> FChordJobJournal::TakeOrphanedEntries()
+{
+	FScopeLock Lock(&Mutex);
+	LoadIfNeeded();
+
+	TArray<FChordJournalEntry> Orphaned;
+	for (const FChordJournalEntry& Entry : Entries)
+	{
+		if (OrphanedIds.Contains(Entry.JobId))
+		{
+			Orphaned.Add(Entry);
+		}
+	}
+	OrphanedIds.Reset();
+	return Orphaned;
+}
+
+void FChordJobJournal::LoadIfNeeded()
+{
+	if (bLoaded)
+	{
+		return;
+	}
+
+	bLoaded = true;
+	JournalDir = FPaths::Combine(GetDefault<UChordPBRSettings>()->SavedCacheRoot, TEXT("Jobs"));
+
+	FString JsonText;
+	if (!FFileHelper::LoadFileToString(JsonText, *GetJournalPath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonText);
+	const TArray<TSharedPtr<FJsonValue>>* JobValues = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || !Root->TryGetArrayField(TEXT("jobs"), JobValues))
+	{
+		UE_LOG(LogChordPBRGenerator, Warning, TEXT("Ignoring unreadable job journal %s"), *GetJournalPath());
+		return;
+	}
+
+	for (const TSharedPtr<FJsonValue>& Value : *JobValues)
+	{
+		FChordJournalEntry Entry;
+		if (EntryFromJson(Value->AsObject(), Entry))
+		{
+			OrphanedIds.Add(Entry.JobId);
+			Entries.Add(MoveTemp(Entry));
+		}
+	}
+
+	if (Entries.Num() > 0)
+	{
+		UE_LOG(LogChordPBRGenerator, Log, TEXT("Job journal lists %d prompt(s) from an earlier session."), Entries.Num());
+	}
+}
+
+void FChordJobJournal::Save() const
+{
+	TArray<TSharedPtr<FJsonValue>> JobValues;
+	for (const FChordJournalEntry& Entry : Entries)
+	{
+		JobValues.Add(MakeShared<FJsonValueObject>(EntryToJson(Entry)));
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetArrayField(TEXT("jobs"), JobValues);
+
+	FString JsonText;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonText);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	// Written next to the journal and moved over it, so a crash mid-write never leaves a truncated file.
+	IFileManager::Get().MakeDirectory(*JournalDir, true);
+	const FString Path = GetJournalPath();
+	const FString TempPath = Path + TEXT(".tmp");
+	if (!FFileHelper::SaveStringToFile(JsonText, *TempPath) || !IFileManager::Get().Move(*Path, *TempPath, true, true))
+	{
+		UE_LOG(LogChordPBRGenerator, Warning, TEXT("Failed to write job journal %s"), *Path);
+	}
+}
+
+FString FChordJobJournal::GetJournalPath() const
+{
+	return FPaths::Combine(JournalDir, TEXT("journal.json"));
+}
@@ -0,0 +1,422 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordJobScheduler.h"
+
+#include "Async/Async.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "ChordJobJournal.h"
+#include "ChordPBRGeneratorModule.h"
+#include "ChordPBRSettings.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+#include "UObject/Package.h"
+
+namespace
+{
+	// Detached stages only have to notice their cancelled token; a stage that takes longer is left behind.
+	constexpr double DetachDrainSeconds = 10.0;
+
+	const TCHAR* LexJobState(EChordJobState State)
+	{
+		switch (State)
+		{
+		case EChordJobState::Pending: return TEXT("pending");
+		case EChordJobState::Running: return TEXT("running");
+		case EChordJobState::Succeeded: return TEXT("succeeded");
+		case EChordJobState::Failed: return TEXT("failed");
+		case EChordJobState::Cancelled: return TEXT("cancelled");
+		}
+		return TEXT("unknown");
+	}
+
+	FString MakeCoalesceKey(const FChordJobRequest& Request, const UChordPBRSettings& Settings)
+	{
+		if (Request.Type != EChordJobType::ImageToPBR || Request.SourcePng.Num() == 0)
+		{
+			return FString();
+		}
+
+		// Keyed by content rather than by gallery item: the same image in two tabs is the same work.
+		const FSHAHash ImageHash = FSHA1::HashBuffer(Request.SourcePng.GetData(), Request.SourcePng.Num());
+		const FString Tiling = FChordJobStages::ShouldTile(Request, Settings) ? FString::Printf(TEXT("|tiles%d-%d"), Settings.ChordTileSize, Settings.ChordTileOverlap) : FString();
+		return FString::Printf(TEXT("%s|%s|%s%s"), *ImageHash.ToString(), *Settings.ChordImg2PbrApiPromptPath, *Settings.ChordOutputChannels.ToKey(), *Tiling);
+	}
+}
+
+FChordJobScheduler& FChordJobScheduler::Get()
+{
+	static FChordJobScheduler Scheduler;
+	return Scheduler;
+}
+
+FChordJobRef FChordJobScheduler::Submit(FChordJobRequest&& Request)
+{
+	check(IsInGameThread());
+
+	// A private copy of the settings: a job keeps the configuration it was started with even if the user edits
+	// Project Settings while it waits or runs. A resumed prompt keeps the channels it was queued with.
+	UChordPBRSettings* Snapshot = NewObject<UChordPBRSettings>(GetTransientPackage(), NAME_None, RF_Transient, GetMutableDefault<UChordPBRSettings>());
+	if (Request.Reattach.ChordOutputChannels.IsSet())
+	{
+		Snapshot->ChordOutputChannels = Request.Reattach.ChordOutputChannels.GetValue();
+	}
+
+	const FString CoalesceKey = MakeCoalesceKey(Request, *Snapshot);
+	if (const FChordJobPtr Existing = FindCoalescableJob(CoalesceKey))
+	{
+		++Existing->NumRequesters;
+		UE_LOG(LogChordPBRGenerator, Log, TEXT("Request for %s joins job %s (%d requesters)."), *Request.Label, *Existing->GetId().ToString(), Existing->NumRequesters);
+		if (Request.Priority == EComfyJobPriority::Interactive)
+		{
+			Promote(Existing.ToSharedRef());
+		}
+		return Existing.ToSharedRef();
+	}
+
+	const FChordJobRef Job = MakeShared<FChordJob, ESPMode::ThreadSafe>(MoveTemp(Request), Snapshot);
+	Job->Stages = FChordJobStages::Build(*Job);
+	Job->Status = TEXT("Waiting for a free job slot...");
+	Job->CoalesceKey = CoalesceKey;
+
+	PendingJobs.Add(Job);
+	JobChangedEvent.Broadcast(Job);
+	PumpQueue();
+	return Job;
+}
+
+void FChordJobScheduler::Cancel(const FChordJobRef& Job)
+{
+	check(IsInGameThread());
+
+	Job->Cancel();
+	if (PendingJobs.Contains(Job))
+	{
+		FinishJob(Job, EChordJobState::Cancelled, TEXT("Cancelled."));
+	}
+}
+
+void FChordJobScheduler::Promote(const FChordJobRef& Job)
+{
+	check(IsInGameThread());
+
+	if (Job->GetPriority() == EComfyJobPriority::Interactive)
+	{
+		return;
+	}
+
+	Job->PromotionSignal->Cancel();
+	JobChangedEvent.Broadcast(Job);
+	PumpQueue();
+}
+
+bool FChordJobScheduler::Release(const FChordJobRef& Job)
+{
+	check(IsInGameThread());
+
+	if (--Job->NumRequesters > 0)
+	{
+		return false;
+	}
+
+	Cancel(Job);
+	return true;
+}
+
+void FChordJobScheduler::CancelAll()
+{
+	for (const FChordJobRef& Job : GetActiveJobs())
+	{
+		Cancel(Job);
+	}
+}
+
+void FChordJobScheduler::DetachAll()
+{
+	for (const FChordJobRef& Job : GetActiveJobs())
+	{
+		if (PendingJobs.Contains(Job))
+		{
+			Cancel(Job);
+		}
+		else
+		{
+			Job->Detach();
+		}
+	}
+
+	// Stages post their completion and game-thread stages to this thread, so it has to keep running those while
+	// it waits for the workers.
+	const double Deadline = FPlatformTime::Seconds() + DetachDrainSeconds;
+	while ((NumStagesInFlight > 0 || RunningJobs.Num() > 0) && FPlatformTime::Seconds() < Deadline)
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		FPlatformProcess::Sleep(0.01f);
+	}
+	FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+
+	if (NumStagesInFlight > 0 || RunningJobs.Num() > 0)
+	{
+		UE_LOG(LogChordPBRGenerator, Warning, TEXT("%d job(s) still running %.0f s after detaching."), RunningJobs.Num(), DetachDrainSeconds);
+	}
+}
+
+TArray<FChordJobRef> FChordJobScheduler::ResumeJournaledJobs()
+{
+	check(IsInGameThread());
+
+	TArray<FChordJobRef> Resumed;
+	for (const FChordJournalEntry& Entry : FChordJobJournal::Get().TakeOrphanedEntries())
+	{
+		FChordJobRequest Request;
+		Request.Type = Entry.Type;
+		Request.Label = Entry.Label;
+		Request.Reattach.JournalId = Entry.JobId;
+		Request.Reattach.PromptId = Entry.PromptId;
+		Request.Reattach.ClientId = Entry.ClientId;
+		Request.Reattach.ServerUrl = Entry.ServerUrl;
+		Request.Reattach.TemplatePath = Entry.TemplatePath;
+		Request.Reattach.bFused = Entry.bFused;
+		FChordPBRChannelSelection Channels;
+		if (FChordPBRChannelSelection::FromKey(Entry.ChordOutputChannels, Channels))
+		{
+			Request.Reattach.ChordOutputChannels = Channels;
+		}
+
+		if (Entry.Type == EChordJobType::ImageToPBR)
+		{
+			if (!FFileHelper::LoadFileToArray(Request.SourcePng, *Entry.SourceImagePath))
+			{
+				UE_LOG(LogChordPBRGenerator, Warning, TEXT("Dropping journaled prompt %s: source image %s is missing."), *Entry.PromptId, *Entry.SourceImagePath);
+				FChordJobJournal::Get().Remove(Entry.JobId);
+				continue;
+			}
+			// The gallery item is recreated from the saved source image once the maps arrive.
+			Request.SourceImageId = FGuid::NewGuid();
+		}
+
+		UE_LOG(LogChordPBRGenerator, Log, TEXT("Resuming prompt %s on %s (last stage: %s)."), *Entry.PromptId, *Entry.ServerUrl, *Entry.Stage);
+		Resumed.Add(Submit(MoveTemp(Request)));
+	}
+	return Resumed;
+}
+
+TArray<FChordJobRef> FChordJobScheduler::GetActiveJobs() const
+{
+	TArray<FChordJobRef> Jobs = RunningJobs;
+	Jobs.Append(PendingJobs);
+	return Jobs;
+}
+
+bool FChordJobScheduler::HasRunningInteractiveJobs() const
+{
+	return RunningJobs.ContainsByPredicate([](const FChordJobRef& Job)
+	{
+		return Job->GetPriority() == EComfyJobPriority::Interactive;
+	});
+}
+
+void FChordJobScheduler::NotifyJobChanged(const FChordJobRef& Job)
+{
+	if (IsInGameThread())
+	{
+		JobChangedEvent.Broadcast(Job);
+		return;
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [this, Job]()
+	{
+		JobChangedEvent.Broadcast(Job);
+	});
+}
+
+void FChordJobScheduler::NotifyPreviewFrame(const FChordJobRef& Job, const TArray<uint8>& ImageData)
+{
+	AsyncTask(ENamedThreads::GameThread, [this, Job, ImageData]()
+	{
+		if (!Job->IsFinished())
+		{
+			PreviewFrameEvent.Broadcast(Job, ImageData);
+		}
+	});
+}
+
+void FChordJobScheduler::NotifyImageReady(const FChordJobRef& Job, int32 OutputIndex)
+{
+	if (IsInGameThread())
+	{
+		ImageReadyEvent.Broadcast(Job, OutputIndex);
+		return;
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [this, Job, OutputIndex]()
+	{
+		ImageReadyEvent.Broadcast(Job, OutputIndex);
+	});
+}
+
+FChordJobPtr FChordJobScheduler::FindCoalescableJob(const FString& CoalesceKey) const
+{
+	if (CoalesceKey.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	for (const FChordJobRef& Job : GetActiveJobs())
+	{
+		// A cancelled job is only winding down; its result will never arrive.
+		if (Job->CoalesceKey == CoalesceKey && !Job->IsCancelled())
+		{
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+void FChordJobScheduler::PumpQueue()
+{
+	auto IsInteractive = [](const FChordJobRef& Job)
+	{
+		return Job->GetPriority() == EComfyJobPriority::Interactive;
+	};
+
+	// Background work keeps a slot free so an interactive request never waits behind speculative work. A single
+	// slot has none to spare: it is lent to background work while nothing else runs, and an interactive job that
+	// arrives meanwhile starts next to the borrower instead of waiting for it.
+	const int32 MaxConcurrentJobs = FMath::Max(1, GetDefault<UChordPBRSettings>()->MaxConcurrentJobs);
+	const int32 MaxBackgroundJobs = FMath::Max(1, MaxConcurrentJobs - 1);
+	while (PendingJobs.Num() > 0)
+	{
+		int32 NextIndex = PendingJobs.IndexOfByPredicate(IsInteractive);
+		if (NextIndex != INDEX_NONE)
+		{
+			const int32 NumOccupied = MaxConcurrentJobs == 1 ? RunningJobs.FilterByPredicate(IsInteractive).Num() : RunningJobs.Num();
+			if (NumOccupied >= MaxConcurrentJobs)
+			{
+				break;
+			}
+		}
+		else if (RunningJobs.Num() >= MaxBackgroundJobs)
+		{
+			break;
+		}
+		else
+		{
+			NextIndex = 0;
+		}
+
+		const FChordJobRef Job = PendingJobs[NextIndex];
+		PendingJobs.RemoveAt(NextIndex);
+		RunningJobs.Add(Job);
+
+		Job->State = EChordJobState::Running;
+		Job->StartTime = FPlatformTime::Seconds();
+		JobChangedEvent.Broadcast(Job);
+		RunStage(Job, 0);
+	}
+}
+
+void FChordJobScheduler::RunStage(const FChordJobRef& Job, int32 StageIndex)
+{
+	if (!Job->Stages.IsValidIndex(StageIndex))
+	{
+		FinishJob(Job, EChordJobState::Succeeded, FString());
+		return;
+	}
+
+	TFunction<void()> Body = [this, Job, StageIndex]()
+	{
+		if (Job->IsCancelled())
+		{
+			FinishJob(Job, EChordJobState::Cancelled, TEXT("Cancelled."));
+			return;
+		}
+
+		const FChordJobStage& Stage = Job->Stages[StageIndex];
+		FChordJobJournal::Get().UpdateStage(Job->GetJournalId(), Stage.Name);
+		const double StageStart = FPlatformTime::Seconds();
+		FString Error;
+		const bool bSucceeded = Stage.Run(*Job, Error);
+
+		FChordJobStageTiming& Timing = Job->StageTimings.AddDefaulted_GetRef();
+		Timing.Name = Stage.Name;
+		Timing.Seconds = FPlatformTime::Seconds() - StageStart;
+
+		if (Job->IsCancelled())
+		{
+			FinishJob(Job, EChordJobState::Cancelled, TEXT("Cancelled."));
+		}
+		else if (!bSucceeded)
+		{
+			FinishJob(Job, EChordJobState::Failed, Error.IsEmpty() ? FString::Printf(TEXT("%s failed."), *Stage.Name) : Error);
+		}
+		else
+		{
+			RunStage(Job, StageIndex + 1);
+		}
+	};
+
+	// Counted until the body and its reference to the job are gone; the next stage is counted before this one ends.
+	++NumStagesInFlight;
+	TFunction<void()> Tracked = [this, Body = MoveTemp(Body)]() mutable
+	{
+		Body();
+		Body.Reset();
+		--NumStagesInFlight;
+	};
+
+	if (Job->Stages[StageIndex].bGameThread)
+	{
+		AsyncTask(ENamedThreads::GameThread, MoveTemp(Tracked));
+	}
+	else
+	{
+		Async(EAsyncExecution::ThreadPool, MoveTemp(Tracked));
+	}
+}
+
+void FChordJobScheduler::FinishJob(const FChordJobRef& Job, EChordJobState FinalState, const FString& Error)
+{
+	if (!IsInGameThread())
+	{
+		AsyncTask(ENamedThreads::GameThread, [this, Job, FinalState, Error]()
+		{
+			FinishJob(Job, FinalState, Error);
+		});
+		return;
+	}
+
+	if (Job->IsFinished())
+	{
+		return;
+	}
+
+	Job->State = FinalState;
+	Job->Error = Error;
+	{
+		FScopeLock Lock(&Job->Mutex);
+		Job->Status = FinalState == EChordJobState::Succeeded ? TEXT("Done.") : Error;
+	}
+	PendingJobs.Remove(Job);
+	RunningJobs.Remove(Job);
+
+	// A detached job's prompt is still running on the server; keep its entry for the next session.
+	if (!Job->IsDetached())
+	{
+		FChordJobJournal::Get().Remove(Job->GetJournalId());
+	}
+
+	FString Timings;
+	for (const FChordJobStageTiming& Timing : Job->StageTimings)
+	{
+		Timings += FString::Printf(TEXT("%s%s %.2fs"), Timings.IsEmpty() ? TEXT("") : TEXT(", "), *Timing.Name, Timing.Seconds);
+	}
+	const double TotalSeconds = Job->StartTime > 0.0 ? FPlatformTime::Seconds() - Job->StartTime : 0.0;
+	UE_LOG(LogChordPBRGenerator, Log, TEXT("Job %s %s in %.2fs (%s)%s%s"), *Job->GetId().ToString(), LexJobState(FinalState), TotalSeconds,
+		Timings.IsEmpty() ? TEXT("no stages run") : *Timings, Error.IsEmpty() ? TEXT("") : TEXT(": "), *Error);
+
+	JobChangedEvent.Broadcast(Job);
+	PumpQueue();
+}
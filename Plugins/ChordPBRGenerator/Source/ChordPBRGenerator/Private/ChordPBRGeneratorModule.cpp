@@ -2,6 +2,7 @@
 
 #include "ChordPBRGeneratorModule.h"
 
+#include "ChordJobScheduler.h"
 #include "ChordPBRSettings.h"
 #include "ChordPBRSettingsCustomization.h"
 #include "LevelEditor.h"
@@ -40,6 +41,9 @@ void FChordPBRGeneratorModule::StartupModule()
 
 void FChordPBRGeneratorModule::ShutdownModule()
 {
+	// Prompts already queued on a server keep running; the job journal lets the next session collect them.
+	FChordJobScheduler::Get().DetachAll();
+
 	if (FModuleManager::Get().IsModuleLoaded(TEXT("PropertyEditor")))
 	{
 		FPropertyEditorModule& PropertyModule = FModuleManager::GetModuleChecked<FPropertyEditorModule>(TEXT("PropertyEditor"));
@@ -11,6 +11,7 @@ int32 FChordPBRSession::AddGeneratedImage(UTexture2D* Texture, const FString& La
 	}
 
 	FChordGeneratedImageItem Item;
+	Item.Id = FGuid::NewGuid();
 	Item.Image = TStrongObjectPtr<UTexture2D>(Texture);
 	const FString BaseLabel = Label.IsEmpty() ? Texture->GetName() : FPaths::GetBaseFilename(Label);
 	const FString SafeLabel = FPaths::MakeValidFileName(BaseLabel);
@@ -65,6 +66,14 @@ FChordGeneratedImageItem* FChordPBRSession::GetMutableImageItem(int32 ImageIndex
 	return GeneratedImages.IsValidIndex(ImageIndex) ? &GeneratedImages[ImageIndex] : nullptr;
 }
 
+int32 FChordPBRSession::FindImageIndexById(const FGuid& ImageId) const
+{
+	return GeneratedImages.IndexOfByPredicate([&ImageId](const FChordGeneratedImageItem& Item)
+	{
+		return Item.Id == ImageId;
+	});
+}
+
 void FChordPBRSession::Reset()
 {
 	GeneratedImages.Empty();
@@ -15,9 +15,29 @@ UChordPBRSettings::UChordPBRSettings()
 
 	// ComfyUI Settings
 	ComfyHttpBaseUrl = TEXT("http://127.0.0.1:8188");
-	RequestTimeoutSeconds = 300.0f;
+	MaxQueueDepthPerServer = 8;
+	MaxConcurrentJobs = 2;
+	MaxBackgroundQueueDepth = 1;
+	bSpeculativePBRForNewImages = false;
+	bPreUploadSourceImages = true;
+	MaxChordBatchSize = 4;
+	ChordInputResolution = 1024;
+	ChordTileSize = 0;
+	ChordTileOverlap = 128;
+	ConnectTimeoutSeconds = 5.0f;
+	RequestTimeoutSeconds = 60.0f;
+	ExecutionTimeoutSeconds = 600.0f;
+	JobTimeoutSeconds = 900.0f;
 	bUseWebSocketProgress = true;
 	PollingFallbackIntervalSeconds = 0.5f;
+	MaxRequestRetries = 3;
+	RetryBaseDelaySeconds = 0.5f;
+	CircuitBreakerFailureThreshold = 5;
+	CircuitBreakerCooldownSeconds = 15.0f;
+	bStreamChordOutputsOverWebSocket = false;
+	bProbeServerOnTabOpen = true;
+	bWarmUpModelsOnTabOpen = false;
+	WarmUpIntervalMinutes = 0.0f;
 
 	SavedCacheRoot = FPaths::ConvertRelativePathToFull(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("ChordPBRGenerator")));
 
@@ -32,6 +52,20 @@ UChordPBRSettings::UChordPBRSettings()
 		ChordImg2PbrApiPromptPath = TEXT("Resources/chord_image_to_material.json");
 	}
 
+	// The bundled templates, fastest first, with the nodes each one takes its prompt and seed on.
+	auto AddRouteTemplate = [this](const TCHAR* File, const TCHAR* PromptNode, const TCHAR* PromptInput, const TCHAR* SeedNode, EChordQualityTier Quality)
+	{
+		FChordTxt2ImgRouteTemplate& Route = Txt2ImgRouteTemplates.AddDefaulted_GetRef();
+		Route.TemplatePath = FPaths::Combine(FPaths::GetPath(Txt2ImgApiPromptPath), File);
+		Route.Binding.PromptNodeIdentifier = PromptNode;
+		Route.Binding.PromptInputName = PromptInput;
+		Route.Binding.SeedNodeIdentifier = SeedNode;
+		Route.Quality = Quality;
+	};
+	AddRouteTemplate(TEXT("chord_zimage_turbo_t2i.json"), TEXT("4"), TEXT("text"), TEXT("7"), EChordQualityTier::Draft);
+	AddRouteTemplate(TEXT("chord_sdxl_t2i_text_to_image.json"), TEXT("2"), TEXT("text"), TEXT("4"), EChordQualityTier::Standard);
+	AddRouteTemplate(TEXT("chord_flux_t2i.json"), TEXT("20"), TEXT("value"), TEXT("6"), EChordQualityTier::High);
+
 	PreviewMasterMaterial = FSoftObjectPath(TEXT("/ChordPBRGenerator/Preview/M_PreviewPBR.M_PreviewPBR"));
 	DefaultSaveRootPath = TEXT("/Game/ChordPBR");
 	InstanceMasterMaterial = TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(TEXT("/ChordPBRGenerator/Preview/M_PreviewPBR.M_PreviewPBR")));
@@ -42,6 +76,12 @@ UChordPBRSettings::UChordPBRSettings()
 	Txt2ImgBinding.SeedNodeIdentifier = TEXT("4");
 	Txt2ImgBinding.SeedInputName = TEXT("seed");
 
+	// Matches chord_zimage_turbo_t2i.json, the intended draft template.
+	DraftTxt2ImgBinding.PromptNodeIdentifier = TEXT("4");
+	DraftTxt2ImgBinding.PromptInputName = TEXT("text");
+	DraftTxt2ImgBinding.SeedNodeIdentifier = TEXT("7");
+	DraftTxt2ImgBinding.SeedInputName = TEXT("seed");
+
 	// PBR Generation Bindings
 	ChordBinding.LoadImageNodeId = 2;
 	ChordBinding.LoadImageInputName = TEXT("image");
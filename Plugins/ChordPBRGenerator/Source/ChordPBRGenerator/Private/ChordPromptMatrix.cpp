@@ -0,0 +1,256 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ChordPromptMatrix.h"
+
+namespace
+{
+	// Literal text, or one {a|b} group when Options is set.
+	struct FMatrixSegment
+	{
+		FString Text;
+		TArray<FString> Options;
+		bool bAxis = false;
+	};
+
+	// A range this long is almost certainly a typo; the cell limit would reject it anyway.
+	constexpr int64 MaxSeedRange = 4096;
+
+	bool ParseSeedList(const FString& List, TArray<int32>& OutSeeds, FString& OutError)
+	{
+		TArray<FString> Items;
+		List.ParseIntoArray(Items, TEXT(","));
+		for (FString Item : Items)
+		{
+			Item.TrimStartAndEndInline();
+			FString FirstText = Item;
+			FString LastText = Item;
+			Item.Split(TEXT("-"), &FirstText, &LastText);
+			FirstText.TrimStartAndEndInline();
+			LastText.TrimStartAndEndInline();
+			if (!FirstText.IsNumeric() || !LastText.IsNumeric())
+			{
+				OutError = FString::Printf(TEXT("Invalid seed '%s'."), *Item);
+				return false;
+			}
+
+			const int64 First = FCString::Atoi64(*FirstText);
+			const int64 Last = FCString::Atoi64(*LastText);
+			if (First < 0 || Last < First || Last > MAX_int32 || Last - First >= MaxSeedRange)
+			{
+				OutError = FString::Printf(TEXT("Invalid seed range '%s'."), *Item);
+				return false;
+			}
+			for (int64 Seed = First; Seed <= Last; ++Seed)
+			{
+				OutSeeds.AddUnique(static_cast<int32>(Seed));
+			}
+		}
+
+		if (OutSeeds.Num() == 0)
+		{
+			OutError = TEXT("The seed group lists no seeds.");
+			return false;
+		}
+		return true;
+	}
+
+	bool ParseTemplate(const FString& Template, TArray<FMatrixSegment>& OutSegments, TArray<int32>& OutSeeds, FString& OutError)
+	{
+		int32 Position = 0;
+		while (Position < Template.Len())
+		{
+			const int32 Open = Template.Find(TEXT("{"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Position);
+			const int32 StrayClose = Template.Find(TEXT("}"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Position);
+			if (StrayClose != INDEX_NONE && (Open == INDEX_NONE || StrayClose < Open))
+			{
+				OutError = TEXT("Unbalanced '}' in the prompt.");
+				return false;
+			}
+			if (Open == INDEX_NONE)
+			{
+				OutSegments.AddDefaulted_GetRef().Text = Template.Mid(Position);
+				break;
+			}
+
+			const int32 Close = Template.Find(TEXT("}"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Open + 1);
+			const int32 NestedOpen = Template.Find(TEXT("{"), ESearchCase::CaseSensitive, ESearchDir::FromStart, Open + 1);
+			if (Close == INDEX_NONE || (NestedOpen != INDEX_NONE && NestedOpen < Close))
+			{
+				OutError = TEXT("Unbalanced '{' in the prompt; groups cannot be nested.");
+				return false;
+			}
+
+			OutSegments.AddDefaulted_GetRef().Text = Template.Mid(Position, Open - Position);
+			const FString Group = Template.Mid(Open + 1, Close - Open - 1);
+			if (Group.TrimStart().StartsWith(TEXT("seed:")))
+			{
+				if (OutSeeds.Num() > 0)
+				{
+					OutError = TEXT("Only one {seed:...} group is allowed.");
+					return false;
+				}
+				FString SeedList;
+				Group.Split(TEXT(":"), nullptr, &SeedList);
+				if (!ParseSeedList(SeedList, OutSeeds, OutError))
+				{
+					return false;
+				}
+			}
+			else if (Group.TrimStartAndEnd().IsEmpty())
+			{
+				OutError = TEXT("Empty {} group in the prompt; write {a|b} or drop the braces.");
+				return false;
+			}
+			else
+			{
+				FMatrixSegment& Axis = OutSegments.AddDefaulted_GetRef();
+				Axis.bAxis = true;
+				Group.ParseIntoArray(Axis.Options, TEXT("|"), false);
+				for (FString& Option : Axis.Options)
+				{
+					Option.TrimStartAndEndInline();
+				}
+			}
+			Position = Close + 1;
+		}
+		return true;
+	}
+
+	// Runs of whitespace become one space, so "{a |a}" or an empty option do not produce distinct prompts.
+	FString NormalizePrompt(const FString& Prompt)
+	{
+		FString Normalized;
+		Normalized.Reserve(Prompt.Len());
+		bool bPendingSpace = false;
+		for (const TCHAR Char : Prompt)
+		{
+			if (FChar::IsWhitespace(Char))
+			{
+				bPendingSpace = !Normalized.IsEmpty();
+				continue;
+			}
+			if (bPendingSpace)
+			{
+				Normalized.AppendChar(TEXT(' '));
+				bPendingSpace = false;
+			}
+			Normalized.AppendChar(Char);
+		}
+		return Normalized;
+	}
+
+	// Labels end up in file names and filename_prefix, so only [A-Za-z0-9_-] survives; spaces become dashes.
+	FString MakeLabelPart(const FString& Value)
+	{
+		FString Part;
+		for (const TCHAR Char : NormalizePrompt(Value))
+		{
+			if (Char == TEXT(' '))
+			{
+				Part.AppendChar(TEXT('-'));
+			}
+			else if (Char < 128 && (FChar::IsAlnum(Char) || Char == TEXT('_') || Char == TEXT('-')))
+			{
+				Part.AppendChar(Char);
+			}
+		}
+		Part.LeftInline(24);
+		return Part.IsEmpty() ? TEXT("none") : Part;
+	}
+}
+
+bool FChordPromptMatrix::Expand(const FString& Template, int32 MaxCells, TArray<FChordPromptMatrixCell>& OutCells, FString& OutError)
+{
+	OutCells.Reset();
+	TArray<FMatrixSegment> Segments;
+	TArray<int32> Seeds;
+	if (!ParseTemplate(Template, Segments, Seeds, OutError))
+	{
+		return false;
+	}
+	if (Seeds.Num() == 0)
+	{
+		Seeds.Add(-1);
+	}
+
+	TArray<const FMatrixSegment*> Axes;
+	int64 NumCombinations = Seeds.Num();
+	for (const FMatrixSegment& Segment : Segments)
+	{
+		if (Segment.bAxis)
+		{
+			Axes.Add(&Segment);
+			NumCombinations *= Segment.Options.Num();
+			if (NumCombinations > MaxCells)
+			{
+				OutError = FString::Printf(TEXT("The prompt matrix has more than %d combinations."), MaxCells);
+				return false;
+			}
+		}
+	}
+	if (NumCombinations == 0)
+	{
+		OutError = TEXT("The prompt matrix has no combinations.");
+		return false;
+	}
+
+	// Odometer over the axes; the seed is the slowest digit so each seed's grid completes before the next.
+	TArray<int32> Picks;
+	Picks.SetNumZeroed(Axes.Num());
+	TSet<FString> SeenKeys;
+	for (const int32 Seed : Seeds)
+	{
+		for (bool bMore = true; bMore; )
+		{
+			FChordPromptMatrixCell Cell;
+			Cell.Seed = Seed;
+			FString Prompt;
+			int32 AxisIdx = 0;
+			for (const FMatrixSegment& Segment : Segments)
+			{
+				if (!Segment.bAxis)
+				{
+					Prompt += Segment.Text;
+					continue;
+				}
+				const FString& Value = Segment.Options[Picks[AxisIdx++]];
+				Prompt += Value;
+				Cell.AxisValues.Add(Value);
+			}
+			Cell.Prompt = NormalizePrompt(Prompt);
+
+			bool bAlreadySeen = false;
+			SeenKeys.Add(FString::Printf(TEXT("%d|%s"), Seed, *Cell.Prompt), &bAlreadySeen);
+			if (!bAlreadySeen)
+			{
+				OutCells.Add(MoveTemp(Cell));
+			}
+
+			bMore = false;
+			for (int32 Digit = Axes.Num() - 1; Digit >= 0; --Digit)
+			{
+				if (++Picks[Digit] < Axes[Digit]->Options.Num())
+				{
+					bMore = true;
+					break;
+				}
+				Picks[Digit] = 0;
+			}
+		}
+	}
+	return true;
+}
+
+FString FChordPromptMatrix::MakeLabel(const FString& BaseLabel, const FChordPromptMatrixCell& Cell)
+{
+	FString Label = BaseLabel;
+	for (const FString& Value : Cell.AxisValues)
+	{
+		Label += TEXT("_") + MakeLabelPart(Value);
+	}
+	if (Cell.Seed >= 0)
+	{
+		Label += FString::Printf(TEXT("_s%d"), Cell.Seed);
+	}
+	return Label;
+}
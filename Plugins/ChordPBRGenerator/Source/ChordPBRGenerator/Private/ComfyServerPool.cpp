@@ -0,0 +1,124 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#include "ComfyServerPool.h"
+
+#include "ChordPBRGeneratorModule.h"
+#include "ChordPBRSettings.h"
+#include "ComfyUIClient.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+	struct FServerProbe
+	{
+		TSharedPtr<FComfyUIClient> Client;
+		FComfyServerLoad Load;
+		bool bReachable = false;
+		FString Error;
+	};
+
+	FString NormalizeServerUrl(const FString& Url)
+	{
+		FString Clean = Url.TrimStartAndEnd();
+		Clean.RemoveFromEnd(TEXT("/"));
+		return Clean;
+	}
+}
+
+FComfyServerPool& FComfyServerPool::Get()
+{
+	static FComfyServerPool Pool;
+	return Pool;
+}
+
+TArray<FString> FComfyServerPool::GetServerUrls(const UChordPBRSettings& Settings)
+{
+	TArray<FString> Urls;
+	Urls.Add(NormalizeServerUrl(Settings.ComfyHttpBaseUrl));
+	for (const FString& Url : Settings.AdditionalComfyHttpBaseUrls)
+	{
+		const FString Clean = NormalizeServerUrl(Url);
+		if (!Clean.IsEmpty())
+		{
+			Urls.AddUnique(Clean);
+		}
+	}
+	return Urls;
+}
+
+TSharedPtr<FComfyUIClient> FComfyServerPool::AcquireClient(const TSharedRef<FComfyUIClient>& DefaultClient, const UChordPBRSettings& Settings, const FString& TemplateKey, FString& OutError)
+{
+	const TArray<FString> Urls = GetServerUrls(Settings);
+	if (Urls.Num() <= 1)
+	{
+		return DefaultClient;
+	}
+
+	// Probe inline: this already runs on a pool worker, and parking it on further pool tasks can starve the pool.
+	// Each probe is a Quick request, so an unreachable server costs at most one short timeout.
+	TArray<FServerProbe> Reachable;
+	TArray<FString> Errors;
+	for (const FString& Url : Urls)
+	{
+		FServerProbe Probe;
+		Probe.Client = DefaultClient->WithBaseUrl(Url);
+		Probe.bReachable = Probe.Client->GetServerLoad(Probe.Load, Probe.Error);
+		if (Probe.bReachable)
+		{
+			Reachable.Add(MoveTemp(Probe));
+		}
+		else
+		{
+			Errors.Add(FString::Printf(TEXT("%s: %s"), *Url, *Probe.Error));
+		}
+	}
+
+	if (Reachable.Num() == 0)
+	{
+		OutError = FString::Printf(TEXT("No ComfyUI server reachable (%s)"), *FString::Join(Errors, TEXT("; ")));
+		return nullptr;
+	}
+
+	TMap<FString, FString> LastTemplates;
+	{
+		FScopeLock Lock(&Mutex);
+		LastTemplates = LastTemplateByServer;
+	}
+
+	// A server that would have to swap models counts as one prompt deeper than it is.
+	auto Cost = [&LastTemplates, &TemplateKey](const FServerProbe& Probe)
+	{
+		const FString* LastTemplate = LastTemplates.Find(Probe.Client->GetBaseUrl());
+		const bool bWarm = LastTemplate && *LastTemplate == TemplateKey;
+		return Probe.Load.QueueDepth + (bWarm ? 0 : 1);
+	};
+
+	Reachable.Sort([&Cost](const FServerProbe& A, const FServerProbe& B)
+	{
+		const int32 CostA = Cost(A);
+		const int32 CostB = Cost(B);
+		return CostA != CostB ? CostA < CostB : A.Load.VramFreeBytes > B.Load.VramFreeBytes;
+	});
+
+	int32 ShortestQueue = MAX_int32;
+	for (const FServerProbe& Probe : Reachable)
+	{
+		ShortestQueue = FMath::Min(ShortestQueue, Probe.Load.QueueDepth);
+	}
+
+	if (Settings.MaxQueueDepthPerServer > 0 && ShortestQueue >= Settings.MaxQueueDepthPerServer)
+	{
+		OutError = FString::Printf(TEXT("All %d ComfyUI servers are saturated (shortest queue: %d). Try again shortly."), Reachable.Num(), ShortestQueue);
+		return nullptr;
+	}
+
+	const FServerProbe& Best = Reachable[0];
+	UE_LOG(LogChordPBRGenerator, Log, TEXT("Scheduling job on %s (queue %d)."), *Best.Client->GetBaseUrl(), Best.Load.QueueDepth);
+	return Best.Client;
+}
+
+void FComfyServerPool::NoteTemplateQueued(const FString& BaseUrl, const FString& TemplateKey)
+{
+	FScopeLock Lock(&Mutex);
+	LastTemplateByServer.Add(BaseUrl, TemplateKey);
+}
@@ -2,6 +2,8 @@
 
 #include "ComfyUIClient.h"
 
+#include "Async/Async.h"
+#include "ChordPBRGeneratorModule.h"
 #include "HttpModule.h"
 #include "Http.h"
 #include "GenericPlatform/GenericPlatformHttp.h"
@@ -9,6 +11,7 @@
 #include "JsonObjectConverter.h"
 #include "Misc/Base64.h"
 #include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
 #include "Templates/Atomic.h"
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
@@ -16,20 +19,165 @@
 
 namespace
 {
+	// ComfyUI BinaryEventTypes.PREVIEW_IMAGE, used for sampler previews and websocket save nodes.
+	constexpr uint32 ComfyBinaryEventPreviewImage = 1;
+
 	struct FWebSocketWaitState
 	{
-		explicit FWebSocketWaitState(const TSharedRef<FEvent, ESPMode::ThreadSafe>& InEvent)
-			: CompletionEvent(InEvent)
+		FWebSocketWaitState(const TSharedRef<FEvent, ESPMode::ThreadSafe>& InConnectedEvent, const TSharedRef<FEvent, ESPMode::ThreadSafe>& InCompletionEvent)
+			: ConnectedEvent(InConnectedEvent)
+			, CompletionEvent(InCompletionEvent)
+		{
+		}
+
+		// Before the prompt id is known every event is ours: the socket's client id is unique to one prompt.
+		bool MatchesPrompt(const FString& InPromptId)
+		{
+			FScopeLock Lock(&Mutex);
+			return PromptId.IsEmpty() || PromptId == InPromptId;
+		}
+
+		void SetPromptId(const FString& InPromptId)
+		{
+			FScopeLock Lock(&Mutex);
+			PromptId = InPromptId;
+		}
+
+		void SetExpectedOutputNodes(TSet<FString>&& InNodeIds)
 		{
+			FScopeLock Lock(&Mutex);
+			ExpectedOutputNodes = MoveTemp(InNodeIds);
 		}
 
+		TAtomic<bool> bConnected{ false };
 		TAtomic<bool> bDone{ false };
 		TAtomic<bool> bFailed{ false };
+		TAtomic<int32> BinaryFrameCount{ 0 };
 		FCriticalSection Mutex;
 		FString Error;
+		FString PromptId;
+		FString CurrentNode;
+		TArray<uint8> BinaryBuffer;
+		TSharedRef<FJsonObject> Outputs = MakeShared<FJsonObject>();
+		// Nodes that sent binary frames, and the output nodes of the prompt when it was queued by this client.
+		TSet<FString> StreamedNodes;
+		TSet<FString> ExpectedOutputNodes;
+		TSharedRef<FEvent, ESPMode::ThreadSafe> ConnectedEvent;
 		TSharedRef<FEvent, ESPMode::ThreadSafe> CompletionEvent;
 	};
 
+	const TCHAR* CancelledError = TEXT("Cancelled.");
+
+	// Nodes whose results nothing else in the prompt consumes, i.e. the ones that save or preview the outputs.
+	TSet<FString> GetOutputNodeIds(const TSharedPtr<FJsonObject>& Prompt)
+	{
+		TSet<FString> NodeIds;
+		TSet<FString> Consumed;
+		if (!Prompt.IsValid())
+		{
+			return NodeIds;
+		}
+
+		for (const auto& Node : Prompt->Values)
+		{
+			NodeIds.Add(Node.Key);
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+			if (!Node.Value.IsValid() || !Node.Value->TryGetObject(NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+			{
+				continue;
+			}
+
+			// A link is [source node id, output index].
+			for (const auto& Input : (*InputsObj)->Values)
+			{
+				const TArray<TSharedPtr<FJsonValue>>* Link = nullptr;
+				FString SourceId;
+				if (Input.Value.IsValid() && Input.Value->TryGetArray(Link) && Link->Num() == 2 && (*Link)[0].IsValid() && (*Link)[0]->TryGetString(SourceId))
+				{
+					Consumed.Add(SourceId);
+				}
+			}
+		}
+		return NodeIds.Difference(Consumed);
+	}
+
+	// Shared so late completion handlers never trigger an event that was already returned to the pool.
+	TSharedRef<FEvent, ESPMode::ThreadSafe> MakePooledEvent()
+	{
+		return TSharedRef<FEvent, ESPMode::ThreadSafe>(MakeShareable(FPlatformProcess::GetSynchEventFromPool(true), [](FEvent* Event)
+		{
+			FPlatformProcess::ReturnSynchEventToPool(Event);
+		}));
+	}
+
+	// Shared by every client talking to the same server so an unreachable box is detected once, not per job.
+	struct FComfyCircuitState
+	{
+		int32 ConsecutiveFailures = 0;
+		double OpenUntil = 0.0;
+	};
+
+	struct FComfyCircuitRegistry
+	{
+		FCriticalSection Mutex;
+		TMap<FString, FComfyCircuitState> States;
+	};
+
+	FComfyCircuitRegistry& GetCircuitRegistry()
+	{
+		static FComfyCircuitRegistry Registry;
+		return Registry;
+	}
+
+	bool IsCircuitOpen(const FString& ServerUrl, double& OutRemainingSeconds)
+	{
+		FComfyCircuitRegistry& Registry = GetCircuitRegistry();
+		FScopeLock Lock(&Registry.Mutex);
+		const FComfyCircuitState* State = Registry.States.Find(ServerUrl);
+		OutRemainingSeconds = State ? State->OpenUntil - FPlatformTime::Seconds() : 0.0;
+		return OutRemainingSeconds > 0.0;
+	}
+
+	void RecordCircuitResult(const FString& ServerUrl, bool bServerHealthy, int32 FailureThreshold, float CooldownSeconds)
+	{
+		FComfyCircuitRegistry& Registry = GetCircuitRegistry();
+		FScopeLock Lock(&Registry.Mutex);
+		FComfyCircuitState& State = Registry.States.FindOrAdd(ServerUrl);
+		if (bServerHealthy)
+		{
+			State = FComfyCircuitState();
+			return;
+		}
+
+		// Past the threshold a single failed probe after the cooldown re-opens the circuit right away.
+		if (++State.ConsecutiveFailures >= FMath::Max(1, FailureThreshold))
+		{
+			State.OpenUntil = FPlatformTime::Seconds() + CooldownSeconds;
+		}
+	}
+
+	// Background admission to one server. The lock makes the queue-depth check and the reservation atomic, so two
+	// workers cannot both see an idle server; a reservation counts as queued until its submission returns, so the
+	// lock is not held across it.
+	struct FBackgroundAdmission
+	{
+		FCriticalSection Mutex;
+		int32 NumSubmitting = 0;
+	};
+
+	TSharedRef<FBackgroundAdmission, ESPMode::ThreadSafe> GetBackgroundAdmission(const FString& ServerUrl)
+	{
+		static FCriticalSection RegistryMutex;
+		static TMap<FString, TSharedRef<FBackgroundAdmission, ESPMode::ThreadSafe>> Admissions;
+		FScopeLock Lock(&RegistryMutex);
+		if (const TSharedRef<FBackgroundAdmission, ESPMode::ThreadSafe>* Admission = Admissions.Find(ServerUrl))
+		{
+			return *Admission;
+		}
+		return Admissions.Add(ServerUrl, MakeShared<FBackgroundAdmission, ESPMode::ThreadSafe>());
+	}
+
 	FString NormalizeBaseUrl(const FString& Url)
 	{
 		FString Clean = Url;
@@ -55,6 +203,31 @@ namespace
 		return true;
 	}
 
+	void ParseImageArray(const TSharedPtr<FJsonObject>& OutputObj, TArray<FComfyImageReference>& OutImages)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* ImagesArray = nullptr;
+		if (!OutputObj.IsValid() || !OutputObj->TryGetArrayField(TEXT("images"), ImagesArray))
+		{
+			return;
+		}
+
+		for (const TSharedPtr<FJsonValue>& Val : *ImagesArray)
+		{
+			const TSharedPtr<FJsonObject>* ImgObj = nullptr;
+			if (Val->TryGetObject(ImgObj))
+			{
+				FComfyImageReference Ref;
+				(*ImgObj)->TryGetStringField(TEXT("filename"), Ref.Filename);
+				(*ImgObj)->TryGetStringField(TEXT("subfolder"), Ref.Subfolder);
+				(*ImgObj)->TryGetStringField(TEXT("type"), Ref.Type);
+				if (!Ref.Filename.IsEmpty())
+				{
+					OutImages.Add(Ref);
+				}
+			}
+		}
+	}
+
 	void AppendJsonStringValues(const TSharedPtr<FJsonValue>& Value, TArray<FString>& OutStrings)
 	{
 		if (!Value.IsValid())
@@ -90,6 +263,91 @@ namespace
 		}
 	}
 
+	// Reads why ComfyUI refused a prompt: the top-level error and each node that failed validation. Returns false
+	// when the response names neither.
+	bool ParsePromptRejection(const TSharedPtr<FJsonObject>& ResponseObj, TArray<FComfyPromptNodeError>& OutNodeErrors, FString& OutError)
+	{
+		TArray<FString> Messages;
+		FString ErrorString;
+		const TSharedPtr<FJsonObject>* ErrorObj = nullptr;
+		if (ResponseObj->TryGetObjectField(TEXT("error"), ErrorObj))
+		{
+			if ((*ErrorObj)->TryGetStringField(TEXT("message"), ErrorString) && !ErrorString.IsEmpty())
+			{
+				Messages.Add(ErrorString);
+			}
+		}
+		else if (ResponseObj->TryGetStringField(TEXT("error"), ErrorString) && !ErrorString.IsEmpty())
+		{
+			Messages.Add(ErrorString);
+		}
+
+		const TSharedPtr<FJsonObject>* NodeErrorsObj = nullptr;
+		if (ResponseObj->TryGetObjectField(TEXT("node_errors"), NodeErrorsObj) && (*NodeErrorsObj)->Values.Num() > 0)
+		{
+			TArray<FString> NodeErrorMessages;
+			for (const auto& Pair : (*NodeErrorsObj)->Values)
+			{
+				const TSharedPtr<FJsonObject> NodeObj = Pair.Value.IsValid() ? Pair.Value->AsObject() : nullptr;
+				FString ClassType;
+				const TArray<TSharedPtr<FJsonValue>>* Errors = nullptr;
+				if (NodeObj.IsValid())
+				{
+					NodeObj->TryGetStringField(TEXT("class_type"), ClassType);
+					NodeObj->TryGetArrayField(TEXT("errors"), Errors);
+				}
+
+				TArray<FString> Parts;
+				if (Errors && Errors->Num() > 0)
+				{
+					for (const TSharedPtr<FJsonValue>& ErrorVal : *Errors)
+					{
+						const TSharedPtr<FJsonObject> ErrorEntry = ErrorVal.IsValid() ? ErrorVal->AsObject() : nullptr;
+						FComfyPromptNodeError& NodeError = OutNodeErrors.AddDefaulted_GetRef();
+						NodeError.NodeId = Pair.Key;
+						NodeError.ClassType = ClassType;
+						if (!ErrorEntry.IsValid())
+						{
+							continue;
+						}
+
+						const TSharedPtr<FJsonObject>* ExtraInfo = nullptr;
+						if (ErrorEntry->TryGetObjectField(TEXT("extra_info"), ExtraInfo))
+						{
+							(*ExtraInfo)->TryGetStringField(TEXT("input_name"), NodeError.InputName);
+						}
+
+						FString Message;
+						FString Details;
+						ErrorEntry->TryGetStringField(TEXT("message"), Message);
+						ErrorEntry->TryGetStringField(TEXT("details"), Details);
+						Parts.Add(Details.IsEmpty() ? Message : FString::Printf(TEXT("%s (%s)"), *Message, *Details));
+					}
+				}
+				else
+				{
+					FComfyPromptNodeError& NodeError = OutNodeErrors.AddDefaulted_GetRef();
+					NodeError.NodeId = Pair.Key;
+					NodeError.ClassType = ClassType;
+					AppendJsonStringValues(Pair.Value, Parts);
+				}
+
+				const FString Summary = Parts.Num() > 0 ? FString::Join(Parts, TEXT(" | ")) : TEXT("Unknown error");
+				NodeErrorMessages.Add(ClassType.IsEmpty()
+					? FString::Printf(TEXT("%s: %s"), *Pair.Key, *Summary)
+					: FString::Printf(TEXT("%s (%s): %s"), *Pair.Key, *ClassType, *Summary));
+			}
+			Messages.Add(FString::Printf(TEXT("Prompt node errors: %s"), *FString::Join(NodeErrorMessages, TEXT("; "))));
+		}
+
+		if (Messages.Num() == 0)
+		{
+			return false;
+		}
+		OutError = FString::Join(Messages, TEXT(" "));
+		return true;
+	}
+
 	bool TryExtractHistoryError(const TSharedPtr<FJsonObject>& History, const FString& PromptId, FString& OutError)
 	{
 		if (!History.IsValid())
@@ -147,68 +405,210 @@ namespace
 	}
 }
 
-FComfyUIClient::FComfyUIClient(const UChordPBRSettings& InSettings)
+FComfyUIClient::FComfyUIClient(const UChordPBRSettings& InSettings, const FChordCancellationTokenPtr& InCancellationToken)
+	: CancellationToken(InCancellationToken)
 {
 	BaseUrl = NormalizeBaseUrl(InSettings.ComfyHttpBaseUrl);
+	ConnectTimeoutSeconds = InSettings.ConnectTimeoutSeconds;
 	RequestTimeoutSeconds = InSettings.RequestTimeoutSeconds;
+	ExecutionTimeoutSeconds = InSettings.ExecutionTimeoutSeconds;
+	JobTimeoutSeconds = InSettings.JobTimeoutSeconds;
+	if (JobTimeoutSeconds > 0.0f)
+	{
+		JobDeadline = FPlatformTime::Seconds() + JobTimeoutSeconds;
+	}
+	MaxBackgroundQueueDepth = InSettings.MaxBackgroundQueueDepth;
 	bUseWebSocket = InSettings.bUseWebSocketProgress;
 	PollingIntervalSeconds = InSettings.PollingFallbackIntervalSeconds;
+	MaxRetries = InSettings.MaxRequestRetries;
+	RetryBaseDelaySeconds = InSettings.RetryBaseDelaySeconds;
+	CircuitFailureThreshold = InSettings.CircuitBreakerFailureThreshold;
+	CircuitCooldownSeconds = InSettings.CircuitBreakerCooldownSeconds;
 }
 
-bool FComfyUIClient::ExecuteJsonRequestBlocking(const FString& Url, const FString& Verb, const FString& ContentType, const FString& Body, FHttpResponsePtr& OutResponse, FString& OutError) const
+TSharedRef<FComfyUIClient> FComfyUIClient::WithBaseUrl(const FString& InBaseUrl) const
 {
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
-	Request->SetURL(Url);
-	Request->SetVerb(Verb);
-	Request->SetHeader(TEXT("Content-Type"), ContentType);
-	if (!Body.IsEmpty())
+	TSharedRef<FComfyUIClient> Clone = MakeShared<FComfyUIClient>(*this);
+	Clone->BaseUrl = NormalizeBaseUrl(InBaseUrl);
+	return Clone;
+}
+
+EComfyJobPriority FComfyUIClient::GetJobPriority() const
+{
+	return PromotionSignal.IsValid() && PromotionSignal->IsCancelled() ? EComfyJobPriority::Interactive : Priority;
+}
+
+bool FComfyUIClient::IsCancelled() const
+{
+	return CancellationToken.IsValid() && CancellationToken->IsCancelled();
+}
+
+double FComfyUIClient::MakeDeadline(float StageTimeoutSeconds) const
+{
+	return FMath::Min(FPlatformTime::Seconds() + StageTimeoutSeconds, JobDeadline);
+}
+
+FString FComfyUIClient::DescribeTimeout(const TCHAR* Stage, float StageTimeoutSeconds) const
+{
+	if (FPlatformTime::Seconds() >= JobDeadline)
 	{
-		Request->SetContentAsString(Body);
+		return FString::Printf(TEXT("%s: job deadline exceeded."), Stage);
 	}
+	return FString::Printf(TEXT("%s timed out after %.0fs."), Stage, StageTimeoutSeconds);
+}
 
-	FEvent* CompletionEvent = FPlatformProcess::GetSynchEventFromPool(true);
-	Request->OnProcessRequestComplete().BindLambda([&OutResponse, CompletionEvent](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bSuccess)
+bool FComfyUIClient::ExecuteJsonRequestBlocking(const FString& Url, const FString& Verb, const FString& ContentType, const FString& Body, FHttpResponsePtr& OutResponse, FString& OutError, EComfyRequestFlags Flags) const
+{
+	return ExecuteWithRetries([&]()
 	{
-		if (bSuccess)
+		TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+		Request->SetURL(Url);
+		Request->SetVerb(Verb);
+		Request->SetHeader(TEXT("Content-Type"), ContentType);
+		if (!Body.IsEmpty())
+		{
+			Request->SetContentAsString(Body);
+		}
+		return Request;
+	}, OutResponse, OutError, Flags);
+}
+
+bool FComfyUIClient::ExecuteBinaryRequestBlocking(const FString& Url, const FString& Verb, const TArray<uint8>& Body, FHttpResponsePtr& OutResponse, FString& OutError, const FString& ContentType, EComfyRequestFlags Flags) const
+{
+	return ExecuteWithRetries([&]()
+	{
+		TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+		Request->SetURL(Url);
+		Request->SetVerb(Verb);
+		Request->SetHeader(TEXT("Content-Type"), ContentType);
+		Request->SetContent(Body);
+		return Request;
+	}, OutResponse, OutError, Flags);
+}
+
+bool FComfyUIClient::ExecuteWithRetries(TFunctionRef<TSharedRef<IHttpRequest, ESPMode::ThreadSafe>()> MakeRequest, FHttpResponsePtr& OutResponse, FString& OutError, EComfyRequestFlags Flags) const
+{
+	const bool bCancellable = EnumHasAnyFlags(Flags, EComfyRequestFlags::Cancellable);
+	const int32 MaxAttempts = EnumHasAnyFlags(Flags, EComfyRequestFlags::Idempotent) ? 1 + FMath::Max(0, MaxRetries) : 1;
+
+	for (int32 Attempt = 0; ; ++Attempt)
+	{
+		double RemainingSeconds = 0.0;
+		if (IsCircuitOpen(BaseUrl, RemainingSeconds))
+		{
+			OutError = FString::Printf(TEXT("ComfyUI server %s is not responding; retrying in %.0fs."), *BaseUrl, FMath::CeilToDouble(RemainingSeconds));
+			return false;
+		}
+
+		const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = MakeRequest();
+		FHttpResponsePtr Response;
+		FString AttemptError;
+		const float TimeoutSeconds = EnumHasAnyFlags(Flags, EComfyRequestFlags::Quick) ? ConnectTimeoutSeconds : RequestTimeoutSeconds;
+
+		// Out of time before anything was sent: that says nothing about the server, so the breaker is left alone.
+		if (bCancellable && MakeDeadline(TimeoutSeconds) <= FPlatformTime::Seconds())
+		{
+			OutError = DescribeTimeout(*Request->GetURL(), TimeoutSeconds);
+			return false;
+		}
+
+		const bool bResponded = ProcessRequestBlocking(Request, Response, AttemptError, bCancellable, TimeoutSeconds);
+		if (bCancellable && IsCancelled())
+		{
+			OutError = CancelledError;
+			return false;
+		}
+
+		// A 429 proves the server is up; only silence and 5xx count against the breaker.
+		const int32 Code = bResponded ? Response->GetResponseCode() : 0;
+		RecordCircuitResult(BaseUrl, bResponded && Code < 500, CircuitFailureThreshold, CircuitCooldownSeconds);
+
+		const bool bTransient = !bResponded || Code == 429 || Code >= 500;
+		if (!bTransient || Attempt + 1 >= MaxAttempts || (bCancellable && FPlatformTime::Seconds() >= JobDeadline))
 		{
 			OutResponse = Response;
+			OutError = AttemptError;
+			return bResponded;
 		}
-		CompletionEvent->Trigger();
-	});
 
-	if (!Request->ProcessRequest())
+		const FString Reason = bResponded ? FString::Printf(TEXT("HTTP %d"), Code) : AttemptError;
+		UE_LOG(LogChordPBRGenerator, Warning, TEXT("%s %s failed (%s); retry %d/%d."), *Request->GetVerb(), *Request->GetURL(), *Reason, Attempt + 1, MaxAttempts - 1);
+
+		if (!WaitBeforeRetry(Attempt, Response, bCancellable))
+		{
+			OutError = CancelledError;
+			return false;
+		}
+	}
+}
+
+bool FComfyUIClient::WaitBeforeRetry(int32 Attempt, const FHttpResponsePtr& Response, bool bCancellable) const
+{
+	constexpr float MaxDelaySeconds = 30.0f;
+	const float Backoff = FMath::Min(RetryBaseDelaySeconds * FMath::Pow(2.0f, static_cast<float>(Attempt)), MaxDelaySeconds);
+
+	// Half fixed, half random, so editors that lost the server together do not reconnect in lockstep.
+	float DelaySeconds = Backoff * 0.5f + FMath::FRandRange(0.0f, Backoff * 0.5f);
+
+	const FString RetryAfter = Response.IsValid() ? Response->GetHeader(TEXT("Retry-After")) : FString();
+	if (RetryAfter.IsNumeric())
 	{
-		OutError = FString::Printf(TEXT("Failed to start HTTP request: %s"), *Url);
-		FPlatformProcess::ReturnSynchEventToPool(CompletionEvent);
-		return false;
+		DelaySeconds = FMath::Clamp(FCString::Atof(*RetryAfter), DelaySeconds, MaxDelaySeconds);
 	}
 
-	CompletionEvent->Wait(static_cast<uint32>(RequestTimeoutSeconds * 1000.0f));
-	FPlatformProcess::ReturnSynchEventToPool(CompletionEvent);
+	TSharedRef<FEvent, ESPMode::ThreadSafe> WakeEvent = MakePooledEvent();
+	FChordCancellationToken::FScopedCallback CancelHook(bCancellable ? CancellationToken : FChordCancellationTokenPtr(), [WakeEvent]()
+	{
+		WakeEvent->Trigger();
+	});
+	WakeEvent->Wait(static_cast<uint32>(DelaySeconds * 1000.0f));
+
+	return !(bCancellable && IsCancelled());
+}
 
-	if (!OutResponse.IsValid())
+bool FComfyUIClient::IsPromptKnownToServer(const FString& PromptId) const
+{
+	FString Error;
+	EComfyPromptQueueState State = EComfyPromptQueueState::NotQueued;
+	if (GetPromptQueueState(PromptId, State, Error) && State != EComfyPromptQueueState::NotQueued)
 	{
-		OutError = FString::Printf(TEXT("Request timed out or failed: %s"), *Url);
-		return false;
+		return true;
 	}
 
-	return true;
+	// Checked after the queue so a prompt that finishes in between is still found.
+	TSharedPtr<FJsonObject> History;
+	return GetHistory(PromptId, History, Error) && History.IsValid() && History->HasField(PromptId);
 }
 
-bool FComfyUIClient::ExecuteBinaryRequestBlocking(const FString& Url, const FString& Verb, const TArray<uint8>& Body, FHttpResponsePtr& OutResponse, FString& OutError, const FString& ContentType) const
+bool FComfyUIClient::ProcessRequestBlocking(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request, FHttpResponsePtr& OutResponse, FString& OutError, bool bCancellable, float TimeoutSeconds) const
 {
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
-	Request->SetURL(Url);
-	Request->SetVerb(Verb);
-	Request->SetHeader(TEXT("Content-Type"), ContentType);
-	Request->SetContent(Body);
+	const FString Url = Request->GetURL();
+	if (bCancellable && IsCancelled())
+	{
+		OutError = CancelledError;
+		return false;
+	}
+
+	// Cleanup calls (not cancellable) must still run after the job ran out of time.
+	const double Deadline = bCancellable ? MakeDeadline(TimeoutSeconds) : FPlatformTime::Seconds() + TimeoutSeconds;
+	const double WaitSeconds = Deadline - FPlatformTime::Seconds();
+	if (WaitSeconds <= 0.0)
+	{
+		OutError = DescribeTimeout(*Url, TimeoutSeconds);
+		return false;
+	}
 
-	FEvent* CompletionEvent = FPlatformProcess::GetSynchEventFromPool(true);
-	Request->OnProcessRequestComplete().BindLambda([&OutResponse, CompletionEvent](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bSuccess)
+	// Let the HTTP backend drop the connection itself too, instead of only abandoning the wait.
+	Request->SetTimeout(static_cast<float>(WaitSeconds));
+
+	// The handler can outlive this frame when the wait times out, so it only touches shared state.
+	TSharedRef<FEvent, ESPMode::ThreadSafe> CompletionEvent = MakePooledEvent();
+	TSharedRef<FHttpResponsePtr, ESPMode::ThreadSafe> Result = MakeShared<FHttpResponsePtr, ESPMode::ThreadSafe>();
+	Request->OnProcessRequestComplete().BindLambda([Result, CompletionEvent](FHttpRequestPtr Req, FHttpResponsePtr Response, bool bSuccess)
 	{
 		if (bSuccess)
 		{
-			OutResponse = Response;
+			*Result = Response;
 		}
 		CompletionEvent->Trigger();
 	});
@@ -216,26 +616,41 @@ bool FComfyUIClient::ExecuteBinaryRequestBlocking(const FString& Url, const FStr
 	if (!Request->ProcessRequest())
 	{
 		OutError = FString::Printf(TEXT("Failed to start HTTP request: %s"), *Url);
-		FPlatformProcess::ReturnSynchEventToPool(CompletionEvent);
 		return false;
 	}
 
-	CompletionEvent->Wait(static_cast<uint32>(RequestTimeoutSeconds * 1000.0f));
-	FPlatformProcess::ReturnSynchEventToPool(CompletionEvent);
+	bool bCompleted = false;
+	{
+		FChordCancellationToken::FScopedCallback CancelHook(bCancellable ? CancellationToken : FChordCancellationTokenPtr(), [Request, CompletionEvent]()
+		{
+			Request->CancelRequest();
+			CompletionEvent->Trigger();
+		});
+		bCompleted = CompletionEvent->Wait(static_cast<uint32>(WaitSeconds * 1000.0));
+	}
 
-	if (!OutResponse.IsValid())
+	if (bCancellable && IsCancelled())
 	{
-		OutError = FString::Printf(TEXT("Request timed out or failed: %s"), *Url);
+		OutError = CancelledError;
 		return false;
 	}
 
+	if (!Result->IsValid())
+	{
+		Request->CancelRequest();
+		OutError = bCompleted ? FString::Printf(TEXT("Request failed: %s"), *Url) : DescribeTimeout(*Url, TimeoutSeconds);
+		return false;
+	}
+
+	OutResponse = *Result;
 	return true;
 }
 
 bool FComfyUIClient::HealthCheck(FString& OutError) const
 {
 	FHttpResponsePtr Response;
-	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/system_stats"), TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError))
+	// No retries: a connection test should report the current state, not wait out a backoff.
+	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/system_stats"), TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError, EComfyRequestFlags::Cancellable | EComfyRequestFlags::Quick))
 	{
 		return false;
 	}
@@ -249,7 +664,62 @@ bool FComfyUIClient::HealthCheck(FString& OutError) const
 	return true;
 }
 
-bool FComfyUIClient::QueuePrompt(const TSharedPtr<FJsonObject>& PromptObject, FComfyPromptResponse& OutResponse, FString& OutError) const
+bool FComfyUIClient::GetServerLoad(FComfyServerLoad& OutLoad, FString& OutError) const
+{
+	OutLoad = FComfyServerLoad();
+
+	// GET /prompt only reports the queue length, unlike /queue which returns every queued graph.
+	FHttpResponsePtr Response;
+	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/prompt"), TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError, EComfyRequestFlags::Cancellable | EComfyRequestFlags::Quick))
+	{
+		return false;
+	}
+
+	if (Response->GetResponseCode() != 200)
+	{
+		OutError = FString::Printf(TEXT("Queue info failed (%d)"), Response->GetResponseCode());
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> PromptInfo;
+	if (!ParseJsonResponse(Response, PromptInfo, OutError))
+	{
+		return false;
+	}
+
+	const TSharedPtr<FJsonObject>* ExecInfo = nullptr;
+	if (PromptInfo->TryGetObjectField(TEXT("exec_info"), ExecInfo))
+	{
+		(*ExecInfo)->TryGetNumberField(TEXT("queue_remaining"), OutLoad.QueueDepth);
+	}
+
+	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/system_stats"), TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError, EComfyRequestFlags::Cancellable | EComfyRequestFlags::Quick)
+		|| Response->GetResponseCode() != 200)
+	{
+		// The queue depth alone is still enough to schedule on.
+		return true;
+	}
+
+	TSharedPtr<FJsonObject> Stats;
+	const TArray<TSharedPtr<FJsonValue>>* Devices = nullptr;
+	FString StatsError;
+	if (ParseJsonResponse(Response, Stats, StatsError) && Stats->TryGetArrayField(TEXT("devices"), Devices))
+	{
+		for (const TSharedPtr<FJsonValue>& DeviceValue : *Devices)
+		{
+			const TSharedPtr<FJsonObject>* Device = nullptr;
+			double VramFree = 0.0;
+			if (DeviceValue->TryGetObject(Device) && (*Device)->TryGetNumberField(TEXT("vram_free"), VramFree))
+			{
+				OutLoad.VramFreeBytes = FMath::Max<int64>(OutLoad.VramFreeBytes, 0) + static_cast<int64>(VramFree);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FComfyUIClient::QueuePromptInternal(const TSharedPtr<FJsonObject>& PromptObject, const FString& ClientId, FComfyPromptResponse& OutResponse, FString& OutError) const
 {
 	if (!PromptObject.IsValid())
 	{
@@ -257,62 +727,186 @@ bool FComfyUIClient::QueuePrompt(const TSharedPtr<FJsonObject>& PromptObject, FC
 		return false;
 	}
 
-	const FString ClientId = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	if (GetJobPriority() == EComfyJobPriority::Interactive)
+	{
+		return SubmitPrompt(PromptObject, ClientId, OutResponse, OutError);
+	}
+
+	// Hold background work here rather than on the server, where ComfyUI could only put it ahead of or behind
+	// everything else. Queue depth is re-read under the server's admission lock so concurrent workers see each other.
+	constexpr float AdmissionPollSeconds = 2.0f;
+	TSharedRef<FEvent, ESPMode::ThreadSafe> WakeEvent = MakePooledEvent();
+	FChordCancellationToken::FScopedCallback CancelHook(CancellationToken, [WakeEvent]()
+	{
+		WakeEvent->Trigger();
+	});
+	FChordCancellationToken::FScopedCallback PromotionHook(PromotionSignal, [WakeEvent]()
+	{
+		WakeEvent->Trigger();
+	});
+
+	const TSharedRef<FBackgroundAdmission, ESPMode::ThreadSafe> Admission = GetBackgroundAdmission(BaseUrl);
+	while (!IsCancelled())
+	{
+		// A dead server fails its load probes until the breaker opens; waiting on it would never end.
+		double RemainingSeconds = 0.0;
+		if (IsCircuitOpen(BaseUrl, RemainingSeconds))
+		{
+			OutError = FString::Printf(TEXT("Waiting for background admission: ComfyUI server %s is not responding."), *BaseUrl);
+			return false;
+		}
+		if (FPlatformTime::Seconds() >= JobDeadline)
+		{
+			OutError = TEXT("Waiting for background admission: job deadline exceeded.");
+			return false;
+		}
+
+		bool bReserved = false;
+		if (GetJobPriority() != EComfyJobPriority::Interactive)
+		{
+			FScopeLock Lock(&Admission->Mutex);
+			FComfyServerLoad Load;
+			FString LoadError;
+			bReserved = GetServerLoad(Load, LoadError) && Load.QueueDepth + Admission->NumSubmitting < FMath::Max(1, MaxBackgroundQueueDepth);
+			Admission->NumSubmitting += bReserved ? 1 : 0;
+		}
+
+		if (bReserved || GetJobPriority() == EComfyJobPriority::Interactive)
+		{
+			if (JobTimeoutSeconds > 0.0f)
+			{
+				JobDeadline = FPlatformTime::Seconds() + JobTimeoutSeconds;
+			}
+			const bool bQueued = SubmitPrompt(PromptObject, ClientId, OutResponse, OutError);
+			if (bReserved)
+			{
+				FScopeLock Lock(&Admission->Mutex);
+				--Admission->NumSubmitting;
+			}
+			return bQueued;
+		}
+
+		WakeEvent->Wait(static_cast<uint32>(AdmissionPollSeconds * 1000.0f));
+	}
+
+	OutError = CancelledError;
+	return false;
+}
+
+bool FComfyUIClient::SubmitPrompt(const TSharedPtr<FJsonObject>& PromptObject, const FString& ClientId, FComfyPromptResponse& OutResponse, FString& OutError) const
+{
+	// A client-generated id lets a submission whose response was lost be recognised instead of queued twice.
+	const FString PromptId = FGuid::NewGuid().ToString(EGuidFormats::DigitsWithHyphensLower);
+
 	TSharedPtr<FJsonObject> Payload = MakeShared<FJsonObject>();
 	Payload->SetObjectField(TEXT("prompt"), PromptObject);
 	Payload->SetStringField(TEXT("client_id"), ClientId);
+	Payload->SetStringField(TEXT("prompt_id"), PromptId);
+	if (GetJobPriority() == EComfyJobPriority::Interactive)
+	{
+		Payload->SetBoolField(TEXT("front"), true);
+	}
 
 	FString Body;
 	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Body);
 	FJsonSerializer::Serialize(Payload.ToSharedRef(), Writer);
 
+	OutResponse.NodeErrors.Reset();
 	FHttpResponsePtr Response;
-	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/prompt"), TEXT("POST"), TEXT("application/json"), Body, Response, OutError))
+	const int32 MaxAttempts = 1 + FMath::Max(0, MaxRetries);
+	for (int32 Attempt = 0; ; ++Attempt)
 	{
-		return false;
+		FString AttemptError;
+		const bool bResponded = ExecuteJsonRequestBlocking(BaseUrl + TEXT("/prompt"), TEXT("POST"), TEXT("application/json"), Body, Response, AttemptError, EComfyRequestFlags::Cancellable);
+		const int32 Code = bResponded ? Response->GetResponseCode() : 0;
+		if (bResponded && Code != 429 && Code < 500)
+		{
+			break;
+		}
+
+		if (IsCancelled())
+		{
+			OutError = AttemptError;
+			return false;
+		}
+
+		// Only resubmit once the server has confirmed it never saw this prompt.
+		if (IsPromptKnownToServer(PromptId))
+		{
+			OutResponse.ClientId = ClientId;
+			OutResponse.PromptId = PromptId;
+			return true;
+		}
+
+		if (Attempt + 1 >= MaxAttempts)
+		{
+			OutError = bResponded ? FString::Printf(TEXT("Queue prompt failed (%d)"), Code) : AttemptError;
+			return false;
+		}
+
+		if (!WaitBeforeRetry(Attempt, Response, true))
+		{
+			OutError = CancelledError;
+			return false;
+		}
+		Response.Reset();
 	}
 
+	// A 400 carries the validation errors, such as a LoadImage input naming a file the server does not have.
+	TSharedPtr<FJsonObject> ResponseObj;
 	if (Response->GetResponseCode() != 200)
 	{
-		OutError = FString::Printf(TEXT("Queue prompt failed (%d)"), Response->GetResponseCode());
+		FString Rejection;
+		FString ParseError;
+		if (ParseJsonResponse(Response, ResponseObj, ParseError) && ParsePromptRejection(ResponseObj, OutResponse.NodeErrors, Rejection))
+		{
+			OutError = FString::Printf(TEXT("Queue prompt failed (%d): %s"), Response->GetResponseCode(), *Rejection);
+		}
+		else
+		{
+			OutError = FString::Printf(TEXT("Queue prompt failed (%d)"), Response->GetResponseCode());
+		}
 		return false;
 	}
 
-	TSharedPtr<FJsonObject> ResponseObj;
 	if (!ParseJsonResponse(Response, ResponseObj, OutError))
 	{
 		return false;
 	}
 
-	FString ErrorField;
-	if (ResponseObj->TryGetStringField(TEXT("error"), ErrorField) && !ErrorField.IsEmpty())
+	if (ParsePromptRejection(ResponseObj, OutResponse.NodeErrors, OutError))
 	{
-		OutError = ErrorField;
 		return false;
 	}
 
-	const TSharedPtr<FJsonObject>* NodeErrorsObj = nullptr;
-	if (ResponseObj->TryGetObjectField(TEXT("node_errors"), NodeErrorsObj) && (*NodeErrorsObj)->Values.Num() > 0)
+	OutResponse.ClientId = ClientId;
+	if (!ResponseObj->TryGetStringField(TEXT("prompt_id"), OutResponse.PromptId) || OutResponse.PromptId.IsEmpty())
+	{
+		OutResponse.PromptId = PromptId;
+	}
+	return true;
+}
+
+struct FComfyUIClient::FExecutionSocket
+{
+	~FExecutionSocket()
 	{
-		TArray<FString> NodeErrorMessages;
-		for (const auto& Pair : (*NodeErrorsObj)->Values)
+		if (Socket.IsValid())
 		{
-			TArray<FString> Parts;
-			AppendJsonStringValues(Pair.Value, Parts);
-			const FString Summary = Parts.Num() > 0 ? FString::Join(Parts, TEXT(" | ")) : TEXT("Unknown error");
-			NodeErrorMessages.Add(FString::Printf(TEXT("%s: %s"), *Pair.Key, *Summary));
+			Socket->OnConnected().Clear();
+			Socket->OnMessage().Clear();
+			Socket->OnRawMessage().Clear();
+			Socket->OnConnectionError().Clear();
+			Socket->OnClosed().Clear();
+			Socket->Close();
 		}
-
-		OutError = FString::Printf(TEXT("Prompt node errors: %s"), *FString::Join(NodeErrorMessages, TEXT("; ")));
-		return false;
 	}
 
-	OutResponse.ClientId = ClientId;
-	OutResponse.PromptId = ResponseObj->GetStringField(TEXT("prompt_id"));
-	return true;
-}
+	TSharedPtr<IWebSocket> Socket;
+	TSharedPtr<FWebSocketWaitState, ESPMode::ThreadSafe> State;
+};
 
-bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& ClientId, FString& OutError, TFunction<void(float)> OnProgress) const
+TSharedPtr<FComfyUIClient::FExecutionSocket, ESPMode::ThreadSafe> FComfyUIClient::ConnectExecutionSocket(const FString& ClientId, const FComfyExecutionCallbacks& Callbacks, FString& OutError) const
 {
 	FString WsUrl = BaseUrl.Replace(TEXT("https://"), TEXT("wss://")).Replace(TEXT("http://"), TEXT("ws://"));
 	WsUrl += FString::Printf(TEXT("/ws?clientId=%s"), *ClientId);
@@ -322,16 +916,20 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 		FModuleManager::LoadModuleChecked<FWebSocketsModule>(TEXT("WebSockets"));
 	}
 
-	TSharedRef<FEvent, ESPMode::ThreadSafe> CompletionEventRef =
-		MakeShareable(FPlatformProcess::GetSynchEventFromPool(true), [](FEvent* Event)
-		{
-			FPlatformProcess::ReturnSynchEventToPool(Event);
-		});
-
-	TSharedPtr<FWebSocketWaitState, ESPMode::ThreadSafe> State = MakeShared<FWebSocketWaitState, ESPMode::ThreadSafe>(CompletionEventRef);
+	TSharedPtr<FWebSocketWaitState, ESPMode::ThreadSafe> State = MakeShared<FWebSocketWaitState, ESPMode::ThreadSafe>(MakePooledEvent(), MakePooledEvent());
 	TSharedPtr<IWebSocket> Socket = FWebSocketsModule::Get().CreateWebSocket(WsUrl);
 
-	Socket->OnMessage().AddLambda([State, PromptId, OnProgress](const FString& Message)
+	const TFunction<void(float)> OnProgress = Callbacks.OnProgress;
+	const TFunction<void(const FString&, const TArray<FComfyImageReference>&)> OnOutputImages = Callbacks.OnOutputImages;
+	const TFunction<void(const FString&, const TArray<uint8>&)> OnBinaryImage = Callbacks.OnBinaryImage;
+
+	Socket->OnConnected().AddLambda([State]()
+	{
+		State->bConnected.Store(true);
+		State->ConnectedEvent->Trigger();
+	});
+
+	Socket->OnMessage().AddLambda([State, OnProgress, OnOutputImages](const FString& Message)
 	{
 		TSharedPtr<FJsonObject> Obj;
 		const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Message);
@@ -347,7 +945,7 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 					{
 						FString DataPromptId;
 						(*DataObj)->TryGetStringField(TEXT("prompt_id"), DataPromptId);
-						if (DataPromptId == PromptId)
+						if (State->MatchesPrompt(DataPromptId))
 						{
 							FString ExceptionMessage;
 							FString NodeType;
@@ -388,12 +986,50 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 					const TSharedPtr<FJsonObject>* DataObj = nullptr;
 					if (Obj->TryGetObjectField(TEXT("data"), DataObj))
 					{
-						FString DataPromptId = (*DataObj)->GetStringField(TEXT("prompt_id"));
+						FString DataPromptId;
+						(*DataObj)->TryGetStringField(TEXT("prompt_id"), DataPromptId);
 						bool bNodeNull = !(*DataObj)->HasTypedField<EJson::String>(TEXT("node")) || (*DataObj)->GetStringField(TEXT("node")).IsEmpty();
-						if (DataPromptId == PromptId && bNodeNull)
+						if (State->MatchesPrompt(DataPromptId))
 						{
-							State->bDone.Store(true);
-							State->CompletionEvent->Trigger();
+							{
+								FScopeLock Lock(&State->Mutex);
+								State->CurrentNode = bNodeNull ? FString() : (*DataObj)->GetStringField(TEXT("node"));
+							}
+
+							if (bNodeNull)
+							{
+								State->bDone.Store(true);
+								State->CompletionEvent->Trigger();
+							}
+						}
+					}
+				}
+				else if (Type == TEXT("executed"))
+				{
+					const TSharedPtr<FJsonObject>* DataObj = nullptr;
+					if (Obj->TryGetObjectField(TEXT("data"), DataObj))
+					{
+						FString DataPromptId;
+						FString NodeId;
+						const TSharedPtr<FJsonObject>* OutputObj = nullptr;
+						(*DataObj)->TryGetStringField(TEXT("prompt_id"), DataPromptId);
+						(*DataObj)->TryGetStringField(TEXT("node"), NodeId);
+						if (State->MatchesPrompt(DataPromptId) && !NodeId.IsEmpty() && (*DataObj)->TryGetObjectField(TEXT("output"), OutputObj))
+						{
+							TArray<FComfyImageReference> Images;
+							ParseImageArray(*OutputObj, Images);
+							if (Images.Num() > 0)
+							{
+								{
+									FScopeLock Lock(&State->Mutex);
+									State->Outputs->SetObjectField(NodeId, *OutputObj);
+								}
+
+								if (OnOutputImages)
+								{
+									OnOutputImages(NodeId, Images);
+								}
+							}
 						}
 					}
 				}
@@ -421,6 +1057,47 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 		}
 	});
 
+	// Binary frames: 4-byte big-endian event type, then for image events a 4-byte format and the encoded image.
+	// They carry no node id, so they are attributed to the node reported by the last 'executing' event.
+	Socket->OnRawMessage().AddLambda([State, OnBinaryImage](const void* Data, SIZE_T Size, SIZE_T BytesRemaining)
+	{
+		TArray<uint8> Frame;
+		FString NodeId;
+		{
+			FScopeLock Lock(&State->Mutex);
+			State->BinaryBuffer.Append(static_cast<const uint8*>(Data), static_cast<int32>(Size));
+			if (BytesRemaining > 0)
+			{
+				return;
+			}
+			Frame = MoveTemp(State->BinaryBuffer);
+			State->BinaryBuffer.Reset();
+			NodeId = State->CurrentNode;
+			if (!NodeId.IsEmpty())
+			{
+				State->StreamedNodes.Add(NodeId);
+			}
+		}
+
+		if (Frame.Num() <= 8)
+		{
+			return;
+		}
+
+		const uint32 EventType = (static_cast<uint32>(Frame[0]) << 24) | (static_cast<uint32>(Frame[1]) << 16) | (static_cast<uint32>(Frame[2]) << 8) | static_cast<uint32>(Frame[3]);
+		if (EventType != ComfyBinaryEventPreviewImage)
+		{
+			return;
+		}
+
+		State->BinaryFrameCount.IncrementExchange();
+		if (OnBinaryImage)
+		{
+			const TArray<uint8> ImageData(Frame.GetData() + 8, Frame.Num() - 8);
+			OnBinaryImage(NodeId, ImageData);
+		}
+	});
+
 	Socket->OnConnectionError().AddLambda([State](const FString& Error)
 	{
 		{
@@ -428,6 +1105,7 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 			State->Error = FString::Printf(TEXT("WebSocket error: %s"), *Error);
 		}
 		State->bFailed.Store(true);
+		State->ConnectedEvent->Trigger();
 		State->CompletionEvent->Trigger();
 	});
 
@@ -444,19 +1122,75 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 				: FString::Printf(TEXT("WebSocket closed (%d): %s"), StatusCode, *Reason);
 		}
 		State->bFailed.Store(true);
+		State->ConnectedEvent->Trigger();
 		State->CompletionEvent->Trigger();
 	});
 
+	TSharedPtr<FExecutionSocket, ESPMode::ThreadSafe> Session = MakeShared<FExecutionSocket, ESPMode::ThreadSafe>();
+	Session->Socket = Socket;
+	Session->State = State;
+
+	if (IsCancelled())
+	{
+		OutError = CancelledError;
+		return nullptr;
+	}
+
+	const double ConnectWaitSeconds = MakeDeadline(ConnectTimeoutSeconds) - FPlatformTime::Seconds();
+	if (ConnectWaitSeconds <= 0.0)
+	{
+		OutError = DescribeTimeout(TEXT("WebSocket connect"), ConnectTimeoutSeconds);
+		return nullptr;
+	}
+
 	Socket->Connect();
+	{
+		FChordCancellationToken::FScopedCallback CancelHook(CancellationToken, [State]()
+		{
+			State->ConnectedEvent->Trigger();
+		});
+		State->ConnectedEvent->Wait(static_cast<uint32>(ConnectWaitSeconds * 1000.0));
+	}
+
+	if (IsCancelled())
+	{
+		OutError = CancelledError;
+		return nullptr;
+	}
+
+	if (!State->bConnected.Load())
+	{
+		FScopeLock Lock(&State->Mutex);
+		OutError = State->Error.IsEmpty() ? DescribeTimeout(TEXT("WebSocket connect"), ConnectTimeoutSeconds) : State->Error;
+		return nullptr;
+	}
+
+	return Session;
+}
+
+bool FComfyUIClient::WaitOnExecutionSocket(const TSharedRef<FExecutionSocket, ESPMode::ThreadSafe>& Session, double Deadline, TSharedPtr<FJsonObject>& OutOutputs, FString& OutError) const
+{
+	const TSharedPtr<FWebSocketWaitState, ESPMode::ThreadSafe>& State = Session->State;
+	const double WaitSeconds = Deadline - FPlatformTime::Seconds();
+	if (WaitSeconds > 0.0)
+	{
+		FChordCancellationToken::FScopedCallback CancelHook(CancellationToken, [State]()
+		{
+			State->CompletionEvent->Trigger();
+		});
+		State->CompletionEvent->Wait(static_cast<uint32>(WaitSeconds * 1000.0));
+	}
 
-	State->CompletionEvent->Wait(static_cast<uint32>(RequestTimeoutSeconds * 1000.0f));
-	Socket->OnMessage().Clear();
-	Socket->OnConnectionError().Clear();
-	Socket->OnClosed().Clear();
-	Socket->Close();
+	if (IsCancelled())
+	{
+		OutError = CancelledError;
+		return false;
+	}
 
 	if (State->bDone.Load())
 	{
+		FScopeLock Lock(&State->Mutex);
+		OutOutputs = State->Outputs;
 		return true;
 	}
 
@@ -467,20 +1201,26 @@ bool FComfyUIClient::WaitOnWebSocket(const FString& PromptId, const FString& Cli
 		return false;
 	}
 
-	if (!State->bFailed.Load())
-	{
-		OutError = TEXT("WebSocket wait timed out.");
-	}
-
+	OutError = DescribeTimeout(TEXT("Prompt execution"), ExecutionTimeoutSeconds);
 	return false;
 }
 
-bool FComfyUIClient::PollHistoryUntilComplete(const FString& PromptId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const
+bool FComfyUIClient::PollHistoryUntilComplete(const FString& PromptId, double Deadline, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const
 {
-	const double StartTime = FPlatformTime::Seconds();
+	TSharedRef<FEvent, ESPMode::ThreadSafe> WakeEvent = MakePooledEvent();
+	FChordCancellationToken::FScopedCallback CancelHook(CancellationToken, [WakeEvent]()
+	{
+		WakeEvent->Trigger();
+	});
 
-	while (FPlatformTime::Seconds() - StartTime < RequestTimeoutSeconds)
+	while (FPlatformTime::Seconds() < Deadline)
 	{
+		if (IsCancelled())
+		{
+			OutError = CancelledError;
+			return false;
+		}
+
 		if (GetHistory(PromptId, OutHistory, OutError) && OutHistory.IsValid())
 		{
 			if (TryExtractHistoryError(OutHistory, PromptId, OutError))
@@ -499,38 +1239,172 @@ bool FComfyUIClient::PollHistoryUntilComplete(const FString& PromptId, TSharedPt
 			}
 		}
 
-		FPlatformProcess::Sleep(PollingIntervalSeconds);
+		const double SleepSeconds = FMath::Min(static_cast<double>(PollingIntervalSeconds), Deadline - FPlatformTime::Seconds());
+		if (SleepSeconds > 0.0)
+		{
+			WakeEvent->Wait(static_cast<uint32>(SleepSeconds * 1000.0));
+		}
 	}
 
-	OutError = TEXT("Polling history timed out.");
+	OutError = DescribeTimeout(TEXT("Prompt execution"), ExecutionTimeoutSeconds);
 	return false;
 }
 
-bool FComfyUIClient::WaitForCompletion(const FString& PromptId, const FString& ClientId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, TFunction<void(float)> OnProgress) const
+bool FComfyUIClient::FinishFromSocket(const TSharedRef<FExecutionSocket, ESPMode::ThreadSafe>& Session, const FString& PromptId, double Deadline, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const
+{
+	TSharedPtr<FJsonObject> SocketOutputs;
+	if (!WaitOnExecutionSocket(Session, Deadline, SocketOutputs, OutError))
+	{
+		if (OutError.StartsWith(TEXT("Execution error")) || IsCancelled())
+		{
+			return false;
+		}
+		// Polling inherits whatever is left of the execution budget instead of starting a new one.
+		return PollHistoryUntilComplete(PromptId, Deadline, OutHistory, OutError);
+	}
+
+	// Outputs harvested from 'executed' events (or streamed as binary frames) describe the results; shape them like
+	// /history so callers can parse both paths the same way.
+	const bool bHasSocketOutputs = SocketOutputs.IsValid() && SocketOutputs->Values.Num() > 0;
+	const bool bHasSocketResults = bHasSocketOutputs || Session->State->BinaryFrameCount.Load() > 0;
+	auto UseSocketOutputs = [&SocketOutputs, &PromptId, &OutHistory, bHasSocketOutputs]()
+	{
+		TSharedPtr<FJsonObject> PromptObj = MakeShared<FJsonObject>();
+		PromptObj->SetObjectField(TEXT("outputs"), bHasSocketOutputs ? SocketOutputs : MakeShared<FJsonObject>());
+		OutHistory = MakeShared<FJsonObject>();
+		OutHistory->SetObjectField(PromptId, PromptObj);
+	};
+
+	int32 NumMissingOutputs = 0;
+	{
+		FScopeLock Lock(&Session->State->Mutex);
+		for (const FString& NodeId : Session->State->ExpectedOutputNodes)
+		{
+			if (!(bHasSocketOutputs && SocketOutputs->HasField(NodeId)) && !Session->State->StreamedNodes.Contains(NodeId))
+			{
+				++NumMissingOutputs;
+			}
+		}
+	}
+	if (bHasSocketResults && NumMissingOutputs == 0)
+	{
+		UseSocketOutputs();
+		return true;
+	}
+
+	// Older servers skip 'executed' for cached output nodes, for the whole prompt or only some of them; /history
+	// lists every output.
+	if (GetHistory(PromptId, OutHistory, OutError))
+	{
+		return true;
+	}
+	if (!bHasSocketResults)
+	{
+		return false;
+	}
+
+	UE_LOG(LogChordPBRGenerator, Warning, TEXT("%d output node(s) of prompt %s reported nothing and /history failed (%s); using what the WebSocket delivered."), NumMissingOutputs, *PromptId, *OutError);
+	OutError.Reset();
+	UseSocketOutputs();
+	return true;
+}
+
+bool FComfyUIClient::QueuePromptAndWait(const TSharedPtr<FJsonObject>& PromptObject, FComfyPromptResponse& OutResponse, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, const FComfyExecutionCallbacks& Callbacks) const
 {
-	bool bSocketOk = false;
+	const FString ClientId = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+
+	// Connect first: the server drops events for clients that are not connected yet, and binary output
+	// frames cannot be recovered from /history afterwards.
+	TSharedPtr<FExecutionSocket, ESPMode::ThreadSafe> Session;
 	if (bUseWebSocket)
 	{
-		bSocketOk = WaitOnWebSocket(PromptId, ClientId, OutError, OnProgress);
-		if (!bSocketOk && OutError.StartsWith(TEXT("Execution error")))
+		FString SocketError;
+		Session = ConnectExecutionSocket(ClientId, Callbacks, SocketError);
+		if (!Session.IsValid() && Callbacks.bBinaryImagesRequired)
 		{
+			OutError = FString::Printf(TEXT("Binary output delivery needs the WebSocket: %s"), *SocketError);
 			return false;
 		}
 	}
+	else if (Callbacks.bBinaryImagesRequired)
+	{
+		OutError = TEXT("Binary output delivery requires WebSocket progress to be enabled.");
+		return false;
+	}
+
+	if (!QueuePromptInternal(PromptObject, ClientId, OutResponse, OutError))
+	{
+		return false;
+	}
+
+	if (Callbacks.OnQueued)
+	{
+		Callbacks.OnQueued(OutResponse);
+	}
+
+	const double Deadline = MakeDeadline(ExecutionTimeoutSeconds);
+	if (!Session.IsValid())
+	{
+		return PollHistoryUntilComplete(OutResponse.PromptId, Deadline, OutHistory, OutError);
+	}
+
+	Session->State->SetPromptId(OutResponse.PromptId);
+	Session->State->SetExpectedOutputNodes(GetOutputNodeIds(PromptObject));
+	return FinishFromSocket(Session.ToSharedRef(), OutResponse.PromptId, Deadline, OutHistory, OutError);
+}
+
+bool FComfyUIClient::ReattachToPrompt(const FString& PromptId, const FString& ClientId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, const FComfyExecutionCallbacks& Callbacks) const
+{
+	// Connect before looking, so a prompt that finishes after the checks below is still reported on the socket.
+	TSharedPtr<FExecutionSocket, ESPMode::ThreadSafe> Session;
+	if (bUseWebSocket)
+	{
+		FString SocketError;
+		Session = ConnectExecutionSocket(ClientId, Callbacks, SocketError);
+	}
+
+	auto IsInHistory = [this, &PromptId, &OutHistory]()
+	{
+		FString HistoryError;
+		return GetHistory(PromptId, OutHistory, HistoryError) && OutHistory.IsValid() && OutHistory->HasField(PromptId);
+	};
+
+	if (IsInHistory())
+	{
+		return !TryExtractHistoryError(OutHistory, PromptId, OutError);
+	}
+
+	EComfyPromptQueueState State = EComfyPromptQueueState::NotQueued;
+	if (!GetPromptQueueState(PromptId, State, OutError))
+	{
+		return false;
+	}
+
+	if (State == EComfyPromptQueueState::NotQueued)
+	{
+		// It may have left the queue between the two calls.
+		if (IsInHistory())
+		{
+			return !TryExtractHistoryError(OutHistory, PromptId, OutError);
+		}
+		OutError = FString::Printf(TEXT("Prompt %s is no longer known to the server."), *PromptId);
+		return false;
+	}
 
-	if (!bSocketOk)
+	const double Deadline = MakeDeadline(ExecutionTimeoutSeconds);
+	if (!Session.IsValid())
 	{
-		return PollHistoryUntilComplete(PromptId, OutHistory, OutError);
+		return PollHistoryUntilComplete(PromptId, Deadline, OutHistory, OutError);
 	}
 
-	// If websocket completed, fetch history once.
-	return GetHistory(PromptId, OutHistory, OutError);
+	Session->State->SetPromptId(PromptId);
+	return FinishFromSocket(Session.ToSharedRef(), PromptId, Deadline, OutHistory, OutError);
 }
 
 bool FComfyUIClient::GetHistory(const FString& PromptId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const
 {
 	FHttpResponsePtr Response;
-	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/history/") + PromptId, TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError))
+	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/history/") + PromptId, TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError, EComfyRequestFlags::Default | EComfyRequestFlags::Quick))
 	{
 		return false;
 	}
@@ -564,25 +1438,7 @@ bool FComfyUIClient::ParseImageOutputs(const TSharedPtr<FJsonObject>& History, T
 					const TSharedPtr<FJsonObject>* OutputObj = nullptr;
 					if (OutputKV.Value->TryGetObject(OutputObj))
 					{
-						const TArray<TSharedPtr<FJsonValue>>* ImagesArray = nullptr;
-						if ((*OutputObj)->TryGetArrayField(TEXT("images"), ImagesArray))
-						{
-							for (const TSharedPtr<FJsonValue>& Val : *ImagesArray)
-							{
-								const TSharedPtr<FJsonObject>* ImgObj = nullptr;
-								if (Val->TryGetObject(ImgObj))
-								{
-									FComfyImageReference Ref;
-									(*ImgObj)->TryGetStringField(TEXT("filename"), Ref.Filename);
-									(*ImgObj)->TryGetStringField(TEXT("subfolder"), Ref.Subfolder);
-									(*ImgObj)->TryGetStringField(TEXT("type"), Ref.Type);
-									if (!Ref.Filename.IsEmpty())
-									{
-										OutImages.Add(Ref);
-									}
-								}
-							}
-						}
+						ParseImageArray(*OutputObj, OutImages);
 					}
 				}
 			}
@@ -620,8 +1476,14 @@ bool FComfyUIClient::DownloadImage(const FComfyImageReference& Ref, TArray<uint8
 	return true;
 }
 
-bool FComfyUIClient::UploadImage(const TArray<uint8>& ImageData, const FString& FileName, FComfyImageReference& OutRef, FString& OutError) const
+FString FComfyUIClient::GetUploadName(const TArray<uint8>& ImageData)
+{
+	return FString::Printf(TEXT("chord_%s.png"), *FSHA1::HashBuffer(ImageData.GetData(), ImageData.Num()).ToString().ToLower());
+}
+
+bool FComfyUIClient::UploadImage(const TArray<uint8>& ImageData, FComfyImageReference& OutRef, FString& OutError) const
 {
+	const FString FileName = GetUploadName(ImageData);
 	const FString Boundary = TEXT("----ChordPBRGeneratorBoundary");
 	TArray<uint8> Body;
 
@@ -635,6 +1497,9 @@ bool FComfyUIClient::UploadImage(const TArray<uint8>& ImageData, const FString&
 	AppendString(TEXT("Content-Disposition: form-data; name=\"image\"; filename=\"") + FileName + TEXT("\"\r\n"));
 	AppendString(TEXT("Content-Type: application/octet-stream\r\n\r\n"));
 	Body.Append(ImageData);
+	// The name only ever holds this content, so overwriting is safe and keeps retries from piling up "name (1).png".
+	AppendString(TEXT("\r\n--") + Boundary + TEXT("\r\n"));
+	AppendString(TEXT("Content-Disposition: form-data; name=\"overwrite\"\r\n\r\ntrue"));
 	AppendString(TEXT("\r\n--") + Boundary + TEXT("--\r\n"));
 
 	FHttpResponsePtr Response;
@@ -662,13 +1527,166 @@ bool FComfyUIClient::UploadImage(const TArray<uint8>& ImageData, const FString&
 	return !OutRef.Filename.IsEmpty();
 }
 
-bool FComfyUIClient::Cancel(FString& OutError) const
+bool FComfyUIClient::GetPromptQueueState(const FString& PromptId, EComfyPromptQueueState& OutState, FString& OutError) const
+{
+	OutState = EComfyPromptQueueState::NotQueued;
+
+	FHttpResponsePtr Response;
+	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/queue"), TEXT("GET"), TEXT("application/json"), TEXT(""), Response, OutError, EComfyRequestFlags::Idempotent | EComfyRequestFlags::Quick))
+	{
+		return false;
+	}
+
+	if (Response->GetResponseCode() != 200)
+	{
+		OutError = FString::Printf(TEXT("Queue query failed (%d)"), Response->GetResponseCode());
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Obj;
+	if (!ParseJsonResponse(Response, Obj, OutError))
+	{
+		return false;
+	}
+
+	// Each queue entry is [number, prompt_id, prompt, extra_data, outputs_to_execute].
+	auto ContainsPrompt = [&Obj, &PromptId](const TCHAR* FieldName) -> bool
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Entries = nullptr;
+		if (!Obj->TryGetArrayField(FieldName, Entries))
+		{
+			return false;
+		}
+
+		for (const TSharedPtr<FJsonValue>& Entry : *Entries)
+		{
+			const TArray<TSharedPtr<FJsonValue>>* Fields = nullptr;
+			FString EntryPromptId;
+			if (Entry.IsValid() && Entry->TryGetArray(Fields) && Fields->Num() > 1 && (*Fields)[1]->TryGetString(EntryPromptId) && EntryPromptId == PromptId)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	if (ContainsPrompt(TEXT("queue_running")))
+	{
+		OutState = EComfyPromptQueueState::Running;
+	}
+	else if (ContainsPrompt(TEXT("queue_pending")))
+	{
+		OutState = EComfyPromptQueueState::Pending;
+	}
+
+	return true;
+}
+
+bool FComfyUIClient::CancelPrompt(const FString& PromptId, FString& OutError) const
 {
+	if (PromptId.IsEmpty())
+	{
+		OutError = TEXT("Missing prompt id.");
+		return false;
+	}
+
+	EComfyPromptQueueState State = EComfyPromptQueueState::NotQueued;
+	if (!GetPromptQueueState(PromptId, State, OutError))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Payload = MakeShared<FJsonObject>();
+	FString Endpoint;
+	switch (State)
+	{
+	case EComfyPromptQueueState::Pending:
+	{
+		TArray<TSharedPtr<FJsonValue>> Ids;
+		Ids.Add(MakeShared<FJsonValueString>(PromptId));
+		Payload->SetArrayField(TEXT("delete"), Ids);
+		Endpoint = TEXT("/queue");
+		break;
+	}
+	case EComfyPromptQueueState::Running:
+		// Servers that ignore prompt_id interrupt whatever runs, which is still ours: we just checked.
+		Payload->SetStringField(TEXT("prompt_id"), PromptId);
+		Endpoint = TEXT("/interrupt");
+		break;
+	default:
+		return true;
+	}
+
+	FString Body;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Body);
+	FJsonSerializer::Serialize(Payload.ToSharedRef(), Writer);
+
 	FHttpResponsePtr Response;
-	if (!ExecuteJsonRequestBlocking(BaseUrl + TEXT("/interrupt"), TEXT("POST"), TEXT("application/json"), TEXT("{}"), Response, OutError))
+	if (!ExecuteJsonRequestBlocking(BaseUrl + Endpoint, TEXT("POST"), TEXT("application/json"), Body, Response, OutError, EComfyRequestFlags::Idempotent | EComfyRequestFlags::Quick))
+	{
+		return false;
+	}
+
+	if (Response->GetResponseCode() != 200)
+	{
+		OutError = FString::Printf(TEXT("Cancel prompt %s failed (%d)"), *PromptId, Response->GetResponseCode());
+		return false;
+	}
+
+	return true;
+}
+
+FComfyOutputPrefetcher::FComfyOutputPrefetcher(const TSharedRef<FComfyUIClient>& InClient)
+	: Client(InClient)
+{
+}
+
+void FComfyOutputPrefetcher::Prefetch(const TArray<FComfyImageReference>& Images)
+{
+	FScopeLock Lock(&Mutex);
+	for (const FComfyImageReference& Ref : Images)
+	{
+		const FString Key = Ref.GetKey();
+		if (Pending.Contains(Key))
+		{
+			continue;
+		}
+
+		TSharedRef<FComfyUIClient> ClientRef = Client;
+		Pending.Add(Key, Async(EAsyncExecution::ThreadPool, [ClientRef, Ref]()
+		{
+			TSharedPtr<FDownloadResult, ESPMode::ThreadSafe> Result = MakeShared<FDownloadResult, ESPMode::ThreadSafe>();
+			Result->bSuccess = ClientRef->DownloadImage(Ref, Result->Data, Result->Error);
+			return Result;
+		}));
+	}
+}
+
+bool FComfyOutputPrefetcher::Fetch(const FComfyImageReference& Ref, TArray<uint8>& OutData, FString& OutError)
+{
+	TFuture<TSharedPtr<FDownloadResult, ESPMode::ThreadSafe>> Future;
+	{
+		FScopeLock Lock(&Mutex);
+		const FString Key = Ref.GetKey();
+		if (TFuture<TSharedPtr<FDownloadResult, ESPMode::ThreadSafe>>* Found = Pending.Find(Key))
+		{
+			Future = MoveTemp(*Found);
+			Pending.Remove(Key);
+		}
+	}
+
+	if (!Future.IsValid())
 	{
+		return Client->DownloadImage(Ref, OutData, OutError);
+	}
+
+	TSharedPtr<FDownloadResult, ESPMode::ThreadSafe> Result = Future.Get();
+	if (!Result.IsValid() || !Result->bSuccess)
+	{
+		OutError = Result.IsValid() ? Result->Error : TEXT("Prefetch failed.");
 		return false;
 	}
 
-	return Response.IsValid() && Response->GetResponseCode() == 200;
+	OutData = MoveTemp(Result->Data);
+	return true;
 }
@@ -193,6 +193,266 @@ namespace
 		return true;
 	}
 
+	// Websocket save nodes push PNG bytes to the client instead of writing files the client has to fetch.
+	void ConvertSaveNodesToWebSocket(const TSharedPtr<FJsonObject>& Prompt)
+	{
+		for (const auto& NodeKV : Prompt->Values)
+		{
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			FString ClassType;
+			if (NodeKV.Value->TryGetObject(NodeObj) && (*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType) && ClassType == TEXT("SaveImage"))
+			{
+				(*NodeObj)->SetStringField(TEXT("class_type"), TEXT("SaveImageWebsocket"));
+				const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+				if ((*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+				{
+					(*InputsObj)->RemoveField(TEXT("filename_prefix"));
+				}
+			}
+		}
+	}
+
+	bool IsNodeLink(const TSharedPtr<FJsonValue>& Value, FString& OutNodeKey)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Link = nullptr;
+		return Value.IsValid() && Value->TryGetArray(Link) && Link->Num() == 2 && (*Link)[0]->TryGetString(OutNodeKey);
+	}
+
+	FString OffsetNodeKey(const FString& NodeKey, int32 Offset)
+	{
+		if (Offset == 0)
+		{
+			return NodeKey;
+		}
+		return NodeKey.IsNumeric() ? LexToString(FCString::Atoi(*NodeKey) + Offset) : FString::Printf(TEXT("%d_%s"), Offset, *NodeKey);
+	}
+
+	// Rounds past the template's highest node id so shifted ids stay readable in the server log (node 3 becomes 103).
+	int32 GetNodeIdStride(const TSharedPtr<FJsonObject>& Prompt)
+	{
+		int32 MaxNodeId = 0;
+		for (const auto& NodeKV : Prompt->Values)
+		{
+			MaxNodeId = FMath::Max(MaxNodeId, FCString::Atoi(*NodeKV.Key));
+		}
+		return (MaxNodeId / 100 + 1) * 100;
+	}
+
+	/**
+	 * Copies Source's nodes into Target with their ids shifted by Offset. Links to a node listed in Redirects are
+	 * replaced by the given link and that node is dropped; nodes in SharedKeys are dropped too, and links to them keep
+	 * pointing at the copy already in Target.
+	 */
+	void AppendShiftedNodes(const TSharedPtr<FJsonObject>& Source, int32 Offset, const TMap<FString, TSharedPtr<FJsonValue>>& Redirects, const TSet<FString>& SharedKeys, const TSharedPtr<FJsonObject>& Target)
+	{
+		for (const auto& NodeKV : Source->Values)
+		{
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			if (Redirects.Contains(NodeKV.Key) || SharedKeys.Contains(NodeKV.Key) || !NodeKV.Value->TryGetObject(NodeObj))
+			{
+				continue;
+			}
+
+			const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+			if ((*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+			{
+				for (auto& InputKV : (*InputsObj)->Values)
+				{
+					FString LinkedNodeKey;
+					if (!IsNodeLink(InputKV.Value, LinkedNodeKey) || SharedKeys.Contains(LinkedNodeKey))
+					{
+						continue;
+					}
+
+					if (const TSharedPtr<FJsonValue>* Redirect = Redirects.Find(LinkedNodeKey))
+					{
+						InputKV.Value = *Redirect;
+					}
+					else
+					{
+						TArray<TSharedPtr<FJsonValue>> Link = InputKV.Value->AsArray();
+						Link[0] = MakeShared<FJsonValueString>(OffsetNodeKey(LinkedNodeKey, Offset));
+						InputKV.Value = MakeShared<FJsonValueArray>(Link);
+					}
+				}
+			}
+
+			Target->SetObjectField(OffsetNodeKey(NodeKV.Key, Offset), *NodeObj);
+		}
+	}
+
+	bool IsOutputNodeClass(const FString& ClassType)
+	{
+		return ClassType.StartsWith(TEXT("Save")) || ClassType.StartsWith(TEXT("Preview"));
+	}
+
+	// Removes every node no Save/Preview node depends on. ComfyUI would skip them anyway, but they still have to pass
+	// validation on the server and bloat the prompt.
+	void RemoveDeadNodes(const TSharedPtr<FJsonObject>& Prompt)
+	{
+		TArray<FString> Pending;
+		for (const auto& NodeKV : Prompt->Values)
+		{
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			FString ClassType;
+			if (NodeKV.Value->TryGetObject(NodeObj) && (*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType) && IsOutputNodeClass(ClassType))
+			{
+				Pending.Add(NodeKV.Key);
+			}
+		}
+
+		// A template without recognisable outputs is left alone rather than emptied.
+		if (Pending.Num() == 0)
+		{
+			return;
+		}
+
+		TSet<FString> Live;
+		while (Pending.Num() > 0)
+		{
+			const FString NodeKey = Pending.Pop();
+			bool bAlreadyLive = false;
+			Live.Add(NodeKey, &bAlreadyLive);
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+			if (bAlreadyLive || !Prompt->TryGetObjectField(NodeKey, NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+			{
+				continue;
+			}
+
+			for (const auto& InputKV : (*InputsObj)->Values)
+			{
+				FString LinkedNodeKey;
+				if (IsNodeLink(InputKV.Value, LinkedNodeKey))
+				{
+					Pending.Add(LinkedNodeKey);
+				}
+			}
+		}
+
+		TArray<FString> DeadKeys;
+		for (const auto& NodeKV : Prompt->Values)
+		{
+			if (!Live.Contains(NodeKV.Key))
+			{
+				DeadKeys.Add(NodeKV.Key);
+			}
+		}
+		for (const FString& DeadKey : DeadKeys)
+		{
+			Prompt->RemoveField(DeadKey);
+		}
+	}
+
+	// Drops the bound save nodes of channels the settings do not ask for. Returns how many were removed; the caller
+	// follows up with RemoveDeadNodes once every CHORD graph in the prompt is handled.
+	int32 RemoveUnselectedChannelNodes(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& Prompt, int32 NodeIdOffset)
+	{
+		const FComfyChordBinding& Binding = Settings.ChordBinding;
+		const TPair<const TCHAR*, const FComfyPBRChannelBinding*> Channels[] =
+		{
+			{ TEXT("BaseColor"), &Binding.BaseColor },
+			{ TEXT("Normal"), &Binding.Normal },
+			{ TEXT("Roughness"), &Binding.Roughness },
+			{ TEXT("Metallic"), &Binding.Metallic },
+			{ TEXT("Height"), &Binding.Height }
+		};
+
+		int32 NumRemoved = 0;
+		for (const auto& Channel : Channels)
+		{
+			const FString NodeKey = LexToString(Channel.Value->NodeId + NodeIdOffset);
+			if (!Settings.ChordOutputChannels.IsEnabled(Channel.Key) && Channel.Value->NodeId >= 0 && Prompt->HasField(NodeKey))
+			{
+				Prompt->RemoveField(NodeKey);
+				++NumRemoved;
+			}
+		}
+		return NumRemoved;
+	}
+
+	// Points the CHORD template's LoadImage node at an uploaded image.
+	bool SetChordSourceImage(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& Prompt, const FComfyImageReference& UploadedImage, FString& OutError)
+	{
+		const FComfyChordBinding& Binding = Settings.ChordBinding;
+		int32 LoadNodeId = ResolveNodeId(Prompt, Binding.LoadImageNodeId, Binding.LoadImageInputName);
+		if (LoadNodeId < 0)
+		{
+			OutError = TEXT("Unable to find LoadImage node in CHORD template.");
+			return false;
+		}
+
+		const FString ResolvedName = UploadedImage.Subfolder.IsEmpty()
+			? UploadedImage.Filename
+			: FString::Printf(TEXT("%s/%s"), *UploadedImage.Subfolder, *UploadedImage.Filename);
+
+		const FString NodeKey = LexToString(LoadNodeId);
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		TSharedPtr<FJsonValue> ExistingValue;
+
+		bool bUsedObject = false;
+		if (Prompt->TryGetObjectField(NodeKey, NodeObj) && (*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+		{
+			ExistingValue = (*InputsObj)->TryGetField(Binding.LoadImageInputName);
+			if (ExistingValue.IsValid() && ExistingValue->Type == EJson::Object)
+			{
+				TSharedPtr<FJsonObject> ImageObj = ExistingValue->AsObject();
+				if (ImageObj.IsValid())
+				{
+					if (ImageObj->HasField(TEXT("filename")))
+					{
+						ImageObj->SetStringField(TEXT("filename"), UploadedImage.Filename);
+					}
+					else
+					{
+						ImageObj->SetStringField(TEXT("image"), UploadedImage.Filename);
+					}
+
+					if (!UploadedImage.Subfolder.IsEmpty())
+					{
+						ImageObj->SetStringField(TEXT("subfolder"), UploadedImage.Subfolder);
+					}
+
+					if (!UploadedImage.Type.IsEmpty())
+					{
+						ImageObj->SetStringField(TEXT("type"), UploadedImage.Type);
+					}
+
+					bUsedObject = true;
+				}
+			}
+		}
+
+		if (!bUsedObject)
+		{
+			SetInputField(Prompt, LoadNodeId, Binding.LoadImageInputName, MakeShared<FJsonValueString>(ResolvedName));
+		}
+		return true;
+	}
+
+	bool ResolveFusedLayout(const TSharedPtr<FJsonObject>& Txt2ImgPrompt, FComfyFusedPromptLayout& OutLayout, FString& OutError)
+	{
+		for (const auto& NodeKV : Txt2ImgPrompt->Values)
+		{
+			const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+			FString ClassType;
+			if (OutLayout.ImageNodeKey.IsEmpty() && NodeKV.Value->TryGetObject(NodeObj) && (*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType) && ClassType == TEXT("SaveImage"))
+			{
+				OutLayout.ImageNodeKey = NodeKV.Key;
+			}
+		}
+
+		if (OutLayout.ImageNodeKey.IsEmpty())
+		{
+			OutError = TEXT("The txt2img template has no SaveImage node to feed CHORD from.");
+			return false;
+		}
+
+		OutLayout.ChordNodeOffset = GetNodeIdStride(Txt2ImgPrompt);
+		return true;
+	}
+
 	const TArray<FString> DefaultChannelHints = { TEXT("basecolor"), TEXT("normal"), TEXT("roughness"), TEXT("metallic"), TEXT("height") };
 }
 
@@ -203,12 +463,143 @@ bool FComfyWorkflowUtils::LoadPromptTemplate(const FString& Path, TSharedPtr<FJs
 
 bool FComfyWorkflowUtils::PatchTxt2ImgPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError)
 {
-	if (!LoadTemplateInternal(Settings.Txt2ImgApiPromptPath, OutPrompt, OutError))
+	return PatchTxt2ImgTemplate(Settings.Txt2ImgApiPromptPath, Settings.Txt2ImgBinding, Prompt, Seed, FilenamePrefix, OutPrompt, OutError);
+}
+
+bool FComfyWorkflowUtils::PatchTxt2ImgDraftPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError)
+{
+	const bool bDraftTemplate = !Settings.DraftTxt2ImgApiPromptPath.IsEmpty();
+	if (!PatchTxt2ImgTemplate(bDraftTemplate ? Settings.DraftTxt2ImgApiPromptPath : Settings.Txt2ImgApiPromptPath, bDraftTemplate ? Settings.DraftTxt2ImgBinding : Settings.Txt2ImgBinding,
+		Prompt, Seed, FilenamePrefix, OutPrompt, OutError))
 	{
 		return false;
 	}
 
-	const FComfyTxt2ImgBinding& Binding = Settings.Txt2ImgBinding;
+	for (const auto& NodeKV : OutPrompt->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		FString ClassType;
+		if (!NodeKV.Value->TryGetObject(NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+		{
+			continue;
+		}
+		(*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType);
+
+		// Latent sizes stay multiples of 64 so every model family accepts them.
+		double Width = 0.0;
+		double Height = 0.0;
+		if (ClassType.Contains(TEXT("Latent")) && (*InputsObj)->TryGetNumberField(TEXT("width"), Width) && (*InputsObj)->TryGetNumberField(TEXT("height"), Height))
+		{
+			auto ScaleSize = [&Settings](double Size)
+			{
+				return FMath::Max(256, FMath::RoundToInt(Size * Settings.DraftResolutionScale / 64.0) * 64);
+			};
+			(*InputsObj)->SetNumberField(TEXT("width"), ScaleSize(Width));
+			(*InputsObj)->SetNumberField(TEXT("height"), ScaleSize(Height));
+		}
+
+		double Steps = 0.0;
+		if ((*InputsObj)->TryGetNumberField(TEXT("steps"), Steps))
+		{
+			(*InputsObj)->SetNumberField(TEXT("steps"), FMath::Min(Steps, static_cast<double>(FMath::Max(4, FMath::CeilToInt(Steps * Settings.DraftStepScale)))));
+		}
+	}
+	return true;
+}
+
+bool FComfyWorkflowUtils::SetTxt2ImgBatchSize(const TSharedPtr<FJsonObject>& Prompt, int32 BatchSize)
+{
+	if (!Prompt.IsValid())
+	{
+		return false;
+	}
+
+	bool bPatched = false;
+	for (const auto& NodeKV : Prompt->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		FString ClassType;
+		if (NodeKV.Value->TryGetObject(NodeObj) && (*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType) && ClassType.Contains(TEXT("Latent"))
+			&& (*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj) && (*InputsObj)->HasField(TEXT("batch_size")))
+		{
+			(*InputsObj)->SetNumberField(TEXT("batch_size"), FMath::Max(1, BatchSize));
+			bPatched = true;
+		}
+	}
+	return bPatched;
+}
+
+bool FComfyWorkflowUtils::SelectTxt2ImgBatchImage(const TSharedPtr<FJsonObject>& Prompt, int32 BatchIndex)
+{
+	if (!Prompt.IsValid())
+	{
+		return false;
+	}
+
+	FString LatentKey;
+	for (const auto& NodeKV : Prompt->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		FString ClassType;
+		if (NodeKV.Value->TryGetObject(NodeObj) && (*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType) && ClassType.Contains(TEXT("Latent"))
+			&& (*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj) && (*InputsObj)->HasField(TEXT("batch_size")))
+		{
+			LatentKey = NodeKV.Key;
+			break;
+		}
+	}
+	if (LatentKey.IsEmpty())
+	{
+		return false;
+	}
+
+	// Everything that read the empty latent reads the selected slice instead.
+	const FString SelectKey = TEXT("chord_latent_from_batch");
+	for (const auto& NodeKV : Prompt->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		if (!NodeKV.Value->TryGetObject(NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+		{
+			continue;
+		}
+		for (auto& InputKV : (*InputsObj)->Values)
+		{
+			const TArray<TSharedPtr<FJsonValue>>* Link = nullptr;
+			FString SourceKey;
+			if (InputKV.Value.IsValid() && InputKV.Value->TryGetArray(Link) && Link->Num() == 2 && (*Link)[0].IsValid() && (*Link)[0]->TryGetString(SourceKey) && SourceKey == LatentKey)
+			{
+				TArray<TSharedPtr<FJsonValue>> NewLink;
+				NewLink.Add(MakeShared<FJsonValueString>(SelectKey));
+				NewLink.Add((*Link)[1]);
+				InputKV.Value = MakeShared<FJsonValueArray>(NewLink);
+			}
+		}
+	}
+
+	TSharedPtr<FJsonObject> Inputs = MakeShared<FJsonObject>();
+	TArray<TSharedPtr<FJsonValue>> SamplesLink;
+	SamplesLink.Add(MakeShared<FJsonValueString>(LatentKey));
+	SamplesLink.Add(MakeShared<FJsonValueNumber>(0));
+	Inputs->SetArrayField(TEXT("samples"), SamplesLink);
+	Inputs->SetNumberField(TEXT("batch_index"), FMath::Max(0, BatchIndex));
+	Inputs->SetNumberField(TEXT("length"), 1);
+	TSharedPtr<FJsonObject> SelectNode = MakeShared<FJsonObject>();
+	SelectNode->SetStringField(TEXT("class_type"), TEXT("LatentFromBatch"));
+	SelectNode->SetObjectField(TEXT("inputs"), Inputs);
+	Prompt->SetObjectField(SelectKey, SelectNode);
+	return true;
+}
+
+bool FComfyWorkflowUtils::PatchTxt2ImgTemplate(const FString& TemplatePath, const FComfyTxt2ImgBinding& Binding, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError)
+{
+	if (!LoadTemplateInternal(TemplatePath, OutPrompt, OutError))
+	{
+		return false;
+	}
 
 	auto SetStringInput = [&](const FString& NodeIdentifier, const FString& InputName, const FString& Value)
 	{
@@ -259,65 +650,205 @@ bool FComfyWorkflowUtils::PatchChordPrompt(const UChordPBRSettings& Settings, co
 		return false;
 	}
 
+	if (!SetChordSourceImage(Settings, OutPrompt, UploadedImage, OutError))
+	{
+		return false;
+	}
+
+	if (RemoveUnselectedChannelNodes(Settings, OutPrompt, 0) > 0)
+	{
+		RemoveDeadNodes(OutPrompt);
+	}
+
+	if (Settings.bStreamChordOutputsOverWebSocket)
+	{
+		ConvertSaveNodesToWebSocket(OutPrompt);
+	}
+
+	return true;
+}
+
+bool FComfyWorkflowUtils::BuildFusedTxt2ImgChordPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError)
+{
+	FComfyFusedPromptLayout Layout;
+	TSharedPtr<FJsonObject> ChordPrompt;
+	if (!PatchTxt2ImgPrompt(Settings, Prompt, Seed, FilenamePrefix, OutPrompt, OutError)
+		|| !ResolveFusedLayout(OutPrompt, Layout, OutError)
+		|| !LoadTemplateInternal(Settings.ChordImg2PbrApiPromptPath, ChordPrompt, OutError))
+	{
+		return false;
+	}
+
 	const FComfyChordBinding& Binding = Settings.ChordBinding;
-	int32 LoadNodeId = ResolveNodeId(OutPrompt, Binding.LoadImageNodeId, Binding.LoadImageInputName);
+	const int32 LoadNodeId = ResolveNodeId(ChordPrompt, Binding.LoadImageNodeId, Binding.LoadImageInputName);
 	if (LoadNodeId < 0)
 	{
 		OutError = TEXT("Unable to find LoadImage node in CHORD template.");
 		return false;
 	}
 
-	const FString ResolvedName = UploadedImage.Subfolder.IsEmpty()
-		? UploadedImage.Filename
-		: FString::Printf(TEXT("%s/%s"), *UploadedImage.Subfolder, *UploadedImage.Filename);
+	const TSharedPtr<FJsonObject>* ImageNode = nullptr;
+	const TSharedPtr<FJsonObject>* ImageInputs = nullptr;
+	TSharedPtr<FJsonValue> GeneratedImage;
+	if (OutPrompt->TryGetObjectField(Layout.ImageNodeKey, ImageNode) && (*ImageNode)->TryGetObjectField(TEXT("inputs"), ImageInputs))
+	{
+		GeneratedImage = (*ImageInputs)->TryGetField(TEXT("images"));
+	}
+	FString GeneratedImageNodeKey;
+	if (!IsNodeLink(GeneratedImage, GeneratedImageNodeKey))
+	{
+		OutError = FString::Printf(TEXT("txt2img SaveImage node %s has no linked image input."), *Layout.ImageNodeKey);
+		return false;
+	}
 
-	const FString NodeKey = LexToString(LoadNodeId);
-	const TSharedPtr<FJsonObject>* NodeObj = nullptr;
-	const TSharedPtr<FJsonObject>* InputsObj = nullptr;
-	TSharedPtr<FJsonValue> ExistingValue;
+	TMap<FString, TSharedPtr<FJsonValue>> Redirects;
+	Redirects.Add(LexToString(LoadNodeId), GeneratedImage);
+	AppendShiftedNodes(ChordPrompt, Layout.ChordNodeOffset, Redirects, TSet<FString>(), OutPrompt);
+	if (RemoveUnselectedChannelNodes(Settings, OutPrompt, Layout.ChordNodeOffset) > 0)
+	{
+		RemoveDeadNodes(OutPrompt);
+	}
+	return true;
+}
 
-	bool bUsedObject = false;
-	if (OutPrompt->TryGetObjectField(NodeKey, NodeObj) && (*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+bool FComfyWorkflowUtils::BuildBatchedChordPrompt(const UChordPBRSettings& Settings, const TArray<FComfyImageReference>& UploadedImages, TSharedPtr<FJsonObject>& OutPrompt, int32& OutBranchStride, FString& OutError)
+{
+	TSharedPtr<FJsonObject> Template;
+	if (!LoadTemplateInternal(Settings.ChordImg2PbrApiPromptPath, Template, OutError))
 	{
-		ExistingValue = (*InputsObj)->TryGetField(Binding.LoadImageInputName);
-		if (ExistingValue.IsValid() && ExistingValue->Type == EJson::Object)
+		return false;
+	}
+
+	const int32 LoadNodeId = ResolveNodeId(Template, Settings.ChordBinding.LoadImageNodeId, Settings.ChordBinding.LoadImageInputName);
+	const FString LoadNodeKey = LexToString(LoadNodeId);
+
+	// Nodes without links (the model loader) compute the same thing in every branch, so only branch 0 keeps them.
+	TSet<FString> SharedKeys;
+	for (const auto& NodeKV : Template->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		if (NodeKV.Key == LoadNodeKey || !NodeKV.Value->TryGetObject(NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
 		{
-			TSharedPtr<FJsonObject> ImageObj = ExistingValue->AsObject();
-			if (ImageObj.IsValid())
-			{
-				if (ImageObj->HasField(TEXT("filename")))
-				{
-					ImageObj->SetStringField(TEXT("filename"), UploadedImage.Filename);
-				}
-				else
-				{
-					ImageObj->SetStringField(TEXT("image"), UploadedImage.Filename);
-				}
+			continue;
+		}
 
-				if (!UploadedImage.Subfolder.IsEmpty())
-				{
-					ImageObj->SetStringField(TEXT("subfolder"), UploadedImage.Subfolder);
-				}
+		bool bHasLink = false;
+		for (const auto& InputKV : (*InputsObj)->Values)
+		{
+			FString LinkedNodeKey;
+			bHasLink |= IsNodeLink(InputKV.Value, LinkedNodeKey);
+		}
+		if (!bHasLink)
+		{
+			SharedKeys.Add(NodeKV.Key);
+		}
+	}
 
-				if (!UploadedImage.Type.IsEmpty())
-				{
-					ImageObj->SetStringField(TEXT("type"), UploadedImage.Type);
-				}
+	OutBranchStride = GetNodeIdStride(Template);
+	OutPrompt = MakeShared<FJsonObject>();
+	for (int32 BranchIdx = 0; BranchIdx < UploadedImages.Num(); ++BranchIdx)
+	{
+		TSharedPtr<FJsonObject> Branch;
+		if (!LoadTemplateInternal(Settings.ChordImg2PbrApiPromptPath, Branch, OutError) || !SetChordSourceImage(Settings, Branch, UploadedImages[BranchIdx], OutError))
+		{
+			return false;
+		}
+		AppendShiftedNodes(Branch, BranchIdx * OutBranchStride, TMap<FString, TSharedPtr<FJsonValue>>(), BranchIdx == 0 ? TSet<FString>() : SharedKeys, OutPrompt);
+	}
 
-				bUsedObject = true;
+	int32 NumRemoved = 0;
+	for (int32 BranchIdx = 0; BranchIdx < UploadedImages.Num(); ++BranchIdx)
+	{
+		NumRemoved += RemoveUnselectedChannelNodes(Settings, OutPrompt, BranchIdx * OutBranchStride);
+	}
+	if (NumRemoved > 0)
+	{
+		RemoveDeadNodes(OutPrompt);
+	}
+
+	return true;
+}
+
+bool FComfyWorkflowUtils::GetFusedPromptLayout(const UChordPBRSettings& Settings, FComfyFusedPromptLayout& OutLayout, FString& OutError)
+{
+	TSharedPtr<FJsonObject> Txt2ImgPrompt;
+	return LoadTemplateInternal(Settings.Txt2ImgApiPromptPath, Txt2ImgPrompt, OutError) && ResolveFusedLayout(Txt2ImgPrompt, OutLayout, OutError);
+}
+
+void FComfyWorkflowUtils::ConvertToWarmUpPrompt(const TSharedPtr<FJsonObject>& Prompt)
+{
+	if (!Prompt.IsValid())
+	{
+		return;
+	}
+
+	constexpr double WarmUpLatentSize = 64.0;
+	for (const auto& NodeKV : Prompt->Values)
+	{
+		const TSharedPtr<FJsonObject>* NodeObj = nullptr;
+		const TSharedPtr<FJsonObject>* InputsObj = nullptr;
+		if (!NodeKV.Value->TryGetObject(NodeObj) || !(*NodeObj)->TryGetObjectField(TEXT("inputs"), InputsObj))
+		{
+			continue;
+		}
+
+		FString ClassType;
+		(*NodeObj)->TryGetStringField(TEXT("class_type"), ClassType);
+		if (ClassType == TEXT("SaveImage") || ClassType == TEXT("SaveImageWebsocket"))
+		{
+			(*NodeObj)->SetStringField(TEXT("class_type"), TEXT("PreviewImage"));
+			(*InputsObj)->RemoveField(TEXT("filename_prefix"));
+			continue;
+		}
+
+		double Number = 0.0;
+		if ((*InputsObj)->TryGetNumberField(TEXT("steps"), Number))
+		{
+			(*InputsObj)->SetNumberField(TEXT("steps"), 1.0);
+		}
+
+		// Only empty-latent style nodes carry a batch size next to their dimensions.
+		if ((*InputsObj)->HasField(TEXT("batch_size")))
+		{
+			(*InputsObj)->SetNumberField(TEXT("batch_size"), 1.0);
+			if ((*InputsObj)->TryGetNumberField(TEXT("width"), Number))
+			{
+				(*InputsObj)->SetNumberField(TEXT("width"), WarmUpLatentSize);
+			}
+			if ((*InputsObj)->TryGetNumberField(TEXT("height"), Number))
+			{
+				(*InputsObj)->SetNumberField(TEXT("height"), WarmUpLatentSize);
 			}
 		}
 	}
+}
 
-	if (!bUsedObject)
+bool FComfyWorkflowUtils::ResolvePBRChannelForNode(const UChordPBRSettings& Settings, const FString& NodeId, FString& OutChannelName)
+{
+	const FComfyChordBinding& Binding = Settings.ChordBinding;
+	const TPair<const TCHAR*, const FComfyPBRChannelBinding*> Channels[] =
+	{
+		{ TEXT("BaseColor"), &Binding.BaseColor },
+		{ TEXT("Normal"), &Binding.Normal },
+		{ TEXT("Roughness"), &Binding.Roughness },
+		{ TEXT("Metallic"), &Binding.Metallic },
+		{ TEXT("Height"), &Binding.Height }
+	};
+
+	for (const auto& Channel : Channels)
 	{
-		SetInputField(OutPrompt, LoadNodeId, Binding.LoadImageInputName, MakeShared<FJsonValueString>(ResolvedName));
+		if (Channel.Value->NodeId >= 0 && LexToString(Channel.Value->NodeId) == NodeId)
+		{
+			OutChannelName = Channel.Key;
+			return true;
+		}
 	}
 
-	return true;
+	return false;
 }
 
-bool FComfyWorkflowUtils::ExtractImagesFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TArray<FComfyImageReference>& OutImages, FString& OutError)
+bool FComfyWorkflowUtils::ExtractImagesFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TArray<FComfyImageReference>& OutImages, FString& OutError, const FString& OnlyNodeKey)
 {
 	if (!History.IsValid())
 	{
@@ -336,7 +867,7 @@ bool FComfyWorkflowUtils::ExtractImagesFromHistory(const UChordPBRSettings& Sett
 				for (const auto& OutputKV : (*OutputsObj)->Values)
 				{
 					const TSharedPtr<FJsonObject>* OutputObj = nullptr;
-					if (OutputKV.Value->TryGetObject(OutputObj))
+					if ((OnlyNodeKey.IsEmpty() || OutputKV.Key == OnlyNodeKey) && OutputKV.Value->TryGetObject(OutputObj))
 					{
 						const TArray<TSharedPtr<FJsonValue>>* ImagesArray = nullptr;
 						if ((*OutputObj)->TryGetArrayField(TEXT("images"), ImagesArray))
@@ -379,7 +910,7 @@ static FString ToLower(const FString& In)
 	return Lower;
 }
 
-bool FComfyWorkflowUtils::ExtractPBRFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TMap<FString, FComfyImageReference>& OutChannels, FString& OutError)
+bool FComfyWorkflowUtils::ExtractPBRFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TMap<FString, FComfyImageReference>& OutChannels, FString& OutError, int32 NodeIdOffset, int32 NodeIdRange)
 {
 	if (!History.IsValid())
 	{
@@ -440,12 +971,24 @@ bool FComfyWorkflowUtils::ExtractPBRFromHistory(const UChordPBRSettings& Setting
 	};
 
 	TMap<FString, TArray<FComfyImageReference>> Outputs = CollectOutputs(History);
+	if (NodeIdRange > 0)
+	{
+		// Other CHORD branches of a batched prompt produce the same file names; only this branch's nodes count.
+		for (auto It = Outputs.CreateIterator(); It; ++It)
+		{
+			const int32 NodeId = FCString::Atoi(*It.Key());
+			if (!It.Key().IsNumeric() || NodeId < NodeIdOffset || NodeId >= NodeIdOffset + NodeIdRange)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
 
 	auto ResolveByBinding = [&](const FComfyPBRChannelBinding& ChannelBinding, const FString& DefaultHint, FComfyImageReference& OutRef) -> bool
 	{
 		if (ChannelBinding.NodeId >= 0)
 		{
-			const FString NodeKey = LexToString(ChannelBinding.NodeId);
+			const FString NodeKey = LexToString(ChannelBinding.NodeId + NodeIdOffset);
 			if (Outputs.Contains(NodeKey))
 			{
 				OutRef = Outputs[NodeKey][0];
@@ -475,6 +1018,12 @@ bool FComfyWorkflowUtils::ExtractPBRFromHistory(const UChordPBRSettings& Setting
 
 	for (int32 Index = 0; Index < ChannelNames.Num(); ++Index)
 	{
+		// Unselected channels were pruned from the prompt; nothing to find.
+		if (!Settings.ChordOutputChannels.IsEnabled(ChannelNames[Index]))
+		{
+			continue;
+		}
+
 		FComfyImageReference Ref;
 		if (ResolveByBinding(Channels[Index], DefaultChannelHints.IsValidIndex(Index) ? DefaultChannelHints[Index] : ChannelNames[Index], Ref))
 		{
@@ -2,175 +2,103 @@
 
 #include "GeminiApiClient.h"
 #include "ChordImageUtils.h"
+#include "ChordPBRGeneratorModule.h"
+#include "ChordPBRSettings.h"
+#include "Containers/Ticker.h"
+#include "HAL/PlatformTime.h"
 #include "HttpModule.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
 #include "Serialization/JsonReader.h"
 #include "Serialization/JsonSerializer.h"
 #include "Misc/Base64.h"
+#include "Misc/ScopeLock.h"
 #include "Async/Async.h"
 
-void FGeminiApiClient::GenerateImageAsync(
-	const FString& ApiEndpoint,
-	const FString& ApiKey,
-	const FString& Model,
-	const FString& Prompt,
-	FOnGeminiImageGenerated OnComplete)
+namespace
 {
-	if (bIsRequestInProgress)
-	{
-		OnComplete.ExecuteIfBound(nullptr, TEXT("A request is already in progress."));
-		return;
-	}
+	constexpr double RateWindowSeconds = 60.0;
+	constexpr float RetryBaseDelaySeconds = 2.0f;
+	constexpr float MaxRetryDelaySeconds = 60.0f;
 
-	if (ApiKey.IsEmpty())
+	FString BuildRequestBody(const FString& Prompt)
 	{
-		OnComplete.ExecuteIfBound(nullptr, TEXT("Gemini API key is not configured."));
-		return;
-	}
+		TSharedRef<FJsonObject> RequestBody = MakeShared<FJsonObject>();
 
-	bIsRequestInProgress = true;
-
-	// Build the request URL
-	const FString Url = FString::Printf(TEXT("%s/%s:generateContent"), *ApiEndpoint, *Model);
-
-	// Build the request body
-	TSharedRef<FJsonObject> RequestBody = MakeShared<FJsonObject>();
-	
-	// Contents array
-	TArray<TSharedPtr<FJsonValue>> ContentsArray;
-	TSharedPtr<FJsonObject> ContentObj = MakeShared<FJsonObject>();
-	
-	TArray<TSharedPtr<FJsonValue>> PartsArray;
-	TSharedPtr<FJsonObject> TextPart = MakeShared<FJsonObject>();
-	TextPart->SetStringField(TEXT("text"), Prompt);
-	PartsArray.Add(MakeShared<FJsonValueObject>(TextPart));
-	
-	ContentObj->SetArrayField(TEXT("parts"), PartsArray);
-	ContentsArray.Add(MakeShared<FJsonValueObject>(ContentObj));
-	RequestBody->SetArrayField(TEXT("contents"), ContentsArray);
-
-	// Generation config - request image output
-	TSharedPtr<FJsonObject> GenerationConfig = MakeShared<FJsonObject>();
-	TArray<TSharedPtr<FJsonValue>> ResponseModalities;
-	ResponseModalities.Add(MakeShared<FJsonValueString>(TEXT("TEXT")));
-	ResponseModalities.Add(MakeShared<FJsonValueString>(TEXT("IMAGE")));
-	GenerationConfig->SetArrayField(TEXT("responseModalities"), ResponseModalities);
-	
-	RequestBody->SetObjectField(TEXT("generationConfig"), GenerationConfig);
-
-	// Serialize to JSON string
-	FString RequestBodyString;
-	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&RequestBodyString);
-	FJsonSerializer::Serialize(RequestBody, Writer);
-
-	// Create HTTP request
-	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
-	HttpRequest->SetURL(Url);
-	HttpRequest->SetVerb(TEXT("POST"));
-	HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
-	HttpRequest->SetHeader(TEXT("x-goog-api-key"), ApiKey);
-	HttpRequest->SetContentAsString(RequestBodyString);
+		// Contents array
+		TArray<TSharedPtr<FJsonValue>> ContentsArray;
+		TSharedPtr<FJsonObject> ContentObj = MakeShared<FJsonObject>();
 
-	PendingRequest = HttpRequest;
+		TArray<TSharedPtr<FJsonValue>> PartsArray;
+		TSharedPtr<FJsonObject> TextPart = MakeShared<FJsonObject>();
+		TextPart->SetStringField(TEXT("text"), Prompt);
+		PartsArray.Add(MakeShared<FJsonValueObject>(TextPart));
 
-	// Set up response handler
-	HttpRequest->OnProcessRequestComplete().BindLambda([this, OnComplete](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
-	{
-		bIsRequestInProgress = false;
-		PendingRequest.Reset();
+		ContentObj->SetArrayField(TEXT("parts"), PartsArray);
+		ContentsArray.Add(MakeShared<FJsonValueObject>(ContentObj));
+		RequestBody->SetArrayField(TEXT("contents"), ContentsArray);
 
-		if (!bWasSuccessful || !Response.IsValid())
-		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("HTTP request failed."));
-			});
-			return;
-		}
+		// Generation config - request image output
+		TSharedPtr<FJsonObject> GenerationConfig = MakeShared<FJsonObject>();
+		TArray<TSharedPtr<FJsonValue>> ResponseModalities;
+		ResponseModalities.Add(MakeShared<FJsonValueString>(TEXT("TEXT")));
+		ResponseModalities.Add(MakeShared<FJsonValueString>(TEXT("IMAGE")));
+		GenerationConfig->SetArrayField(TEXT("responseModalities"), ResponseModalities);
 
-		const int32 ResponseCode = Response->GetResponseCode();
-		const FString ResponseContent = Response->GetContentAsString();
+		RequestBody->SetObjectField(TEXT("generationConfig"), GenerationConfig);
 
-		if (ResponseCode != 200)
-		{
-			FString ErrorMessage = FString::Printf(TEXT("API error (HTTP %d): %s"), ResponseCode, *ResponseContent);
-			AsyncTask(ENamedThreads::GameThread, [OnComplete, ErrorMessage]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, ErrorMessage);
-			});
-			return;
-		}
+		FString RequestBodyString;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&RequestBodyString);
+		FJsonSerializer::Serialize(RequestBody, Writer);
+		return RequestBodyString;
+	}
 
-		// Parse JSON response
+	// Response structure: { "candidates": [{ "content": { "parts": [{ "inlineData": { "mimeType": "...", "data": "base64..." } }] } }] }
+	bool ParseImageResponse(const FString& ResponseContent, TArray<uint8>& OutImageData, FString& OutError)
+	{
 		TSharedPtr<FJsonObject> JsonResponse;
 		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseContent);
 		if (!FJsonSerializer::Deserialize(Reader, JsonResponse) || !JsonResponse.IsValid())
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("Failed to parse API response."));
-			});
-			return;
+			OutError = TEXT("Failed to parse API response.");
+			return false;
 		}
 
-		// Extract image data from response
-		// Response structure: { "candidates": [{ "content": { "parts": [{ "inlineData": { "mimeType": "...", "data": "base64..." } }] } }] }
 		const TArray<TSharedPtr<FJsonValue>>* Candidates = nullptr;
 		if (!JsonResponse->TryGetArrayField(TEXT("candidates"), Candidates) || Candidates->Num() == 0)
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("No candidates in response."));
-			});
-			return;
+			OutError = TEXT("No candidates in response.");
+			return false;
 		}
 
 		const TSharedPtr<FJsonObject>* CandidateObj = nullptr;
 		if (!(*Candidates)[0]->TryGetObject(CandidateObj))
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("Invalid candidate format."));
-			});
-			return;
+			OutError = TEXT("Invalid candidate format.");
+			return false;
 		}
 
 		const TSharedPtr<FJsonObject>* ContentObjPtr = nullptr;
 		if (!(*CandidateObj)->TryGetObjectField(TEXT("content"), ContentObjPtr))
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("No content in candidate."));
-			});
-			return;
+			OutError = TEXT("No content in candidate.");
+			return false;
 		}
 
 		const TArray<TSharedPtr<FJsonValue>>* Parts = nullptr;
 		if (!(*ContentObjPtr)->TryGetArrayField(TEXT("parts"), Parts))
 		{
 			// Log the actual response for debugging
-			FString DebugResponse = ResponseContent.Left(500); // First 500 chars
-			AsyncTask(ENamedThreads::GameThread, [OnComplete, DebugResponse]()
-			{
-				FString ErrorMsg = FString::Printf(TEXT("No parts in content. API Response: %s..."), *DebugResponse);
-				OnComplete.ExecuteIfBound(nullptr, ErrorMsg);
-			});
-			return;
+			OutError = FString::Printf(TEXT("No parts in content. API Response: %s..."), *ResponseContent.Left(500));
+			return false;
 		}
 
-		// Check if parts array is empty
 		if (Parts->Num() == 0)
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
-			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("Parts array is empty. The model may not support image generation or failed to generate an image."));
-			});
-			return;
+			OutError = TEXT("Parts array is empty. The model may not support image generation or failed to generate an image.");
+			return false;
 		}
 
-		// Find image part
-		TArray<uint8> ImageData;
 		for (const TSharedPtr<FJsonValue>& PartValue : *Parts)
 		{
 			const TSharedPtr<FJsonObject>* PartObj = nullptr;
@@ -180,50 +108,380 @@ void FGeminiApiClient::GenerateImageAsync(
 			}
 
 			const TSharedPtr<FJsonObject>* InlineDataObj = nullptr;
-			if ((*PartObj)->TryGetObjectField(TEXT("inlineData"), InlineDataObj))
+			FString Base64Data;
+			if ((*PartObj)->TryGetObjectField(TEXT("inlineData"), InlineDataObj) && (*InlineDataObj)->TryGetStringField(TEXT("data"), Base64Data))
+			{
+				FBase64::Decode(Base64Data, OutImageData);
+				break;
+			}
+		}
+
+		if (OutImageData.Num() == 0)
+		{
+			OutError = TEXT("No image data found in response.");
+			return false;
+		}
+		return true;
+	}
+
+	// A 429 from the Gemini API names its wait in error.details[].retryDelay ("23s") rather than a Retry-After header.
+	float ParseRetryDelaySeconds(const FString& ResponseContent)
+	{
+		TSharedPtr<FJsonObject> JsonResponse;
+		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseContent);
+		const TSharedPtr<FJsonObject>* ErrorObj = nullptr;
+		const TArray<TSharedPtr<FJsonValue>>* Details = nullptr;
+		if (!FJsonSerializer::Deserialize(Reader, JsonResponse) || !JsonResponse.IsValid()
+			|| !JsonResponse->TryGetObjectField(TEXT("error"), ErrorObj) || !(*ErrorObj)->TryGetArrayField(TEXT("details"), Details))
+		{
+			return 0.0f;
+		}
+
+		for (const TSharedPtr<FJsonValue>& Detail : *Details)
+		{
+			const TSharedPtr<FJsonObject>* DetailObj = nullptr;
+			FString RetryDelay;
+			if (Detail->TryGetObject(DetailObj) && (*DetailObj)->TryGetStringField(TEXT("retryDelay"), RetryDelay))
 			{
-				FString Base64Data;
-				if ((*InlineDataObj)->TryGetStringField(TEXT("data"), Base64Data))
-				{
-					FBase64::Decode(Base64Data, ImageData);
-					break;
-				}
+				return FCString::Atof(*RetryDelay.LeftChop(RetryDelay.EndsWith(TEXT("s")) ? 1 : 0));
 			}
 		}
+		return 0.0f;
+	}
+}
+
+FGeminiApiClient& FGeminiApiClient::Get()
+{
+	static FGeminiApiClient Client;
+	return Client;
+}
 
-		if (ImageData.Num() == 0)
+FGeminiRequestHandle FGeminiApiClient::GenerateImageAsync(
+	const UChordPBRSettings& Settings,
+	const FString& Prompt,
+	FOnGeminiImageGenerated OnComplete,
+	const FChordCancellationTokenPtr& CancellationToken,
+	float TimeoutSeconds)
+{
+	const FRequestRef Request = MakeShared<FRequest, ESPMode::ThreadSafe>();
+	Request->OnComplete = MoveTemp(OnComplete);
+	Request->CancellationToken = CancellationToken;
+	Request->TimeoutSeconds = TimeoutSeconds;
+	if (Settings.GeminiApiKey.IsEmpty() || (CancellationToken.IsValid() && CancellationToken->IsCancelled()))
+	{
+		Finish(Request, TArray<uint8>(), Settings.GeminiApiKey.IsEmpty() ? TEXT("Gemini API key is not configured.") : TEXT("Cancelled."));
+		return 0;
+	}
+
+	Request->Url = FString::Printf(TEXT("%s/%s:generateContent"), *Settings.GeminiApiEndpoint, *Settings.GeminiModel);
+	Request->ApiKey = Settings.GeminiApiKey;
+	Request->Body = BuildRequestBody(Prompt);
+
+	FGeminiRequestHandle Handle = 0;
+	bool bAlreadyCancelled = false;
+	{
+		FScopeLock Lock(&Mutex);
+		MaxConcurrentRequests = FMath::Max(1, Settings.GeminiMaxConcurrentRequests);
+		RequestsPerMinute = FMath::Max(0, Settings.GeminiRequestsPerMinute);
+		MaxRetries = FMath::Max(0, Settings.GeminiMaxRetries);
+		Handle = NextHandle++;
+		Request->Handle = Handle;
+
+		// Hooked up before the request is visible to Pump, so Finish always sees the hook it has to remove. A token
+		// cancelled in the meantime runs the callback on the spot, before there is anything to cancel.
+		if (CancellationToken.IsValid())
 		{
-			AsyncTask(ENamedThreads::GameThread, [OnComplete]()
+			Request->CancelHook = CancellationToken->Register([Handle]()
 			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("No image data found in response."));
+				FGeminiApiClient::Get().CancelRequest(Handle);
 			});
-			return;
+			bAlreadyCancelled = Request->CancelHook == 0;
+		}
+		if (!bAlreadyCancelled)
+		{
+			Waiting.Add(Request);
+		}
+	}
+
+	if (bAlreadyCancelled)
+	{
+		Finish(Request, TArray<uint8>(), TEXT("Cancelled."));
+		return 0;
+	}
+
+	Pump();
+	return Handle;
+}
+
+void FGeminiApiClient::CancelRequest(FGeminiRequestHandle Handle)
+{
+	TSharedPtr<FRequest, ESPMode::ThreadSafe> Queued;
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> InFlight;
+	{
+		FScopeLock Lock(&Mutex);
+		const int32 WaitingIdx = Waiting.IndexOfByPredicate([Handle](const FRequestRef& Request) { return Request->Handle == Handle; });
+		if (WaitingIdx != INDEX_NONE)
+		{
+			Queued = Waiting[WaitingIdx];
+			Waiting.RemoveAt(WaitingIdx);
+		}
+		else if (const FRequestRef* Request = Running.Find(Handle))
+		{
+			(*Request)->bCancelled = true;
+			InFlight = (*Request)->HttpRequest;
 		}
+	}
+
+	// The running request reports the cancellation from its completion handler.
+	if (Queued.IsValid())
+	{
+		Finish(Queued.ToSharedRef(), TArray<uint8>(), TEXT("Cancelled."));
+	}
+	else if (InFlight.IsValid())
+	{
+		InFlight->CancelRequest();
+	}
+}
+
+void FGeminiApiClient::Pump()
+{
+	TArray<FRequestRef> ToStart;
+	double WakeAt = 0.0;
+	{
+		FScopeLock Lock(&Mutex);
+		const double Now = FPlatformTime::Seconds();
+		RecentStarts.RemoveAll([Now](double Start) { return Start <= Now - RateWindowSeconds; });
 
-		// Create texture from image data on game thread
-		AsyncTask(ENamedThreads::GameThread, [OnComplete, ImageData = MoveTemp(ImageData)]()
+		for (int32 WaitingIdx = 0; WaitingIdx < Waiting.Num() && Running.Num() < MaxConcurrentRequests && Now >= PausedUntil; )
 		{
-			UTexture2D* Texture = FChordImageUtils::CreateTextureFromImage(ImageData, TEXT("GeminiGeneratedImage"));
-			if (Texture)
+			if (RequestsPerMinute > 0 && RecentStarts.Num() >= RequestsPerMinute)
 			{
-				OnComplete.ExecuteIfBound(Texture, FString());
+				WakeAt = RecentStarts[0] + RateWindowSeconds;
+				break;
 			}
-			else
+
+			// A retry keeps its place in line but lets later requests past while it waits out its delay.
+			const FRequestRef Request = Waiting[WaitingIdx];
+			if (Request->NotBefore > Now)
 			{
-				OnComplete.ExecuteIfBound(nullptr, TEXT("Failed to create texture from image data."));
+				WakeAt = WakeAt > 0.0 ? FMath::Min(WakeAt, Request->NotBefore) : Request->NotBefore;
+				++WaitingIdx;
+				continue;
 			}
-		});
+
+			Waiting.RemoveAt(WaitingIdx);
+			Running.Add(Request->Handle, Request);
+			RecentStarts.Add(Now);
+			ToStart.Add(Request);
+		}
+
+		if (Waiting.Num() > 0 && Now < PausedUntil)
+		{
+			WakeAt = PausedUntil;
+		}
+
+		// One wake-up at a time is enough unless this one is due sooner; completions pump on their own.
+		if (WakeAt > 0.0 && (ScheduledWakeAt <= Now || WakeAt < ScheduledWakeAt))
+		{
+			ScheduledWakeAt = WakeAt;
+		}
+		else
+		{
+			WakeAt = 0.0;
+		}
+	}
+
+	for (const FRequestRef& Request : ToStart)
+	{
+		StartRequest(Request);
+	}
+
+	if (WakeAt > 0.0)
+	{
+		const float Delay = static_cast<float>(FMath::Max(WakeAt - FPlatformTime::Seconds(), 0.01));
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+		{
+			FGeminiApiClient::Get().Pump();
+			return false;
+		}), Delay);
+	}
+}
+
+void FGeminiApiClient::StartRequest(const FRequestRef& Request)
+{
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetURL(Request->Url);
+	HttpRequest->SetVerb(TEXT("POST"));
+	HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+	HttpRequest->SetHeader(TEXT("x-goog-api-key"), Request->ApiKey);
+	HttpRequest->SetContentAsString(Request->Body);
+	HttpRequest->OnProcessRequestComplete().BindLambda([Request](FHttpRequestPtr, FHttpResponsePtr Response, bool bWasSuccessful)
+	{
+		FGeminiApiClient::Get().HandleResponse(Request, Response, bWasSuccessful);
 	});
 
+	bool bCancelled = false;
+	{
+		FScopeLock Lock(&Mutex);
+		Request->HttpRequest = HttpRequest;
+		bCancelled = Request->bCancelled;
+	}
+
 	HttpRequest->ProcessRequest();
+
+	// Cancelled between being picked and getting its HTTP request; that cancel found nothing to abort.
+	if (bCancelled)
+	{
+		HttpRequest->CancelRequest();
+		return;
+	}
+
+	// The clock starts now: time spent waiting for the rate budget is not the API being slow.
+	if (Request->TimeoutSeconds > 0.0f)
+	{
+		const FGeminiRequestHandle Handle = Request->Handle;
+		const int32 Attempt = Request->Attempt;
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Handle, Attempt](float)
+		{
+			FGeminiApiClient::Get().TimeOutRequest(Handle, Attempt);
+			return false;
+		}), Request->TimeoutSeconds);
+	}
 }
 
-void FGeminiApiClient::CancelRequest()
+void FGeminiApiClient::TimeOutRequest(FGeminiRequestHandle Handle, int32 Attempt)
 {
-	if (PendingRequest.IsValid())
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> InFlight;
+	{
+		FScopeLock Lock(&Mutex);
+		const FRequestRef* Request = Running.Find(Handle);
+		if (!Request || (*Request)->Attempt != Attempt)
+		{
+			return;
+		}
+		(*Request)->bTimedOut = true;
+		InFlight = (*Request)->HttpRequest;
+	}
+
+	if (InFlight.IsValid())
+	{
+		InFlight->CancelRequest();
+	}
+}
+
+void FGeminiApiClient::HandleResponse(const FRequestRef& Request, const FHttpResponsePtr& Response, bool bSucceeded)
+{
+	const int32 ResponseCode = bSucceeded && Response.IsValid() ? Response->GetResponseCode() : 0;
+	const bool bTransient = ResponseCode == 0 || ResponseCode == 429 || ResponseCode >= 500;
+	bool bRetry = false;
+	bool bCancelled = false;
+	bool bTimedOut = false;
+	{
+		FScopeLock Lock(&Mutex);
+		Running.Remove(Request->Handle);
+		Request->HttpRequest.Reset();
+		bCancelled = Request->bCancelled || (Request->CancellationToken.IsValid() && Request->CancellationToken->IsCancelled());
+		bTimedOut = Request->bTimedOut;
+		if (!bCancelled && !bTimedOut && bTransient && Request->Attempt < MaxRetries)
+		{
+			const float Delay = GetRetryDelaySeconds(Request->Attempt, Response);
+			const double Now = FPlatformTime::Seconds();
+			++Request->Attempt;
+			Request->NotBefore = Now + Delay;
+			// The quota is per key: everyone else would only collect another 429.
+			if (ResponseCode == 429)
+			{
+				PausedUntil = FMath::Max(PausedUntil, Request->NotBefore);
+			}
+			Waiting.Insert(Request, 0);
+			bRetry = true;
+
+			const FString Reason = ResponseCode > 0 ? FString::Printf(TEXT("HTTP %d"), ResponseCode) : TEXT("no response");
+			UE_LOG(LogChordPBRGenerator, Warning, TEXT("Gemini request failed (%s); retry %d/%d in %.1f s."), *Reason, Request->Attempt, MaxRetries, Delay);
+		}
+	}
+
+	if (bRetry)
+	{
+		Pump();
+		return;
+	}
+
+	TArray<uint8> ImageData;
+	FString Error;
+	if (bCancelled)
+	{
+		Error = TEXT("Cancelled.");
+	}
+	else if (bTimedOut)
+	{
+		Error = FString::Printf(TEXT("Gemini did not answer within %.0f seconds."), Request->TimeoutSeconds);
+	}
+	else if (ResponseCode == 0)
+	{
+		Error = TEXT("HTTP request failed.");
+	}
+	else if (ResponseCode == 429)
+	{
+		Error = FString::Printf(TEXT("Gemini rate limit or quota exceeded (HTTP 429): %s"), *Response->GetContentAsString().Left(500));
+	}
+	else if (ResponseCode != 200)
+	{
+		Error = FString::Printf(TEXT("API error (HTTP %d): %s"), ResponseCode, *Response->GetContentAsString());
+	}
+	else
+	{
+		ParseImageResponse(Response->GetContentAsString(), ImageData, Error);
+	}
+
+	Finish(Request, MoveTemp(ImageData), Error);
+	Pump();
+}
+
+void FGeminiApiClient::Finish(const FRequestRef& Request, TArray<uint8>&& ImageData, const FString& Error)
+{
+	if (Request->CancellationToken.IsValid())
+	{
+		Request->CancellationToken->Unregister(Request->CancelHook);
+	}
+
+	// Create texture from image data on game thread
+	AsyncTask(ENamedThreads::GameThread, [OnComplete = MoveTemp(Request->OnComplete), ImageData = MoveTemp(ImageData), Error]()
+	{
+		if (!Error.IsEmpty())
+		{
+			OnComplete.ExecuteIfBound(nullptr, Error);
+			return;
+		}
+
+		UTexture2D* Texture = FChordImageUtils::CreateTextureFromImage(ImageData, TEXT("GeminiGeneratedImage"));
+		if (Texture)
+		{
+			OnComplete.ExecuteIfBound(Texture, FString());
+		}
+		else
+		{
+			OnComplete.ExecuteIfBound(nullptr, TEXT("Failed to create texture from image data."));
+		}
+	});
+}
+
+float FGeminiApiClient::GetRetryDelaySeconds(int32 Attempt, const FHttpResponsePtr& Response) const
+{
+	const float Backoff = FMath::Min(RetryBaseDelaySeconds * FMath::Pow(2.0f, static_cast<float>(Attempt)), MaxRetryDelaySeconds);
+
+	// Half fixed, half random, so parallel requests that failed together do not retry in lockstep.
+	float DelaySeconds = Backoff * 0.5f + FMath::FRandRange(0.0f, Backoff * 0.5f);
+	if (!Response.IsValid())
+	{
+		return DelaySeconds;
+	}
+
+	const FString RetryAfter = Response->GetHeader(TEXT("Retry-After"));
+	const float Requested = RetryAfter.IsNumeric() ? FCString::Atof(*RetryAfter) : ParseRetryDelaySeconds(Response->GetContentAsString());
+	if (Requested > 0.0f)
 	{
-		PendingRequest->CancelRequest();
-		PendingRequest.Reset();
-		bIsRequestInProgress = false;
+		DelaySeconds = FMath::Clamp(Requested, DelaySeconds, MaxRetryDelaySeconds);
 	}
+	return DelaySeconds;
 }
@@ -7,8 +7,10 @@
 #include "ChordPBRSettings.h"
 #include "ChordPBRGeneratorModule.h"
 #include "ChordImageUtils.h"
+#include "ChordJobScheduler.h"
+#include "ChordPromptMatrix.h"
+#include "ComfyServerPool.h"
 #include "ComfyUIClient.h"
-#include "GeminiApiClient.h"
 #include "ComfyWorkflowUtils.h"
 #include "ChordPBRSession.h"
 #include "Editor.h"
@@ -18,11 +20,13 @@
 #include "Misc/ConfigCacheIni.h"
 #include "Misc/FileHelper.h"
 #include "Misc/PackageName.h"
+#include "Misc/ScopeLock.h"
 #include "Misc/DateTime.h"
 #include "Misc/Paths.h"
 #include "GameFramework/Actor.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Materials/MaterialInterface.h"
+#include "Algo/Reverse.h"
 #include "Async/Async.h"
 #include "HAL/PlatformTime.h"
 #include "IContentBrowserSingleton.h"
@@ -58,48 +62,17 @@
 #include "Styling/SlateBrush.h"
 #include "DesktopPlatformModule.h"
 
-namespace
-{
-	static void ConfigurePBRTexture(UTexture2D* Texture, const FString& Channel)
-	{
-		if (!Texture)
-		{
-			return;
-		}
-
-		if (Channel == TEXT("Normal"))
-		{
-			Texture->SRGB = false;
-			Texture->CompressionSettings = TC_Normalmap;
-		}
-		else if (Channel == TEXT("BaseColor"))
-		{
-			Texture->SRGB = true;
-			Texture->CompressionSettings = TC_Default;
-		}
-		else if (Channel == TEXT("Height"))
-		{
-			Texture->SRGB = false;
-			Texture->CompressionSettings = TC_Grayscale;
-		}
-		else
-		{
-			Texture->SRGB = false;
-			Texture->CompressionSettings = TC_Masks;
-		}
-
-		Texture->PostEditChange();
-		Texture->UpdateResource();
-	}
-}
-
 void SChordPBRTab::Construct(const FArguments& InArgs)
 {
 	Session = MakeShared<FChordPBRSession>();
 	MainImageBrush = MakeShared<FSlateBrush>();
-	ComfyClient = MakeShared<FComfyUIClient>(*GetDefault<UChordPBRSettings>());
 	StatusMessage = TEXT("Idle");
 
+	FChordJobScheduler& Scheduler = FChordJobScheduler::Get();
+	JobChangedHandle = Scheduler.OnJobChanged().AddSP(this, &SChordPBRTab::HandleJobChanged);
+	JobPreviewFrameHandle = Scheduler.OnJobPreviewFrame().AddSP(this, &SChordPBRTab::HandleLivePreviewFrame);
+	JobImageReadyHandle = Scheduler.OnJobImageReady().AddSP(this, &SChordPBRTab::HandleJobImageReady);
+
 	ChildSlot
 	[
 		SNew(SSplitter)
@@ -117,6 +90,23 @@ void SChordPBRTab::Construct(const FArguments& InArgs)
 	];
 
 	RebuildThumbnails();
+
+	const UChordPBRSettings* Settings = GetDefault<UChordPBRSettings>();
+	if (Settings->bProbeServerOnTabOpen)
+	{
+		StartServerWarmUp(Settings->bWarmUpModelsOnTabOpen);
+	}
+
+	if (Settings->WarmUpIntervalMinutes > 0.0f)
+	{
+		WarmUpTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &SChordPBRTab::HandleWarmUpTick), Settings->WarmUpIntervalMinutes * 60.0f);
+	}
+
+	// Prompts the previous editor session left running; their results land in this gallery.
+	for (const FChordJobRef& Job : Scheduler.ResumeJournaledJobs())
+	{
+		TrackJob(Job);
+	}
 }
 
 FReply SChordPBRTab::OnKeyDown(const FGeometry& MyGeometry, const FKeyEvent& InKeyEvent)
@@ -132,6 +122,37 @@ FReply SChordPBRTab::OnKeyDown(const FGeometry& MyGeometry, const FKeyEvent& InK
 SChordPBRTab::~SChordPBRTab()
 {
 	RestorePreviewTarget(true);
+
+	if (WarmUpTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(WarmUpTickerHandle);
+	}
+	if (WarmUpToken.IsValid())
+	{
+		WarmUpToken->Cancel();
+	}
+
+	FChordJobScheduler& Scheduler = FChordJobScheduler::Get();
+	Scheduler.OnJobChanged().Remove(JobChangedHandle);
+	Scheduler.OnJobPreviewFrame().Remove(JobPreviewFrameHandle);
+	Scheduler.OnJobImageReady().Remove(JobImageReadyHandle);
+
+	// On editor exit the prompts stay queued and journaled for the next session.
+	if (IsEngineExitRequested())
+	{
+		Scheduler.DetachAll();
+		return;
+	}
+
+	// Nothing can consume the results once the tab is gone; jobs shared with another tab keep running for it.
+	for (const FChordJobRef& Job : ActiveJobs)
+	{
+		Scheduler.Release(Job);
+	}
+	for (const TPair<FGuid, FChordJobRef>& Speculative : SpeculativeJobs)
+	{
+		Scheduler.Release(Speculative.Value);
+	}
 }
 TSharedRef<SWidget> SChordPBRTab::BuildChat()
 {
@@ -204,6 +225,15 @@ TSharedRef<SWidget> SChordPBRTab::BuildChat()
 					.OnClicked(this, &SChordPBRTab::OnGenerateImages)
 				]
 
+				+ SWrapBox::Slot()
+				[
+					SNew(SButton)
+					.Text(NSLOCTEXT("ChordPBRGenerator", "RunPromptMatrix", "Run Matrix"))
+					.ToolTipText(NSLOCTEXT("ChordPBRGenerator", "RunPromptMatrixTooltip", "Generate every combination of the prompt's {a|b|c} groups, once per seed of a {seed:1-4} group. Each image is labeled by its values."))
+					.OnClicked(this, &SChordPBRTab::OnRunPromptMatrix)
+					.IsEnabled_Lambda([this]() { return PendingMatrixCells.Num() == 0 && MatrixJobIds.Num() == 0; })
+				]
+
 				+ SWrapBox::Slot()
 				[
 					SNew(SButton)
@@ -211,12 +241,20 @@ TSharedRef<SWidget> SChordPBRTab::BuildChat()
 					.OnClicked(this, &SChordPBRTab::OnGeneratePBRMaps)
 				]
 
+				+ SWrapBox::Slot()
+				[
+					SNew(SButton)
+					.Text(NSLOCTEXT("ChordPBRGenerator", "GenerateAllPBR", "PBR for All Images"))
+					.ToolTipText(NSLOCTEXT("ChordPBRGenerator", "GenerateAllPBRTooltip", "Generate PBR maps for every gallery image that has none, several images per prompt."))
+					.OnClicked(this, &SChordPBRTab::OnGenerateAllPBRMaps)
+				]
+
 				+ SWrapBox::Slot()
 				[
 					SNew(SButton)
 					.Text(NSLOCTEXT("ChordPBRGenerator", "Cancel", "Cancel"))
 					.OnClicked(this, &SChordPBRTab::OnCancel)
-					.IsEnabled_Lambda([this]() { return bIsRunning; })
+					.IsEnabled_Lambda([this]() { return ActiveJobs.Num() > 0; })
 				]
 			]
 
@@ -275,11 +313,23 @@ TSharedRef<SWidget> SChordPBRTab::BuildGallery()
 					.AutoWrapText(true)
 				]
 
-				// Right-aligned buttons: Save and Delete
+				// Right-aligned buttons: Keep Draft, Save and Delete
 				+ SHorizontalBox::Slot()
 				.AutoWidth()
 				.Padding(16.0f, 0.0f, 8.0f, 0.0f)
 				.VAlign(VAlign_Center)
+				[
+					SNew(SButton)
+					.Text(NSLOCTEXT("ChordPBRGenerator", "KeepDraftButton", "Keep Draft"))
+					.ToolTipText(NSLOCTEXT("ChordPBRGenerator", "KeepDraftTooltip", "Render this draft at full quality with the same prompt and seed."))
+					.OnClicked(this, &SChordPBRTab::OnKeepDraft)
+					.IsEnabled_Lambda([this]() { return CanKeepCurrentDraft(); })
+				]
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.Padding(0.0f, 0.0f, 8.0f, 0.0f)
+				.VAlign(VAlign_Center)
 				[
 					SNew(SButton)
 					.Text(NSLOCTEXT("ChordPBRGenerator", "SaveButton", "Save"))
@@ -331,7 +381,8 @@ TSharedRef<SWidget> SChordPBRTab::BuildGallery()
 							SAssignNew(MainImage, SImage)
 							.Image(TAttribute<const FSlateBrush*>::CreateLambda([this]()
 							{
-								return GetMainBrushForTexture(GetCurrentTexture(), FVector2D(420.0f, 420.0f));
+								UTexture2D* Texture = LivePreviewTexture.IsValid() ? LivePreviewTexture.Get() : GetCurrentTexture();
+								return GetMainBrushForTexture(Texture, FVector2D(420.0f, 420.0f));
 							}))
 						]
 					]
@@ -432,12 +483,24 @@ FReply SChordPBRTab::OnGenerateImages()
 	return FReply::Handled();
 }
 
+FReply SChordPBRTab::OnRunPromptMatrix()
+{
+	StartPromptMatrix();
+	return FReply::Handled();
+}
+
 FReply SChordPBRTab::OnGeneratePBRMaps()
 {
 	StartGeneratePBRAsync();
 	return FReply::Handled();
 }
 
+FReply SChordPBRTab::OnGenerateAllPBRMaps()
+{
+	StartGenerateBatchPBRAsync();
+	return FReply::Handled();
+}
+
 FReply SChordPBRTab::OnPreviousImage()
 {
 	if (CurrentLayer == EChordGalleryLayer::Detail)
@@ -570,6 +633,18 @@ FReply SChordPBRTab::OnDeleteCurrentImage()
 			RestorePreviewTarget(false);
 		}
 
+		// Nobody will look at maps for a deleted image
+		CancelSpeculativePBR(Item->Id);
+		if (const FGuid* FinalJobId = DraftFinalJobs.FindKey(Item->Id))
+		{
+			const FGuid JobId = *FinalJobId;
+			DraftFinalJobs.Remove(JobId);
+			if (const FChordJobRef* FinalJob = ActiveJobs.FindByPredicate([&JobId](const FChordJobRef& Candidate) { return Candidate->GetId() == JobId; }))
+			{
+				ReleaseJob(*FinalJob);
+			}
+		}
+
 		// Remove the image
 		if (Session->RemoveGeneratedImage(CurrentImageIndex))
 		{
@@ -907,8 +982,11 @@ FText SChordPBRTab::GetGalleryCaption() const
 	const int32 Count = Session->GetGeneratedImages().Num();
 	if (CurrentLayer == EChordGalleryLayer::Root)
 	{
+		const FChordGeneratedImageItem* Item = GetCurrentImageItem();
 		return FText::Format(
-			NSLOCTEXT("ChordPBRGenerator", "GalleryImagesFmt", "Generated Images ({0}/{1})"),
+			Item && Item->bDraft
+				? NSLOCTEXT("ChordPBRGenerator", "GalleryDraftFmt", "Generated Images ({0}/{1}) - draft")
+				: NSLOCTEXT("ChordPBRGenerator", "GalleryImagesFmt", "Generated Images ({0}/{1})"),
 			FText::AsNumber(CurrentImageIndex + 1),
 			FText::AsNumber(Count)
 		);
@@ -1113,592 +1191,1063 @@ FText SChordPBRTab::GetStatusText() const
 	return FText::FromString(StatusMessage);
 }
 
-void SChordPBRTab::SetStatusAsync(const FString& InStatus, bool bInRunning)
+void SChordPBRTab::HandleLivePreviewFrame(const FChordJobRef& Job, const TArray<uint8>& ImageData)
 {
-	if (IsInGameThread())
+	check(IsInGameThread());
+
+	// Only the newest image job drives the preview; frames from several jobs would flicker between them.
+	const int32 NewestImageJobIndex = ActiveJobs.FindLastByPredicate([](const FChordJobRef& Candidate)
+	{
+		return Candidate->GetType() == EChordJobType::TextToImage;
+	});
+	if (NewestImageJobIndex == INDEX_NONE || ActiveJobs[NewestImageJobIndex] != Job)
+	{
+		return;
+	}
+
+	// Drop frames while one is still decoding; the sampler produces them faster than they are worth showing.
+	if (bLivePreviewDecodeInFlight)
 	{
-		StatusMessage = InStatus;
-		bIsRunning = bInRunning;
 		return;
 	}
 
+	if (LivePreviewJobId != Job->GetId())
+	{
+		ClearLivePreview();
+		LivePreviewJobId = Job->GetId();
+	}
+
+	bLivePreviewDecodeInFlight = true;
 	TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
-	AsyncTask(ENamedThreads::GameThread, [WidgetWeak, InStatus, bInRunning]()
+	const FGuid JobId = Job->GetId();
+	EnqueueTask([WidgetWeak, ImageData, JobId]()
 	{
-		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+		TSharedRef<TArray64<uint8>, ESPMode::ThreadSafe> Pixels = MakeShared<TArray64<uint8>, ESPMode::ThreadSafe>();
+		int32 Width = 0;
+		int32 Height = 0;
+		const bool bDecoded = FChordImageUtils::DecodeImage(ImageData, *Pixels, Width, Height);
+
+		AsyncTask(ENamedThreads::GameThread, [WidgetWeak, Pixels, Width, Height, bDecoded, JobId]()
 		{
-			Pinned->StatusMessage = InStatus;
-			Pinned->bIsRunning = bInRunning;
-		}
+			TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin();
+			if (!Pinned.IsValid())
+			{
+				return;
+			}
+
+			Pinned->bLivePreviewDecodeInFlight = false;
+			if (!bDecoded || Pinned->LivePreviewJobId != JobId)
+			{
+				return;
+			}
+
+			if (!FChordImageUtils::UpdateTexturePixels(Pinned->LivePreviewTexture.Get(), *Pixels, Width, Height))
+			{
+				const FName PreviewName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), TEXT("LivePreview"));
+				Pinned->LivePreviewTexture.Reset(FChordImageUtils::CreateTextureFromPixels(*Pixels, Width, Height, PreviewName.ToString()));
+			}
+		});
 	});
 }
 
+void SChordPBRTab::ClearLivePreview()
+{
+	LivePreviewTexture.Reset();
+	LivePreviewJobId.Invalidate();
+}
+
 void SChordPBRTab::HandleError(const FString& Message)
 {
 	UE_LOG(LogChordPBRGenerator, Error, TEXT("%s"), *Message);
-	SetStatusAsync(Message, false);
+	StatusMessage = Message;
 }
 
-void SChordPBRTab::HandleComfyFailure(const FString& Context, const FString& Error)
+void SChordPBRTab::TrackJob(const FChordJobRef& Job)
 {
-	const FString Composed = FString::Printf(TEXT("%s: %s"), *Context, *Error);
-	HandleError(Composed);
+	ActiveJobs.Add(Job);
+	StatusMessage = FormatJobStatus(*Job);
 }
 
-void SChordPBRTab::EnqueueTask(TFunction<void()> InTask)
+void SChordPBRTab::ReleaseJob(const FChordJobRef& Job)
 {
-	Async(EAsyncExecution::ThreadPool, MoveTemp(InTask));
+	if (FChordJobScheduler::Get().Release(Job))
+	{
+		return;
+	}
+
+	// Still running for another requester; this tab just stops waiting for it.
+	ActiveJobs.Remove(Job);
+	PBRJobTargets.Remove(Job->GetId());
 }
 
+FString SChordPBRTab::FormatJobStatus(const FChordJob& Job) const
+{
+	const FString Status = Job.GetStatus();
+	return ActiveJobs.Num() > 1 ? FString::Printf(TEXT("%s (%d jobs running)"), *Status, ActiveJobs.Num()) : Status;
+}
 
-void SChordPBRTab::StartGenerateImagesAsync()
+void SChordPBRTab::HandleJobChanged(const FChordJobRef& Job)
 {
-	if (bIsRunning || !Session.IsValid())
+	if (Job->IsFinished())
 	{
-		return;
+		StartDeferredPreUploads();
 	}
 
-	UChordPBRSettings* Settings = GetMutableDefault<UChordPBRSettings>();
-	const FString Prompt = PromptTextBox.IsValid() ? PromptTextBox->GetText().ToString() : FString();
-	const FString BaseLabel = MakeTimestampLabelBase();
-	const int32 RequestId = RequestCounter.Increment();
-	TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
-
-	// Use Gemini API if enabled
-	if (Settings->Txt2ImgBackend == ETxt2ImgBackend::GeminiAPI)
+	// Speculative jobs run silently; only their result is applied.
+	if (const FGuid* SpeculativeImageId = SpeculativeJobs.FindKey(Job))
 	{
-		if (Settings->GeminiApiKey.IsEmpty())
+		if (Job->IsFinished())
 		{
-			HandleError(TEXT("Gemini API key is not configured. Please set it in Project Settings > Plugins > ChordPBRGenerator."));
-			return;
+			const FGuid ImageId = *SpeculativeImageId;
+			SpeculativeJobs.Remove(ImageId);
+			if (Job->GetState() == EChordJobState::Succeeded)
+			{
+				ApplySpeculativeOutputs(*Job, ImageId);
+			}
 		}
+		return;
+	}
 
-		SetStatusAsync(TEXT("Generating image with Gemini API..."), true);
-
-		GeminiClient = MakeShared<FGeminiApiClient>();
-		TSharedPtr<FGeminiApiClient> Client = GeminiClient;
-		const FString ApiEndpoint = Settings->GeminiApiEndpoint;
-		const FString ApiKey = Settings->GeminiApiKey;
-		const FString Model = Settings->GeminiModel;
+	const int32 JobIndex = ActiveJobs.IndexOfByKey(Job);
+	if (JobIndex == INDEX_NONE)
+	{
+		return;
+	}
 
-		Client->GenerateImageAsync(ApiEndpoint, ApiKey, Model, Prompt,
-			FOnGeminiImageGenerated::CreateLambda([WidgetWeak, RequestId, BaseLabel](UTexture2D* GeneratedTexture, const FString& Error)
-			{
-				AsyncTask(ENamedThreads::GameThread, [WidgetWeak, RequestId, BaseLabel, GeneratedTexture, Error]()
-				{
-					if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-					{
-						if (Pinned->RequestCounter.GetValue() != RequestId)
-						{
-							return;
-						}
+	if (!Job->IsFinished())
+	{
+		StatusMessage = FormatJobStatus(*Job);
+		return;
+	}
 
-						if (!Error.IsEmpty() || !GeneratedTexture)
-						{
-							Pinned->HandleError(Error.IsEmpty() ? TEXT("Failed to generate image.") : Error);
-							return;
-						}
+	ActiveJobs.RemoveAt(JobIndex);
+	if (LivePreviewJobId == Job->GetId())
+	{
+		ClearLivePreview();
+	}
 
-						if (Pinned->Session.IsValid())
-						{
-							const FName UniqueName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *BaseLabel);
-							GeneratedTexture->Rename(*UniqueName.ToString());
-							Pinned->Session->AddGeneratedImage(GeneratedTexture, BaseLabel);
-							Pinned->CurrentLayer = EChordGalleryLayer::Root;
-							Pinned->CurrentImageIndex = FMath::Max(0, Pinned->Session->GetGeneratedImages().Num() - 1);
-							Pinned->StatusMessage = TEXT("Image generated with Gemini API.");
-							Pinned->OnRootImageSelectionChanged();
-						}
+	switch (Job->GetState())
+	{
+	case EChordJobState::Succeeded:
+		ApplyJobOutputs(*Job);
+		break;
+	case EChordJobState::Failed:
+		HandleError(Job->GetError());
+		break;
+	default:
+		StatusMessage = TEXT("Cancelled.");
+		break;
+	}
+	PBRJobTargets.Remove(Job->GetId());
+	DraftFinalJobs.Remove(Job->GetId());
+	StreamedJobImages.Remove(Job->GetId());
 
-						Pinned->bIsRunning = false;
-						Pinned->RebuildThumbnails();
-					}
-				});
-			}));
+	if (MatrixJobIds.Remove(Job->GetId()) > 0)
+	{
+		++MatrixCellsFinished;
+		MatrixCellsFailed += Job->GetState() == EChordJobState::Failed ? 1 : 0;
+		PumpPromptMatrix();
+	}
+}
 
+void SChordPBRTab::ApplyJobOutputs(const FChordJob& Job)
+{
+	if (!Session.IsValid())
+	{
 		return;
 	}
 
-	// Use local ComfyUI workflow
-	ComfyClient = MakeShared<FComfyUIClient>(*Settings);
-	static uint32 SeedCounter = 0;
-	const int32 Seed = static_cast<int32>((FPlatformTime::Cycles64() + SeedCounter++) & static_cast<uint64>(INT32_MAX));
-
-	SetStatusAsync(FString::Printf(TEXT("Submitting image prompt (seed %d)..."), Seed), true);
-
-	TSharedPtr<FComfyUIClient> Client = ComfyClient;
-
-	TSharedPtr<FJsonObject> PromptJson;
-	FString Error;
-	if (!FComfyWorkflowUtils::PatchTxt2ImgPrompt(*Settings, Prompt, Seed, BaseLabel, PromptJson, Error))
+	if (Job.GetType() == EChordJobType::TextToImage && ApplyDraftFinalOutputs(Job))
 	{
-		HandleError(Error);
 		return;
 	}
 
-	EnqueueTask([WidgetWeak, Client, PromptJson, Settings, RequestId, BaseLabel]()
+	if (Job.GetType() == EChordJobType::TextToImage)
 	{
-		FString ErrorLocal;
-		auto IsStale = [&WidgetWeak, RequestId]() -> bool
+		// Images streamed in while the job downloaded them are already in the gallery.
+		TArray<FGuid> ImageIds;
+		StreamedJobImages.RemoveAndCopyValue(Job.GetId(), ImageIds);
+		const bool bStreamed = ImageIds.Num() > 0;
+		const bool bFused = IsFusedImageJob(Job);
+		for (int32 OutputIdx = ImageIds.Num(); OutputIdx < Job.OutputImages.Num(); ++OutputIdx)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			const int32 ImageIndex = AddJobImage(Job, OutputIdx);
+			ImageIds.Add(Session->GetGeneratedImages()[ImageIndex].Id);
+			if (!bFused || OutputIdx > 0)
 			{
-				return Pinned->RequestCounter.GetValue() != RequestId;
+				StartImageBackgroundWork(Session->GetGeneratedImages()[ImageIndex]);
 			}
-			return true;
-		};
+		}
 
-		FComfyPromptResponse Response;
-		if (!Client->QueuePrompt(PromptJson, Response, ErrorLocal))
+		// A fused prompt also returns the maps of the first image.
+		const bool bHasFusedMaps = Job.OutputPBRMaps.HasAnyMap();
+		const int32 FirstImageIndex = ImageIds.Num() > 0 ? Session->FindImageIndexById(ImageIds[0]) : INDEX_NONE;
+		if (bFused && FirstImageIndex != INDEX_NONE)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			FChordPBRMapSet MapSet = Job.OutputPBRMaps;
+			if (bHasFusedMaps && Session->SetPBRMapsForImage(FirstImageIndex, MoveTemp(MapSet)))
 			{
-				Pinned->HandleComfyFailure(TEXT("Queue prompt failed"), ErrorLocal);
+				EnsurePreviewMIDForImage(*Session->GetMutableImageItem(FirstImageIndex));
 			}
-			return;
-		}
-
-		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-		{
-			if (Pinned->RequestCounter.GetValue() != RequestId)
+			else
 			{
-				return;
+				StartImageBackgroundWork(Session->GetGeneratedImages()[FirstImageIndex]);
 			}
-			Pinned->SetStatusAsync(FString::Printf(TEXT("Queued prompt %s. Waiting for output..."), *Response.PromptId), true);
 		}
 
-		TSharedPtr<FJsonObject> History;
-		auto ProgressCallback = [WidgetWeak, RequestId, PromptId = Response.PromptId](float Progress)
+		// Streaming already selected the first image; the artist may have moved on since. A matrix fills the strip
+		// without taking the selection away.
+		if (!bStreamed && !MatrixJobIds.Contains(Job.GetId()))
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				if (Pinned->RequestCounter.GetValue() == RequestId)
-				{
-					Pinned->SetStatusAsync(FString::Printf(TEXT("Generating images... %d%%"), FMath::RoundToInt(Progress * 100.0f)), true);
-				}
-			}
-		};
-
-		if (!Client->WaitForCompletion(Response.PromptId, Response.ClientId, History, ErrorLocal, ProgressCallback))
+			CurrentLayer = EChordGalleryLayer::Root;
+			CurrentImageIndex = FMath::Max(0, Session->GetGeneratedImages().Num() - 1);
+		}
+		const int32 NumRequested = FMath::Max(1, Job.GetSettings().Txt2ImgBatchSize);
+		if (Job.OutputImages.Num() > 0 && Job.OutputImages[0].bGemini && Job.OutputImages.Num() < NumRequested)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				Pinned->HandleComfyFailure(FString::Printf(TEXT("Wait for prompt %s"), *Response.PromptId), ErrorLocal);
-			}
-			return;
+			StatusMessage = FString::Printf(TEXT("Gemini generated only %d of %d images; see the Output Log."), Job.OutputImages.Num(), NumRequested);
 		}
-
-		if (IsStale())
+		else if (Job.OutputImages.Num() > 0 && Job.OutputImages[0].bGemini)
 		{
-			return;
+			StatusMessage = TEXT("Image generated with Gemini API.");
+		}
+		else if (Job.GetRequest().bDraft)
+		{
+			StatusMessage = TEXT("Draft ready. Keep it to render at full quality.");
+		}
+		else
+		{
+			StatusMessage = bHasFusedMaps ? TEXT("Images and PBR maps downloaded.") : TEXT("Images downloaded.");
 		}
+		OnRootImageSelectionChanged();
+		RebuildThumbnails();
+		return;
+	}
 
-		TArray<FComfyImageReference> Images;
-		if (!FComfyWorkflowUtils::ExtractImagesFromHistory(*Settings, History, Images, ErrorLocal))
+	if (Job.GetType() == EChordJobType::ImageToPBRBatch)
+	{
+		int32 NumApplied = 0;
+		for (const FChordJobBatchOutput& Output : Job.OutputPBRBatch)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			const int32 TargetImageIndex = Session->FindImageIndexById(Output.ImageId);
+			FChordGeneratedImageItem* MutableItem = Session->GetMutableImageItem(TargetImageIndex);
+			if (!MutableItem)
 			{
-				Pinned->HandleComfyFailure(TEXT("Parse outputs"), ErrorLocal);
+				continue;
 			}
-			return;
-		}
 
-		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-		{
-			if (Pinned->RequestCounter.GetValue() != RequestId)
+			FChordPBRMapSet MapSet = Output.Maps;
+			if (Session->SetPBRMapsForImage(TargetImageIndex, MoveTemp(MapSet)))
 			{
-				return;
+				EnsurePreviewMIDForImage(*MutableItem);
+				++NumApplied;
 			}
-			Pinned->SetStatusAsync(TEXT("Downloading images..."), true);
 		}
 
-		struct FDownloadedImage
-		{
-			FString Name;
-			TArray<uint8> Data;
-		};
+		const int32 NumMissing = Job.GetRequest().BatchImages.Num() - Job.OutputPBRBatch.Num();
+		StatusMessage = NumMissing > 0
+			? FString::Printf(TEXT("PBR maps downloaded for %d image(s); %d failed, see the log."), NumApplied, NumMissing)
+			: FString::Printf(TEXT("PBR maps downloaded for %d image(s)."), NumApplied);
+		RebuildThumbnails();
+		return;
+	}
+
+	// The gallery may have changed while the job ran; images are found by id, not by their old index.
+	TArray<FGuid> TargetImageIds;
+	PBRJobTargets.MultiFind(Job.GetId(), TargetImageIds);
+	if (TargetImageIds.Num() == 0)
+	{
+		TargetImageIds.Add(Job.GetRequest().SourceImageId);
+	}
 
-		TArray<FDownloadedImage> Downloaded;
-		for (int32 ImageIdx = 0; ImageIdx < Images.Num(); ++ImageIdx)
+	bool bFoundTarget = false;
+	int32 AppliedImageIndex = INDEX_NONE;
+	for (const FGuid& TargetImageId : TargetImageIds)
+	{
+		int32 TargetImageIndex = Session->FindImageIndexById(TargetImageId);
+		if (TargetImageIndex == INDEX_NONE && Job.GetRequest().Reattach.IsSet() && Job.OutputImages.Num() > 0)
 		{
-			const FComfyImageReference& Ref = Images[ImageIdx];
-			TArray<uint8> Data;
-			if (Client->DownloadImage(Ref, Data, ErrorLocal))
-			{
-				FDownloadedImage Item;
-				Item.Name = (Images.Num() > 1) ? FString::Printf(TEXT("%s_%02d"), *BaseLabel, ImageIdx + 1) : BaseLabel;
-				Item.Data = MoveTemp(Data);
-				Downloaded.Add(MoveTemp(Item));
-			}
+			// Resumed from the journal: the source image's gallery item died with the previous session.
+			Session->AddGeneratedImage(Job.OutputImages[0].Texture.Get(), Job.OutputImages[0].Label);
+			TargetImageIndex = Session->GetGeneratedImages().Num() - 1;
 		}
 
-		if (Downloaded.Num() == 0)
+		FChordGeneratedImageItem* MutableItem = Session->GetMutableImageItem(TargetImageIndex);
+		if (!MutableItem)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				const FString DownloadError = ErrorLocal.IsEmpty() ? TEXT("No images downloaded.") : ErrorLocal;
-				Pinned->HandleComfyFailure(TEXT("Download images"), DownloadError);
-			}
-			return;
+			continue;
 		}
+		bFoundTarget = true;
 
-		AsyncTask(ENamedThreads::GameThread, [WidgetWeak, Downloaded = MoveTemp(Downloaded), RequestId]() mutable
+		// A shared job was started from another item; each item keeps pointing at its own source texture.
+		FChordPBRMapSet MapSet = Job.OutputPBRMaps;
+		MapSet.SourceImage = MutableItem->Image.Get();
+		if (Session->SetPBRMapsForImage(TargetImageIndex, MoveTemp(MapSet)))
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				if (Pinned->RequestCounter.GetValue() != RequestId)
-				{
-					return;
-				}
+			EnsurePreviewMIDForImage(*MutableItem);
+			AppliedImageIndex = TargetImageIndex;
+		}
+	}
 
-				if (Pinned->Session.IsValid())
-				{
-					int32 AddedCount = 0;
-					for (FDownloadedImage& Item : Downloaded)
-					{
-						if (UTexture2D* Texture = FChordImageUtils::CreateTextureFromImage(Item.Data, Item.Name))
-						{
-							const FName UniqueName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *Item.Name);
-							Texture->Rename(*UniqueName.ToString());
-							Pinned->Session->AddGeneratedImage(Texture, Item.Name);
-							++AddedCount;
-						}
-					}
+	if (AppliedImageIndex != INDEX_NONE)
+	{
+		CurrentLayer = EChordGalleryLayer::Detail;
+		CurrentImageIndex = AppliedImageIndex;
+		CurrentPBRChannelIndex = 0;
+		StatusMessage = TEXT("PBR maps downloaded.");
+		ApplyPreviewForCurrentImage(false, true);
+	}
+	else
+	{
+		StatusMessage = bFoundTarget ? TEXT("Failed to cache PBR maps.") : TEXT("Source image was deleted; PBR maps discarded.");
+	}
+	RebuildThumbnails();
+}
 
-					if (AddedCount > 0)
-					{
-						Pinned->CurrentLayer = EChordGalleryLayer::Root;
-						Pinned->CurrentImageIndex = FMath::Max(0, Pinned->Session->GetGeneratedImages().Num() - 1);
-						Pinned->StatusMessage = TEXT("Images downloaded.");
-						Pinned->OnRootImageSelectionChanged();
-					}
-					else
-					{
-						Pinned->StatusMessage = TEXT("Failed to decode images.");
-					}
+bool SChordPBRTab::HasActiveJobForImage(const FGuid& ImageId) const
+{
+	for (const TPair<FGuid, FGuid>& Target : PBRJobTargets)
+	{
+		if (Target.Value == ImageId)
+		{
+			return true;
+		}
+	}
+	return false;
+}
 
-					Pinned->bIsRunning = false;
-					Pinned->RebuildThumbnails();
-				}
-			}
-		});
-	});
+bool SChordPBRTab::IsFusedImageJob(const FChordJob& Job)
+{
+	// Routing may have sent the job to a template without the fused graph, whatever the settings say.
+	return Job.OutputImages.Num() > 0 && Job.OutputImages[0].bFusedMaps;
 }
 
-void SChordPBRTab::StartGeneratePBRAsync()
+int32 SChordPBRTab::AddJobImage(const FChordJob& Job, int32 OutputIndex)
+{
+	const FChordJobImageOutput& Output = Job.OutputImages[OutputIndex];
+	Session->AddGeneratedImage(Output.Texture.Get(), Output.Label);
+	const int32 ImageIndex = Session->GetGeneratedImages().Num() - 1;
+	if (Job.GetRequest().bDraft)
+	{
+		FChordGeneratedImageItem& DraftItem = *Session->GetMutableImageItem(ImageIndex);
+		DraftItem.bDraft = true;
+		DraftItem.DraftPrompt = Job.GetRequest().Prompt;
+		DraftItem.DraftSeed = Output.Seed;
+		DraftItem.DraftBatchIndex = OutputIndex;
+		DraftItem.DraftBatchSize = Job.GetSettings().Txt2ImgBatchSize;
+	}
+	return ImageIndex;
+}
+
+void SChordPBRTab::StartImageBackgroundWork(const FChordGeneratedImageItem& Item)
 {
-	if (bIsRunning || !Session.IsValid())
+	// Drafts get neither maps nor uploads until somebody keeps them.
+	if (Item.bDraft || Item.bHasPBR)
 	{
-		HandleError(TEXT("No session or operation already running."));
 		return;
 	}
 
-	const FChordGeneratedImageItem* CurrentItem = GetCurrentImageItem();
-	if (!CurrentItem || !CurrentItem->Image.IsValid())
+	// A speculative job uploads the image itself.
+	const UChordPBRSettings* Settings = GetDefault<UChordPBRSettings>();
+	if (Settings->bSpeculativePBRForNewImages)
+	{
+		StartSpeculativePBR(Item);
+	}
+	else if (Settings->bPreUploadSourceImages)
+	{
+		StartPreUpload(Item);
+	}
+}
+
+void SChordPBRTab::HandleJobImageReady(const FChordJobRef& Job, int32 OutputIndex)
+{
+	// A kept draft's final render replaces the draft in one go once it finishes.
+	if (!Session.IsValid() || Job->GetType() != EChordJobType::TextToImage || !ActiveJobs.Contains(Job) || DraftFinalJobs.Contains(Job->GetId()))
 	{
-		HandleError(TEXT("Select a generated image first."));
 		return;
 	}
 
-	UTexture2D* SourceTexture = CurrentItem->Image.Get();
-	if (!SourceTexture)
+	TArray<FGuid>& Streamed = StreamedJobImages.FindOrAdd(Job->GetId());
+	if (OutputIndex != Streamed.Num())
 	{
-		HandleError(TEXT("Invalid source texture."));
 		return;
 	}
 
-	UChordPBRSettings* Settings = GetMutableDefault<UChordPBRSettings>();
-	ComfyClient = MakeShared<FComfyUIClient>(*Settings);
+	const int32 ImageIndex = AddJobImage(*Job, OutputIndex);
+	Streamed.Add(Session->GetGeneratedImages()[ImageIndex].Id);
+	// The first image of a fused prompt waits for its maps, which come with the finished job.
+	if (!IsFusedImageJob(*Job) || OutputIndex > 0)
+	{
+		StartImageBackgroundWork(Session->GetGeneratedImages()[ImageIndex]);
+	}
+
+	// The first image of a batch is shown right away; the rest, and matrix cells, only join the strip.
+	if (OutputIndex == 0 && !MatrixJobIds.Contains(Job->GetId()))
+	{
+		if (LivePreviewJobId == Job->GetId())
+		{
+			ClearLivePreview();
+		}
+		CurrentLayer = EChordGalleryLayer::Root;
+		CurrentImageIndex = ImageIndex;
+		OnRootImageSelectionChanged();
+	}
+	RebuildThumbnails();
+}
+
+bool SChordPBRTab::CanKeepCurrentDraft() const
+{
+	const FChordGeneratedImageItem* Item = CurrentLayer == EChordGalleryLayer::Root ? GetCurrentImageItem() : nullptr;
+	return Item && Item->bDraft && !DraftFinalJobs.FindKey(Item->Id);
+}
+
+FReply SChordPBRTab::OnKeepDraft()
+{
+	if (!CanKeepCurrentDraft())
+	{
+		return FReply::Handled();
+	}
+
+	const FChordGeneratedImageItem* Item = GetCurrentImageItem();
+	FChordJobRequest Request;
+	Request.Type = EChordJobType::TextToImage;
+	Request.Prompt = Item->DraftPrompt;
+	Request.Seed = Item->DraftSeed;
+	Request.bKeptDraft = true;
+	Request.DraftBatchSize = Item->DraftBatchSize;
+	Request.DraftBatchIndex = Item->DraftBatchIndex;
+	Request.Label = Item->Label;
+	const FChordJobRef Job = FChordJobScheduler::Get().Submit(MoveTemp(Request));
+	DraftFinalJobs.Add(Job->GetId(), Item->Id);
+	TrackJob(Job);
+	return FReply::Handled();
+}
+
+bool SChordPBRTab::ApplyDraftFinalOutputs(const FChordJob& Job)
+{
+	const FGuid* DraftId = DraftFinalJobs.Find(Job.GetId());
+	if (!DraftId || Job.OutputImages.Num() == 0)
+	{
+		return false;
+	}
+
+	const int32 ImageIndex = Session->FindImageIndexById(*DraftId);
+	FChordGeneratedImageItem* Item = Session->GetMutableImageItem(ImageIndex);
+	if (!Item)
+	{
+		// The draft went away meanwhile; the final render is added as a new image instead.
+		return false;
+	}
+
+	// The final render holds just the draft's image, or the whole batch if the template could not pick one out;
+	// then the draft's slot picks its counterpart.
+	const int32 OutputIdx = Job.OutputImages.Num() == 1 ? 0 : FMath::Clamp(Item->DraftBatchIndex, 0, Job.OutputImages.Num() - 1);
+	Item->Image = Job.OutputImages[OutputIdx].Texture;
+	Item->bDraft = false;
+	Item->UploadedSources.Reset();
+
+	const UChordPBRSettings* Settings = GetDefault<UChordPBRSettings>();
+	if (Job.OutputPBRMaps.HasAnyMap() && OutputIdx == 0)
+	{
+		FChordPBRMapSet MapSet = Job.OutputPBRMaps;
+		if (Session->SetPBRMapsForImage(ImageIndex, MoveTemp(MapSet)))
+		{
+			EnsurePreviewMIDForImage(*Item);
+		}
+	}
+	else if (Settings->bSpeculativePBRForNewImages)
+	{
+		StartSpeculativePBR(*Item);
+	}
+	else if (Settings->bPreUploadSourceImages)
+	{
+		StartPreUpload(*Item);
+	}
+
+	StatusMessage = TEXT("Full-quality image ready.");
+	if (CurrentLayer == EChordGalleryLayer::Root && CurrentImageIndex == ImageIndex)
+	{
+		OnRootImageSelectionChanged();
+	}
+	RebuildThumbnails();
+	return true;
+}
+
+void SChordPBRTab::StartSpeculativePBR(const FChordGeneratedImageItem& Item)
+{
+	if (!Item.Image.IsValid() || Item.bHasPBR || SpeculativeJobs.Contains(Item.Id))
+	{
+		return;
+	}
 
-	TArray<uint8> PngData;
+	FChordJobRequest Request;
 	FString EncodeError;
-	if (!FChordImageUtils::EncodeTextureToPng(SourceTexture, PngData, EncodeError))
+	if (!FChordImageUtils::EncodeTextureToPng(Item.Image.Get(), Request.SourcePng, EncodeError))
 	{
-		HandleError(EncodeError);
+		UE_LOG(LogChordPBRGenerator, Verbose, TEXT("Skipping speculative PBR for %s: %s"), *Item.Label, *EncodeError);
+		return;
+	}
+
+	Request.Type = EChordJobType::ImageToPBR;
+	Request.Priority = EComfyJobPriority::Background;
+	Request.Label = Item.Label;
+	Request.SourceImageId = Item.Id;
+	Request.SourceTexture = Item.Image.Get();
+	Request.PreUploadedSources = Item.UploadedSources;
+
+	const FChordJobRef Job = FChordJobScheduler::Get().Submit(MoveTemp(Request));
+	if (ActiveJobs.Contains(Job))
+	{
+		// Joined a job this tab is already waiting on; its result reaches the item that way.
+		FChordJobScheduler::Get().Release(Job);
+		PBRJobTargets.AddUnique(Job->GetId(), Item.Id);
+		return;
+	}
+	SpeculativeJobs.Add(Item.Id, Job);
+}
+
+void SChordPBRTab::StartPreUpload(const FChordGeneratedImageItem& Item)
+{
+	// Only while idle: the upload would otherwise compete with a running job's own transfers.
+	if (FChordJobScheduler::Get().HasRunningInteractiveJobs())
+	{
+		DeferredPreUploads.AddUnique(Item.Id);
 		return;
 	}
 
-	const FString SourceLabel = GetCurrentImageLabel();
-	const int32 RequestId = RequestCounter.Increment();
-	const int32 TargetImageIndex = CurrentImageIndex;
-	SetStatusAsync(TEXT("Uploading source image..."), true);
+	TArray<uint8> SourcePng;
+	FString EncodeError;
+	if (!Item.Image.IsValid() || !FChordImageUtils::EncodeTextureToPng(Item.Image.Get(), SourcePng, EncodeError))
+	{
+		return;
+	}
 
+	UChordPBRSettings* Settings = GetMutableDefault<UChordPBRSettings>();
+	const TSharedRef<FComfyUIClient> DefaultClient = MakeShared<FComfyUIClient>(*Settings);
+	DefaultClient->SetJobPriority(EComfyJobPriority::Background);
 	TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
-	TSharedPtr<FComfyUIClient> Client = ComfyClient;
-	const TWeakObjectPtr<UTexture2D> SourceTextureWeak = SourceTexture;
+	const FGuid ImageId = Item.Id;
+	const FString Label = Item.Label;
 
-	EnqueueTask([WidgetWeak, Client, Settings, SourceLabel, PngData = MoveTemp(PngData), SourceTextureWeak, RequestId, TargetImageIndex]() mutable
+	EnqueueTask([WidgetWeak, DefaultClient, Settings, SourcePng = MoveTemp(SourcePng), ImageId, Label]()
 	{
-		FString ErrorLocal;
-		auto IsStale = [&WidgetWeak, RequestId]() -> bool
+		// Scaled down the same way a CHORD job would, so the job can use this copy as is.
+		TArray<uint8> ResizedPng;
+		FString ResizeError;
+		if (!FChordImageUtils::DownscaleImageToFit(SourcePng, Settings->ChordInputResolution, ResizedPng, ResizeError))
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				return Pinned->RequestCounter.GetValue() != RequestId;
-			}
-			return true;
-		};
+			UE_LOG(LogChordPBRGenerator, Verbose, TEXT("Pre-uploading %s at full size: %s"), *Label, *ResizeError);
+		}
 
+		// Aimed at the server the next CHORD job would land on; a job sent elsewhere still uploads for itself.
+		FString Error;
+		const TSharedPtr<FComfyUIClient> Client = FComfyServerPool::Get().AcquireClient(DefaultClient, *Settings, Settings->ChordImg2PbrApiPromptPath, Error);
 		FComfyImageReference Uploaded;
-		const FString UploadName = FString::Printf(TEXT("%s.png"), *SourceLabel);
-		if (!Client->UploadImage(PngData, UploadName, Uploaded, ErrorLocal))
+		if (!Client.IsValid() || !Client->UploadImage(ResizedPng.Num() > 0 ? ResizedPng : SourcePng, Uploaded, Error))
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				Pinned->HandleComfyFailure(TEXT("Upload failed"), ErrorLocal);
-			}
+			UE_LOG(LogChordPBRGenerator, Verbose, TEXT("Pre-upload of %s skipped: %s"), *Label, *Error);
 			return;
 		}
 
-		if (IsStale())
+		AsyncTask(ENamedThreads::GameThread, [WidgetWeak, ImageId, ServerUrl = Client->GetBaseUrl(), Uploaded]()
 		{
-			return;
+			TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin();
+			const int32 ImageIndex = Pinned.IsValid() && Pinned->Session.IsValid() ? Pinned->Session->FindImageIndexById(ImageId) : INDEX_NONE;
+			if (FChordGeneratedImageItem* Item = ImageIndex != INDEX_NONE ? Pinned->Session->GetMutableImageItem(ImageIndex) : nullptr)
+			{
+				Item->UploadedSources.Add(ServerUrl, Uploaded);
+			}
+		});
+	});
+}
+
+void SChordPBRTab::StartDeferredPreUploads()
+{
+	if (DeferredPreUploads.Num() == 0 || !Session.IsValid() || FChordJobScheduler::Get().HasRunningInteractiveJobs())
+	{
+		return;
+	}
+
+	const TArray<FGuid> ImageIds = MoveTemp(DeferredPreUploads);
+	DeferredPreUploads.Reset();
+	for (const FGuid& ImageId : ImageIds)
+	{
+		const int32 ImageIndex = Session->FindImageIndexById(ImageId);
+		const FChordGeneratedImageItem* Item = ImageIndex != INDEX_NONE ? &Session->GetGeneratedImages()[ImageIndex] : nullptr;
+		if (Item && !Item->bHasPBR && !HasActiveJobForImage(ImageId))
+		{
+			StartPreUpload(*Item);
 		}
+	}
+}
+
+bool SChordPBRTab::TryUseSpeculativePBR(const FChordGeneratedImageItem& Item)
+{
+	if (SpeculatedImageIds.Remove(Item.Id) > 0 && Item.bHasPBR)
+	{
+		CurrentLayer = EChordGalleryLayer::Detail;
+		CurrentPBRChannelIndex = 0;
+		StatusMessage = TEXT("PBR maps ready.");
+		ApplyPreviewForCurrentImage(false, true);
+		RebuildThumbnails();
+		return true;
+	}
+
+	FChordJobRef* Speculative = SpeculativeJobs.Find(Item.Id);
+	if (!Speculative)
+	{
+		return false;
+	}
+
+	// Someone is waiting now: the job becomes an ordinary interactive one owned by this tab.
+	const FChordJobRef Job = *Speculative;
+	SpeculativeJobs.Remove(Item.Id);
+	FChordJobScheduler::Get().Promote(Job);
+	PBRJobTargets.AddUnique(Job->GetId(), Item.Id);
+	TrackJob(Job);
+	return true;
+}
+
+void SChordPBRTab::ApplySpeculativeOutputs(const FChordJob& Job, const FGuid& ImageId)
+{
+	const int32 ImageIndex = Session.IsValid() ? Session->FindImageIndexById(ImageId) : INDEX_NONE;
+	FChordGeneratedImageItem* Item = ImageIndex != INDEX_NONE ? Session->GetMutableImageItem(ImageIndex) : nullptr;
+	if (!Item || Item->bHasPBR)
+	{
+		return;
+	}
+
+	FChordPBRMapSet MapSet = Job.OutputPBRMaps;
+	MapSet.SourceImage = Item->Image.Get();
+	if (Session->SetPBRMapsForImage(ImageIndex, MoveTemp(MapSet)))
+	{
+		EnsurePreviewMIDForImage(*Item);
+		SpeculatedImageIds.Add(ImageId);
+		RebuildThumbnails();
+	}
+}
+
+void SChordPBRTab::CancelSpeculativePBR(const FGuid& ImageId)
+{
+	SpeculatedImageIds.Remove(ImageId);
+
+	if (const FChordJobRef* Job = SpeculativeJobs.Find(ImageId))
+	{
+		const FChordJobRef JobToRelease = *Job;
+		SpeculativeJobs.Remove(ImageId);
+		FChordJobScheduler::Get().Release(JobToRelease);
+	}
+}
+
+bool SChordPBRTab::HandleWarmUpTick(float DeltaTime)
+{
+	// A real job already keeps its models resident.
+	if (FChordJobScheduler::Get().GetNumActiveJobs() == 0)
+	{
+		StartServerWarmUp(GetDefault<UChordPBRSettings>()->bWarmUpModelsOnTabOpen);
+	}
+	return true;
+}
+
+void SChordPBRTab::ReportWarmUpStatus(const FString& Message, bool bFinished)
+{
+	UE_LOG(LogChordPBRGenerator, Log, TEXT("%s"), *Message);
 
-		TSharedPtr<FJsonObject> PromptJson;
-		if (!FComfyWorkflowUtils::PatchChordPrompt(*Settings, Uploaded, PromptJson, ErrorLocal))
+	TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
+	AsyncTask(ENamedThreads::GameThread, [WidgetWeak, Message, bFinished]()
+	{
+		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			if (Pinned->ActiveJobs.Num() == 0)
 			{
-				Pinned->HandleComfyFailure(TEXT("Template error"), ErrorLocal);
+				Pinned->StatusMessage = Message;
+			}
+			if (bFinished)
+			{
+				Pinned->bWarmUpInFlight = false;
 			}
-			return;
 		}
+	});
+}
+
+void SChordPBRTab::StartServerWarmUp(bool bRunWarmUpPrompts)
+{
+	if (bWarmUpInFlight)
+	{
+		return;
+	}
 
-		FComfyPromptResponse Response;
-		if (!Client->QueuePrompt(PromptJson, Response, ErrorLocal))
+	bWarmUpInFlight = true;
+	WarmUpToken = MakeShared<FChordCancellationToken, ESPMode::ThreadSafe>();
+	UChordPBRSettings* Settings = GetMutableDefault<UChordPBRSettings>();
+	TSharedPtr<FComfyUIClient> Client = MakeShared<FComfyUIClient>(*Settings, WarmUpToken);
+	TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
+
+	// A new seed and input shade every run, or ComfyUI would answer from its node cache without touching the models.
+	const int32 WarmUpIndex = ++WarmUpCount;
+
+	EnqueueTask([WidgetWeak, PrimaryClient = Client, Settings, bRunWarmUpPrompts, WarmUpIndex]()
+	{
+		auto Report = [&WidgetWeak](const FString& Message, bool bFinished)
 		{
 			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
 			{
-				Pinned->HandleComfyFailure(TEXT("Queue prompt failed"), ErrorLocal);
+				Pinned->ReportWarmUpStatus(Message, bFinished);
 			}
-			return;
-		}
+		};
 
-		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+		// Every pooled server can receive the next job, so each one is probed and warmed.
+		const TArray<FString> ServerUrls = FComfyServerPool::GetServerUrls(*Settings);
+		TArray<FString> Problems;
+		int32 ReadyCount = 0;
+		for (const FString& ServerUrl : ServerUrls)
 		{
-			if (Pinned->RequestCounter.GetValue() != RequestId)
+			const TSharedRef<FComfyUIClient> Client = PrimaryClient->WithBaseUrl(ServerUrl);
+			// Warm-up must never delay a user's generation on a busy server.
+			Client->SetJobPriority(EComfyJobPriority::Background);
+			const FString ServerLabel = ServerUrls.Num() > 1 ? ServerUrl + TEXT(" ") : FString();
+
+			FString Error;
+			if (!Client->HealthCheck(Error))
 			{
-				return;
+				Problems.Add(FString::Printf(TEXT("%snot reachable: %s"), *ServerLabel, *Error));
+				continue;
 			}
-			Pinned->SetStatusAsync(FString::Printf(TEXT("Queued PBR prompt %s. Waiting for outputs..."), *Response.PromptId), true);
-		}
 
-		TSharedPtr<FJsonObject> History;
-		auto ProgressCallback = [WidgetWeak, RequestId, PromptId = Response.PromptId](float Progress)
-		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			++ReadyCount;
+			if (!bRunWarmUpPrompts)
+			{
+				continue;
+			}
+
+			Report(FString::Printf(TEXT("ComfyUI server %sready. Warming up models..."), *ServerLabel), false);
+
+			auto RunWarmUp = [&Client](const TSharedPtr<FJsonObject>& Prompt, const FString& TemplateKey, FString& OutError)
+			{
+				FComfyWorkflowUtils::ConvertToWarmUpPrompt(Prompt);
+				FComfyPromptResponse Response;
+				TSharedPtr<FJsonObject> History;
+				if (!Client->QueuePromptAndWait(Prompt, Response, History, OutError))
+				{
+					return false;
+				}
+				FComfyServerPool::Get().NoteTemplateQueued(Client->GetBaseUrl(), TemplateKey);
+				return true;
+			};
+
+			if (Settings->Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI)
 			{
-				if (Pinned->RequestCounter.GetValue() == RequestId)
+				TSharedPtr<FJsonObject> Prompt;
+				if (!FComfyWorkflowUtils::PatchTxt2ImgPrompt(*Settings, TEXT("warm-up"), WarmUpIndex, TEXT("ChordWarmUp"), Prompt, Error)
+					|| !RunWarmUp(Prompt, Settings->Txt2ImgApiPromptPath, Error))
 				{
-					Pinned->SetStatusAsync(FString::Printf(TEXT("Generating PBR maps... %d%%"), FMath::RoundToInt(Progress * 100.0f)), true);
+					Problems.Add(FString::Printf(TEXT("%stxt2img: %s"), *ServerLabel, *Error));
 				}
 			}
-		};
 
-		if (!Client->WaitForCompletion(Response.PromptId, Response.ClientId, History, ErrorLocal, ProgressCallback))
-		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+			constexpr int32 WarmUpImageSize = 64;
+			TArray<FColor> Pixels;
+			Pixels.Init(FColor(static_cast<uint8>(96 + WarmUpIndex % 64), 128, 128, 255), WarmUpImageSize * WarmUpImageSize);
+			TArray<uint8> PngData;
+			FComfyImageReference Uploaded;
+			TSharedPtr<FJsonObject> ChordPrompt;
+			if (!FChordImageUtils::EncodePixelsToPng(Pixels, WarmUpImageSize, WarmUpImageSize, PngData, Error)
+				|| !Client->UploadImage(PngData, Uploaded, Error)
+				|| !FComfyWorkflowUtils::PatchChordPrompt(*Settings, Uploaded, ChordPrompt, Error)
+				|| !RunWarmUp(ChordPrompt, Settings->ChordImg2PbrApiPromptPath, Error))
 			{
-				Pinned->HandleComfyFailure(FString::Printf(TEXT("Wait for PBR outputs %s"), *Response.PromptId), ErrorLocal);
+				Problems.Add(FString::Printf(TEXT("%sCHORD: %s"), *ServerLabel, *Error));
 			}
-			return;
 		}
 
-		if (IsStale())
+		if (ReadyCount == 0)
 		{
-			return;
+			Report(FString::Printf(TEXT("ComfyUI server not reachable (%s)"), *FString::Join(Problems, TEXT("; "))), true);
 		}
-
-		TMap<FString, FComfyImageReference> Channels;
-		if (!FComfyWorkflowUtils::ExtractPBRFromHistory(*Settings, History, Channels, ErrorLocal))
+		else if (Problems.Num() > 0)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				Pinned->HandleComfyFailure(TEXT("Parse PBR outputs"), ErrorLocal);
-			}
-			return;
+			Report(FString::Printf(TEXT("ComfyUI ready with problems (%s)"), *FString::Join(Problems, TEXT("; "))), true);
 		}
-
-		if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
+		else
 		{
-			if (Pinned->RequestCounter.GetValue() != RequestId)
-			{
-				return;
-			}
-			Pinned->SetStatusAsync(TEXT("Downloading PBR maps..."), true);
+			Report(bRunWarmUpPrompts ? TEXT("ComfyUI server ready. Models warmed up.") : TEXT("ComfyUI server ready."), true);
 		}
+	});
+}
 
-		struct FDownloadedChannel
-		{
-			FString ChannelName;
-			FString FileName;
-			TArray<uint8> Data;
-			FString FilePath;
-		};
+void SChordPBRTab::EnqueueTask(TFunction<void()> InTask)
+{
+	Async(EAsyncExecution::ThreadPool, MoveTemp(InTask));
+}
 
-		TArray<FDownloadedChannel> DownloadedChannels;
-		const FString CacheRoot = Settings->SavedCacheRoot;
-		const FString SafeLabel = FPaths::MakeValidFileName(SourceLabel.IsEmpty() ? Response.PromptId : SourceLabel);
-		auto DownloadChannel = [&](const FString& ChannelName) -> bool
-		{
-			const FComfyImageReference* Ref = Channels.Find(ChannelName);
-			if (!Ref)
-			{
-				ErrorLocal = FString::Printf(TEXT("Missing channel %s."), *ChannelName);
-				return false;
-			}
 
-			TArray<uint8> Data;
-			if (!Client->DownloadImage(*Ref, Data, ErrorLocal))
-			{
-				return false;
-			}
+void SChordPBRTab::StartGenerateImagesAsync()
+{
+	if (!Session.IsValid())
+	{
+		return;
+	}
 
-			const FString BaseName = !SourceLabel.IsEmpty() ? SourceLabel : FPaths::GetBaseFilename(Ref->Filename);
-			const FString SafeBaseName = FPaths::MakeValidFileName(BaseName);
-			FDownloadedChannel Item;
-			Item.ChannelName = ChannelName;
-			Item.FileName = FString::Printf(TEXT("%s_%s"), *SafeBaseName, *ChannelName);
-			Item.Data = MoveTemp(Data);
-
-			const FString CacheDir = FPaths::Combine(CacheRoot, TEXT("PBR"), SafeLabel);
-			IFileManager::Get().MakeDirectory(*CacheDir, true);
-			const FString TargetName = FString::Printf(TEXT("PBR_%s_%s.png"), *SafeBaseName, *ChannelName);
-			const FString TargetPath = FPaths::Combine(CacheDir, TargetName);
-			if (FFileHelper::SaveArrayToFile(Item.Data, *TargetPath))
-			{
-				Item.FilePath = TargetPath;
-			}
+	const UChordPBRSettings* Settings = GetDefault<UChordPBRSettings>();
+	if (Settings->Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI || Settings->bFailoverGeminiToComfyUI)
+	{
+		// Preview frames and downloaded images are decoded on the thread pool, which can only look the module up.
+		FModuleManager::Get().LoadModule(TEXT("ImageWrapper"));
+	}
 
-			DownloadedChannels.Add(MoveTemp(Item));
-			return true;
-		};
+	FChordJobRequest Request;
+	Request.Type = EChordJobType::TextToImage;
+	Request.Prompt = PromptTextBox.IsValid() ? PromptTextBox->GetText().ToString() : FString();
+	Request.Label = MakeTimestampLabelBase();
+	// Gemini has no step count or latent size to cut, so drafts always render on ComfyUI.
+	Request.bDraft = Settings->bDraftFirst && Settings->Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI;
+	TrackJob(FChordJobScheduler::Get().Submit(MoveTemp(Request)));
+}
+
+void SChordPBRTab::StartPromptMatrix()
+{
+	// Beyond this the grid is more likely a mistake than a lookdev session.
+	constexpr int32 MaxPromptMatrixCells = 256;
+
+	if (!Session.IsValid() || PendingMatrixCells.Num() > 0 || MatrixJobIds.Num() > 0)
+	{
+		return;
+	}
+
+	const FString Template = PromptTextBox.IsValid() ? PromptTextBox->GetText().ToString() : FString();
+	TArray<FChordPromptMatrixCell> Cells;
+	FString Error;
+	if (!FChordPromptMatrix::Expand(Template, MaxPromptMatrixCells, Cells, Error))
+	{
+		HandleError(FString::Printf(TEXT("Prompt matrix: %s"), *Error));
+		return;
+	}
+
+	const UChordPBRSettings* Settings = GetDefault<UChordPBRSettings>();
+	if (Settings->Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI || Settings->bFailoverGeminiToComfyUI)
+	{
+		FModuleManager::Get().LoadModule(TEXT("ImageWrapper"));
+	}
+
+	// Popped from the back, so reversed to run in grid order.
+	Algo::Reverse(Cells);
+	PendingMatrixCells = MoveTemp(Cells);
+	MatrixBaseLabel = MakeTimestampLabelBase();
+	MatrixCellsTotal = PendingMatrixCells.Num();
+	MatrixCellsFinished = 0;
+	MatrixCellsFailed = 0;
+	PumpPromptMatrix();
+}
+
+void SChordPBRTab::PumpPromptMatrix()
+{
+	// A grid is background work: it queues behind the artist's own requests on the server and leaves them the
+	// scheduler's reserved slot. One cell per background slot keeps the queue to one grid's worth.
+	const int32 MaxInFlight = FMath::Max(1, GetDefault<UChordPBRSettings>()->MaxConcurrentJobs - 1);
+	while (PendingMatrixCells.Num() > 0 && MatrixJobIds.Num() < MaxInFlight)
+	{
+		const FChordPromptMatrixCell Cell = PendingMatrixCells.Pop();
+		FChordJobRequest Request;
+		Request.Type = EChordJobType::TextToImage;
+		Request.Priority = EComfyJobPriority::Background;
+		Request.Prompt = Cell.Prompt;
+		Request.Seed = Cell.Seed;
+		Request.Label = FChordPromptMatrix::MakeLabel(MatrixBaseLabel, Cell);
+		const FChordJobRef Job = FChordJobScheduler::Get().Submit(MoveTemp(Request));
+		MatrixJobIds.Add(Job->GetId());
+		TrackJob(Job);
+	}
+
+	if (MatrixCellsTotal == 0)
+	{
+		return;
+	}
+	if (MatrixJobIds.Num() > 0)
+	{
+		StatusMessage = FString::Printf(TEXT("Prompt matrix: %d of %d done."), MatrixCellsFinished, MatrixCellsTotal);
+		return;
+	}
+
+	StatusMessage = MatrixCellsFailed > 0
+		? FString::Printf(TEXT("Prompt matrix finished: %d of %d failed, see the log."), MatrixCellsFailed, MatrixCellsTotal)
+		: FString::Printf(TEXT("Prompt matrix finished: %d combination(s)."), MatrixCellsTotal);
+	MatrixCellsTotal = 0;
+}
+
+void SChordPBRTab::StartGeneratePBRAsync()
+{
+	if (!Session.IsValid())
+	{
+		HandleError(TEXT("No session."));
+		return;
+	}
+
+	const FChordGeneratedImageItem* CurrentItem = GetCurrentImageItem();
+	if (!CurrentItem || !CurrentItem->Image.IsValid())
+	{
+		HandleError(TEXT("Select a generated image first."));
+		return;
+	}
+
+	UTexture2D* SourceTexture = CurrentItem->Image.Get();
+	if (!SourceTexture)
+	{
+		HandleError(TEXT("Invalid source texture."));
+		return;
+	}
+
+	if (TryUseSpeculativePBR(*CurrentItem))
+	{
+		return;
+	}
+
+	if (HasActiveJobForImage(CurrentItem->Id))
+	{
+		HandleError(TEXT("PBR maps for this image are already being generated."));
+		return;
+	}
+
+	FChordJobRequest Request;
+	FString EncodeError;
+	if (!FChordImageUtils::EncodeTextureToPng(SourceTexture, Request.SourcePng, EncodeError))
+	{
+		HandleError(EncodeError);
+		return;
+	}
+
+	Request.Type = EChordJobType::ImageToPBR;
+	Request.Label = GetCurrentImageLabel();
+	Request.SourceImageId = CurrentItem->Id;
+	Request.SourceTexture = SourceTexture;
+	Request.PreUploadedSources = CurrentItem->UploadedSources;
+
+	const FGuid TargetImageId = CurrentItem->Id;
+	const FChordJobRef Job = FChordJobScheduler::Get().Submit(MoveTemp(Request));
+	PBRJobTargets.AddUnique(Job->GetId(), TargetImageId);
+	if (ActiveJobs.Contains(Job))
+	{
+		// Another item in this gallery holds the same image; this tab already counts as one requester.
+		FChordJobScheduler::Get().Release(Job);
+		StatusMessage = FormatJobStatus(*Job);
+		return;
+	}
+	TrackJob(Job);
+}
+
+void SChordPBRTab::StartGenerateBatchPBRAsync()
+{
+	if (!Session.IsValid())
+	{
+		HandleError(TEXT("No session."));
+		return;
+	}
 
-		const FString ChannelsToDownload[] = { TEXT("BaseColor"), TEXT("Normal"), TEXT("Roughness"), TEXT("Metallic"), TEXT("Height") };
-		for (const FString& ChannelName : ChannelsToDownload)
+	const int32 MaxBatchSize = FMath::Max(1, GetDefault<UChordPBRSettings>()->MaxChordBatchSize);
+	TArray<FChordJobBatchImage> Pending;
+	int32 NumSubmitted = 0;
+	auto SubmitPending = [this, &Pending, &NumSubmitted]()
+	{
+		if (Pending.Num() == 0)
 		{
-			if (IsStale())
-			{
-				return;
-			}
+			return;
+		}
 
-			if (!DownloadChannel(ChannelName))
-			{
-				if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-				{
-					Pinned->HandleComfyFailure(TEXT("Download PBR maps"), ErrorLocal);
-				}
-				return;
-			}
+		FChordJobRequest Request;
+		if (Pending.Num() == 1)
+		{
+			// A lone image goes through the regular job so it can share work with a matching single request.
+			FChordJobBatchImage& Image = Pending[0];
+			Request.Type = EChordJobType::ImageToPBR;
+			Request.Label = Image.Label;
+			Request.SourcePng = MoveTemp(Image.SourcePng);
+			Request.SourceImageId = Image.ImageId;
+			Request.SourceTexture = Image.Texture;
+			Request.PreUploadedSources = MoveTemp(Image.PreUploadedSources);
+		}
+		else
+		{
+			Request.Type = EChordJobType::ImageToPBRBatch;
+			Request.Label = FString::Printf(TEXT("%s (+%d)"), *Pending[0].Label, Pending.Num() - 1);
+			Request.BatchImages = MoveTemp(Pending);
 		}
 
-		const FString MapLabel = FString::Printf(TEXT("PBR_%s"), *SafeLabel);
+		TArray<FGuid> ImageIds;
+		if (Request.Type == EChordJobType::ImageToPBR)
+		{
+			ImageIds.Add(Request.SourceImageId);
+		}
+		for (const FChordJobBatchImage& Image : Request.BatchImages)
+		{
+			ImageIds.Add(Image.ImageId);
+		}
 
-		AsyncTask(ENamedThreads::GameThread, [WidgetWeak, DownloadedChannels = MoveTemp(DownloadedChannels), MapLabel, SourceTextureWeak, RequestId, TargetImageIndex]() mutable
+		const FChordJobRef Job = FChordJobScheduler::Get().Submit(MoveTemp(Request));
+		for (const FGuid& ImageId : ImageIds)
 		{
-			if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-			{
-				if (Pinned->RequestCounter.GetValue() != RequestId)
-				{
-					return;
-				}
+			PBRJobTargets.AddUnique(Job->GetId(), ImageId);
+		}
+		if (ActiveJobs.Contains(Job))
+		{
+			FChordJobScheduler::Get().Release(Job);
+		}
+		else
+		{
+			TrackJob(Job);
+		}
+		NumSubmitted += ImageIds.Num();
+		Pending.Reset();
+	};
 
-					if (Pinned->Session.IsValid())
-					{
-						FChordPBRMapSet MapSet;
-						MapSet.Label = *MapLabel;
-						MapSet.SourceImage = SourceTextureWeak;
+	for (const FChordGeneratedImageItem& Item : Session->GetGeneratedImages())
+	{
+		// Images with a speculative job already have CHORD queued for them.
+		if (Item.bHasPBR || !Item.Image.IsValid() || HasActiveJobForImage(Item.Id) || SpeculativeJobs.Contains(Item.Id))
+		{
+			continue;
+		}
 
-					for (FDownloadedChannel& Item : DownloadedChannels)
-					{
-						if (UTexture2D* Tex = FChordImageUtils::CreateTextureFromImage(Item.Data, Item.FileName))
-						{
-							const FName UniqueTexName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), *Item.FileName);
-							Tex->Rename(*UniqueTexName.ToString());
-							if (Item.ChannelName == TEXT("BaseColor"))
-							{
-								MapSet.BaseColor = TStrongObjectPtr<UTexture2D>(Tex);
-								MapSet.BaseColorPath = Item.FilePath;
-								ConfigurePBRTexture(Tex, TEXT("BaseColor"));
-							}
-							else if (Item.ChannelName == TEXT("Normal"))
-							{
-								MapSet.Normal = TStrongObjectPtr<UTexture2D>(Tex);
-								MapSet.NormalPath = Item.FilePath;
-								ConfigurePBRTexture(Tex, TEXT("Normal"));
-							}
-							else if (Item.ChannelName == TEXT("Roughness"))
-							{
-								MapSet.Roughness = TStrongObjectPtr<UTexture2D>(Tex);
-								MapSet.RoughnessPath = Item.FilePath;
-								ConfigurePBRTexture(Tex, TEXT("Roughness"));
-							}
-							else if (Item.ChannelName == TEXT("Metallic"))
-							{
-								MapSet.Metallic = TStrongObjectPtr<UTexture2D>(Tex);
-								MapSet.MetallicPath = Item.FilePath;
-								ConfigurePBRTexture(Tex, TEXT("Metallic"));
-							}
-							else if (Item.ChannelName == TEXT("Height"))
-							{
-								MapSet.Height = TStrongObjectPtr<UTexture2D>(Tex);
-								MapSet.HeightPath = Item.FilePath;
-								ConfigurePBRTexture(Tex, TEXT("Height"));
-							}
-						}
-					}
+		FChordJobBatchImage& Image = Pending.AddDefaulted_GetRef();
+		FString EncodeError;
+		if (!FChordImageUtils::EncodeTextureToPng(Item.Image.Get(), Image.SourcePng, EncodeError))
+		{
+			UE_LOG(LogChordPBRGenerator, Warning, TEXT("Skipping %s: %s"), *Item.Label, *EncodeError);
+			Pending.Pop();
+			continue;
+		}
+		Image.ImageId = Item.Id;
+		Image.Label = Item.Label;
+		Image.Texture = Item.Image.Get();
+		Image.PreUploadedSources = Item.UploadedSources;
 
-					if (Pinned->Session->SetPBRMapsForImage(TargetImageIndex, MoveTemp(MapSet)))
-					{
-						if (FChordGeneratedImageItem* MutableItem = Pinned->Session->GetMutableImageItem(TargetImageIndex))
-						{
-							Pinned->EnsurePreviewMIDForImage(*MutableItem);
-						}
+		if (Pending.Num() >= MaxBatchSize)
+		{
+			SubmitPending();
+		}
+	}
+	SubmitPending();
 
-						Pinned->CurrentLayer = EChordGalleryLayer::Detail;
-						Pinned->CurrentImageIndex = TargetImageIndex;
-						Pinned->CurrentPBRChannelIndex = 0;
-						Pinned->StatusMessage = TEXT("PBR maps downloaded.");
-						Pinned->ApplyPreviewForCurrentImage(false, true);
-					}
-					else
-					{
-						Pinned->StatusMessage = TEXT("Failed to cache PBR maps.");
-					}
-					Pinned->bIsRunning = false;
-					Pinned->RebuildThumbnails();
-				}
-			}
-		});
-	});
+	if (NumSubmitted == 0)
+	{
+		StatusMessage = TEXT("Every image already has PBR maps or is being processed.");
+	}
 }
 
 FReply SChordPBRTab::OnCancel()
 {
-	if (bIsRunning && ComfyClient.IsValid())
+	if (ActiveJobs.Num() > 0)
 	{
-		RequestCounter.Increment();
-		StatusMessage = TEXT("Cancel requested.");
-		bIsRunning = false;
+		ClearLivePreview();
+
+		// Cells not submitted yet are simply dropped.
+		PendingMatrixCells.Reset();
 
-		TWeakPtr<SChordPBRTab> WidgetWeak = SharedThis(this);
-		TSharedPtr<FComfyUIClient> Client = ComfyClient;
-		EnqueueTask([WidgetWeak, Client]()
+		// Copied: cancelling a job that has not started finishes it, which removes it from ActiveJobs.
+		const TArray<FChordJobRef> JobsToCancel = ActiveJobs;
+		for (const FChordJobRef& Job : JobsToCancel)
 		{
-			FString Error;
-			Client->Cancel(Error);
-			if (!Error.IsEmpty())
-			{
-				AsyncTask(ENamedThreads::GameThread, [WidgetWeak, Error]()
-				{
-					if (TSharedPtr<SChordPBRTab> Pinned = WidgetWeak.Pin())
-					{
-						Pinned->StatusMessage = FString::Printf(TEXT("Cancel: %s"), *Error);
-					}
-				});
-			}
-		});
+			ReleaseJob(Job);
+		}
+		StatusMessage = TEXT("Cancel requested.");
 	}
 	return FReply::Handled();
 }
@@ -2136,10 +2685,11 @@ bool SChordPBRTab::RunSaveWorkflow(const FSaveDialogResult& DialogResult)
 	};
 
 	TArray<FChannelToSave> Channels;
-	Channels.Add({ TEXT("BaseColor"), Item->PBRMaps.BaseColor.Get(), Item->PBRMaps.BaseColorPath, true });
-	Channels.Add({ TEXT("Normal"), Item->PBRMaps.Normal.Get(), Item->PBRMaps.NormalPath, true });
-	Channels.Add({ TEXT("Roughness"), Item->PBRMaps.Roughness.Get(), Item->PBRMaps.RoughnessPath, true });
-	Channels.Add({ TEXT("Metallic"), Item->PBRMaps.Metallic.Get(), Item->PBRMaps.MetallicPath, true });
+	// Maps left out by the channel selection were never generated and are simply not saved.
+	Channels.Add({ TEXT("BaseColor"), Item->PBRMaps.BaseColor.Get(), Item->PBRMaps.BaseColorPath, !Item->PBRMaps.BaseColorPath.IsEmpty() });
+	Channels.Add({ TEXT("Normal"), Item->PBRMaps.Normal.Get(), Item->PBRMaps.NormalPath, !Item->PBRMaps.NormalPath.IsEmpty() });
+	Channels.Add({ TEXT("Roughness"), Item->PBRMaps.Roughness.Get(), Item->PBRMaps.RoughnessPath, !Item->PBRMaps.RoughnessPath.IsEmpty() });
+	Channels.Add({ TEXT("Metallic"), Item->PBRMaps.Metallic.Get(), Item->PBRMaps.MetallicPath, !Item->PBRMaps.MetallicPath.IsEmpty() });
 	Channels.Add({ TEXT("Height"), Item->PBRMaps.Height.Get(), Item->PBRMaps.HeightPath, false });
 	const bool bHadHeight = Channels.Last().Texture != nullptr || !Channels.Last().FilePath.IsEmpty();
 
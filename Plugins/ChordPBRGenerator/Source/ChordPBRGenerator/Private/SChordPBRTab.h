@@ -3,16 +3,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ChordCancellationToken.h"
+#include "ChordJob.h"
 #include "ChordPBRSession.h"
 #include "ChordPBRSettings.h"
+#include "ChordPromptMatrix.h"
 #include "PreviewMaterialApplier.h"
-#include "HAL/ThreadSafeCounter.h"
+#include "Containers/Ticker.h"
 #include "Widgets/SCompoundWidget.h"
 #include "Widgets/DeclarativeSyntaxSupport.h"
 #include "Styling/SlateBrush.h"
 
-class FComfyUIClient;
-class FGeminiApiClient;
 class AActor;
 
 class SChordPBRTab : public SCompoundWidget
@@ -33,7 +34,9 @@ private:
 	FText GetBackLabel() const;
 	FText GetPBRImagesLabel() const;
 	FReply OnGenerateImages();
+	FReply OnRunPromptMatrix();
 	FReply OnGeneratePBRMaps();
+	FReply OnGenerateAllPBRMaps();
 	FReply OnPreviousImage();
 	FReply OnNextImage();
 	FReply OnCancel();
@@ -43,6 +46,7 @@ private:
 	FReply OnClearPreviewTarget();
 	FReply OnSaveAssets();
 	FReply OnDeleteCurrentImage();
+	FReply OnKeepDraft();
 
 	// Helpers
 	void UpdateNavigationIndex(int32 Delta);
@@ -63,13 +67,37 @@ private:
 	void SelectPBRChannel(int32 ChannelIndex);
 	FText GetPBRChannelLabel(int32 ChannelIndex) const;
 	FText GetStatusText() const;
-	void SetStatusAsync(const FString& InStatus, bool bInRunning);
 	void AppendSystemMessage(const FString& Message);
 	void EnqueueTask(TFunction<void()> InTask);
 	void HandleError(const FString& Message);
-	void HandleComfyFailure(const FString& Context, const FString& Error);
+	void HandleLivePreviewFrame(const FChordJobRef& Job, const TArray<uint8>& ImageData);
+	void ClearLivePreview();
+	void TrackJob(const FChordJobRef& Job);
+	void ReleaseJob(const FChordJobRef& Job);
+	void StartSpeculativePBR(const FChordGeneratedImageItem& Item);
+	void StartPreUpload(const FChordGeneratedImageItem& Item);
+	void StartDeferredPreUploads();
+	bool TryUseSpeculativePBR(const FChordGeneratedImageItem& Item);
+	void ApplySpeculativeOutputs(const FChordJob& Job, const FGuid& ImageId);
+	void CancelSpeculativePBR(const FGuid& ImageId);
+	FString FormatJobStatus(const FChordJob& Job) const;
+	void HandleJobChanged(const FChordJobRef& Job);
+	void ApplyJobOutputs(const FChordJob& Job);
+	bool HasActiveJobForImage(const FGuid& ImageId) const;
+	bool CanKeepCurrentDraft() const;
+	static bool IsFusedImageJob(const FChordJob& Job);
+	int32 AddJobImage(const FChordJob& Job, int32 OutputIndex);
+	void StartImageBackgroundWork(const FChordGeneratedImageItem& Item);
+	void HandleJobImageReady(const FChordJobRef& Job, int32 OutputIndex);
+	bool ApplyDraftFinalOutputs(const FChordJob& Job);
+	void StartServerWarmUp(bool bRunWarmUpPrompts);
+	bool HandleWarmUpTick(float DeltaTime);
+	void ReportWarmUpStatus(const FString& Message, bool bFinished);
 	void StartGenerateImagesAsync();
+	void StartPromptMatrix();
+	void PumpPromptMatrix();
 	void StartGeneratePBRAsync();
+	void StartGenerateBatchPBRAsync();
 	AActor* GetFirstSelectedActor() const;
 	bool EnsurePreviewMIDForImage(FChordGeneratedImageItem& Item);
 	void ApplyPreviewForCurrentImage(bool bAllowRestoreIfMissing = true, bool bForceApply = false);
@@ -104,6 +132,9 @@ private:
 	TSharedPtr<class SScrollBox, ESPMode::ThreadSafe> ThumbnailStrip;
 
 	TSharedPtr<FSlateBrush> MainImageBrush;
+	TStrongObjectPtr<UTexture2D> LivePreviewTexture;
+	bool bLivePreviewDecodeInFlight = false;
+	FGuid LivePreviewJobId;
 	mutable TMap<UTexture2D*, TSharedPtr<FSlateBrush>> BrushCache;
 
 	TSharedPtr<FChordPBRSession> Session;
@@ -114,9 +145,37 @@ private:
 	TWeakObjectPtr<AActor> PreviewTargetActor;
 	FPreviewMaterialApplier PreviewApplier;
 
-	bool bIsRunning = false;
 	FString StatusMessage;
-	TSharedPtr<FComfyUIClient> ComfyClient;
-	TSharedPtr<FGeminiApiClient> GeminiClient;
-	FThreadSafeCounter RequestCounter;
+
+	// Jobs this tab submitted that have not finished; the scheduler runs them, the tab only reflects them.
+	TArray<FChordJobRef> ActiveJobs;
+	// PBR job id -> gallery items waiting for its maps; a shared job can serve several.
+	TMultiMap<FGuid, FGuid> PBRJobTargets;
+	// Background PBR started for new images before anyone asked (bSpeculativePBRForNewImages), keyed by image id.
+	TMap<FGuid, FChordJobRef> SpeculativeJobs;
+	// Images whose maps arrived from a speculative job that nobody has asked for yet.
+	TSet<FGuid> SpeculatedImageIds;
+	// Images whose pre-upload waits for the interactive jobs to finish.
+	TArray<FGuid> DeferredPreUploads;
+	// Full-quality render job id -> the draft image it replaces.
+	TMap<FGuid, FGuid> DraftFinalJobs;
+	// Text-to-image job id -> gallery items already added for its outputs, in output order.
+	TMap<FGuid, TArray<FGuid>> StreamedJobImages;
+	// Prompt matrix run: cells wait here until a job slot frees up, so the scheduler queue stays short and an
+	// interactive click does not end up behind the whole grid.
+	TArray<FChordPromptMatrixCell> PendingMatrixCells;
+	FString MatrixBaseLabel;
+	TSet<FGuid> MatrixJobIds;
+	int32 MatrixCellsTotal = 0;
+	int32 MatrixCellsFinished = 0;
+	int32 MatrixCellsFailed = 0;
+	FDelegateHandle JobChangedHandle;
+	FDelegateHandle JobPreviewFrameHandle;
+	FDelegateHandle JobImageReadyHandle;
+
+	// Readiness probe and model warm-up; never blocks or reports over a real job.
+	FChordCancellationTokenPtr WarmUpToken;
+	FTSTicker::FDelegateHandle WarmUpTickerHandle;
+	bool bWarmUpInFlight = false;
+	int32 WarmUpCount = 0;
 };
@@ -0,0 +1,57 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChordPBRSettings.h"
+#include "HAL/CriticalSection.h"
+
+/** One way to generate an image: Gemini, or a ComfyUI template with its bindings. */
+struct FChordTxt2ImgRoute
+{
+	bool bGemini = false;
+	FString TemplatePath;
+	FComfyTxt2ImgBinding Binding;
+	EChordQualityTier Quality = EChordQualityTier::Standard;
+
+	// Identifies the route in the latency statistics.
+	FString GetKey() const;
+};
+
+/**
+ * Observed latency and failures of every image generation route, and the Auto backend's choice between them.
+ * Statistics live for the editor session; until a route has run, a guess by quality tier stands in for it.
+ * Thread-safe.
+ */
+class FChordBackendRouter
+{
+public:
+	static FChordBackendRouter& Get();
+
+	// The route the backend setting asks for; Auto picks one from the statistics. Without bAllowGemini only
+	// ComfyUI routes are considered, for a Gemini job's fallback.
+	FChordTxt2ImgRoute ChooseRoute(const UChordPBRSettings& Settings, bool bAllowGemini = true) const;
+
+	// The ComfyUI route with the regular image template, which Gemini fails over to.
+	static FChordTxt2ImgRoute GetDefaultComfyRoute(const UChordPBRSettings& Settings);
+
+	// Seconds from the start of an attempt until its images were downloaded, or that it failed. A failed route
+	// is skipped for a while, longer after each further failure in a row.
+	void Record(const FString& RouteKey, bool bSucceeded, double Seconds);
+
+private:
+	struct FRouteStats
+	{
+		double AverageSeconds = 0.0;
+		int32 NumSamples = 0;
+		int32 NumFailures = 0;
+		int32 ConsecutiveFailures = 0;
+		double CooldownUntil = 0.0;
+	};
+
+	static TArray<FChordTxt2ImgRoute> GetCandidates(const UChordPBRSettings& Settings, bool bAllowGemini);
+	double GetExpectedSeconds(const FChordTxt2ImgRoute& Route) const;
+
+	mutable FCriticalSection Mutex;
+	TMap<FString, FRouteStats> Stats;
+};
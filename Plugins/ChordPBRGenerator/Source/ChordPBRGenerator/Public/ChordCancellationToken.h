@@ -0,0 +1,49 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Atomic.h"
+
+/**
+ * Cooperative cancellation shared between the tab and the worker running a job.
+ * Blocking calls register a callback that aborts whatever they are waiting on, so Cancel() wakes them immediately.
+ */
+class FChordCancellationToken
+{
+public:
+	using FCallbackHandle = uint64;
+
+	bool IsCancelled() const { return bCancelled; }
+
+	// Runs every registered callback once, on the calling thread.
+	void Cancel();
+
+	// Runs the callback right away if the token is already cancelled. Returns 0 in that case.
+	FCallbackHandle Register(TFunction<void()> Callback);
+	void Unregister(FCallbackHandle Handle);
+
+	/** Registers a callback for the lifetime of a blocking call. A null token is allowed. */
+	class FScopedCallback
+	{
+	public:
+		FScopedCallback(const TSharedPtr<FChordCancellationToken, ESPMode::ThreadSafe>& InToken, TFunction<void()> Callback);
+		~FScopedCallback();
+
+		FScopedCallback(const FScopedCallback&) = delete;
+		FScopedCallback& operator=(const FScopedCallback&) = delete;
+
+	private:
+		TSharedPtr<FChordCancellationToken, ESPMode::ThreadSafe> Token;
+		FCallbackHandle Handle = 0;
+	};
+
+private:
+	TAtomic<bool> bCancelled{ false };
+	FCriticalSection Mutex;
+	TMap<FCallbackHandle, TFunction<void()>> Callbacks;
+	FCallbackHandle NextHandle = 1;
+};
+
+using FChordCancellationTokenPtr = TSharedPtr<FChordCancellationToken, ESPMode::ThreadSafe>;
@@ -0,0 +1,47 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** A square region of a source image that CHORD runs on by itself. */
+struct FChordImageTile
+{
+	int32 X = 0;
+	int32 Y = 0;
+	int32 Size = 0;
+};
+
+namespace FChordImageTiling
+{
+	// Square tiles of side min(TileSize, Width, Height) covering the image, neighbours overlapping by at least
+	// Overlap pixels. Every tile has the same size so the template's resize node scales them all alike.
+	TArray<FChordImageTile> ComputeTiles(int32 Width, int32 Height, int32 TileSize, int32 Overlap);
+
+	// Copies one tile out of a BGRA image.
+	void CropTile(const TArray64<uint8>& BGRA, int32 Width, const FChordImageTile& Tile, TArray<FColor>& OutPixels);
+}
+
+/**
+ * Blends per-tile maps back into one image at the source resolution. Inside the overlap each tile fades out
+ * linearly towards a neighbour, so seams become cross-fades. One stitcher per channel; not thread-safe.
+ */
+class FChordTileStitcher
+{
+public:
+	FChordTileStitcher(int32 InWidth, int32 InHeight, int32 InOverlap);
+
+	// The map may have any size; it is resampled onto the tile's square.
+	void AddTile(const FChordImageTile& Tile, const TArray64<uint8>& BGRA, int32 MapWidth, int32 MapHeight);
+
+	// bRenormalize treats RGB as a tangent-space normal: a blend of two unit normals is shorter than one.
+	void Finish(bool bRenormalize, TArray<FColor>& OutPixels) const;
+
+private:
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 Overlap = 0;
+
+	// Four floats per pixel: weighted B, G, R and the summed weight in place of alpha.
+	TArray64<float> Accumulated;
+};
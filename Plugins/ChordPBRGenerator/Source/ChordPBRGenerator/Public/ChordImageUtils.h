@@ -10,9 +10,29 @@ namespace FChordImageUtils
 	// Decode image bytes (PNG/JPG/WebP) into a transient texture.
 	UTexture2D* CreateTextureFromImage(const TArray<uint8>& ImageData, const FString& DebugName);
 
+	// Decode image bytes to 8-bit BGRA. Safe off the game thread once the ImageWrapper module is loaded.
+	bool DecodeImage(const TArray<uint8>& ImageData, TArray64<uint8>& OutBGRA, int32& OutWidth, int32& OutHeight);
+
+	// Reads the dimensions from the image header without decoding the pixels.
+	bool GetImageSize(const TArray<uint8>& ImageData, int32& OutWidth, int32& OutHeight);
+
+	// Box-filter downscale of 8-bit BGRA: every source pixel contributes by the area it covers. Safe off the game thread.
+	void DownscalePixels(const TArray64<uint8>& BGRA, int32 Width, int32 Height, int32 NewWidth, int32 NewHeight, TArray<FColor>& OutPixels);
+
+	// Re-encodes the image as PNG with its longer side scaled down to MaxSide. Leaves OutPngData empty when the
+	// image already fits. Safe off the game thread once the ImageWrapper module is loaded.
+	bool DownscaleImageToFit(const TArray<uint8>& ImageData, int32 MaxSide, TArray<uint8>& OutPngData, FString& OutError);
+
+	// Build a transient texture from BGRA pixels, or refresh an existing one in place when the size matches.
+	UTexture2D* CreateTextureFromPixels(const TArray64<uint8>& BGRA, int32 Width, int32 Height, const FString& DebugName);
+	bool UpdateTexturePixels(UTexture2D* Texture, const TArray64<uint8>& BGRA, int32 Width, int32 Height);
+
 	// Encode a transient texture's first mip to PNG bytes.
 	bool EncodeTextureToPng(UTexture2D* Texture, TArray<uint8>& OutPngData, FString& OutError);
 
+	// Encode raw pixels to PNG bytes. Safe off the game thread.
+	bool EncodePixelsToPng(const TArray<FColor>& Pixels, int32 Width, int32 Height, TArray<uint8>& OutPngData, FString& OutError);
+
 	// Encode a transient texture and write it to disk as PNG.
 	bool SaveTextureToPng(UTexture2D* Texture, const FString& AbsoluteFilePath, FString& OutError);
 }
@@ -0,0 +1,216 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChordCancellationToken.h"
+#include "ChordPBRSession.h"
+#include "ComfyUIClient.h"
+#include "HAL/CriticalSection.h"
+#include "UObject/StrongObjectPtr.h"
+
+class FChordJob;
+class UChordPBRSettings;
+
+using FChordJobRef = TSharedRef<FChordJob, ESPMode::ThreadSafe>;
+using FChordJobPtr = TSharedPtr<FChordJob, ESPMode::ThreadSafe>;
+
+enum class EChordJobType : uint8
+{
+	TextToImage,
+	ImageToPBR,
+	// Several gallery images through CHORD in one prompt.
+	ImageToPBRBatch
+};
+
+enum class EChordJobState : uint8
+{
+	Pending,
+	Running,
+	Succeeded,
+	Failed,
+	Cancelled
+};
+
+/** A prompt queued by an earlier editor session that a job should wait for instead of submitting new work. */
+struct FChordJobReattach
+{
+	FGuid JournalId;
+	FString PromptId;
+	FString ClientId;
+	FString ServerUrl;
+	// TextToImage: the template the prompt was built from and whether CHORD ran in it. Empty in older journals.
+	FString TemplatePath;
+	bool bFused = false;
+	// The CHORD channels the prompt was pruned to; the outputs are read back with these, not the current settings.
+	TOptional<FChordPBRChannelSelection> ChordOutputChannels;
+
+	bool IsSet() const { return !PromptId.IsEmpty(); }
+};
+
+/** One source image of an ImageToPBRBatch job. */
+struct FChordJobBatchImage
+{
+	TArray<uint8> SourcePng;
+	FGuid ImageId;
+	FString Label;
+	TWeakObjectPtr<UTexture2D> Texture;
+	TMap<FString, FComfyImageReference> PreUploadedSources;
+};
+
+/** What to run. Everything a job needs from the editor is copied in here when it is submitted. */
+struct FChordJobRequest
+{
+	EChordJobType Type = EChordJobType::TextToImage;
+	EComfyJobPriority Priority = EComfyJobPriority::Interactive;
+
+	// TextToImage: the prompt and the base name for the output images.
+	FString Prompt;
+	FString Label;
+	// A cheap draft render instead of the full template. Seed < 0 picks a fresh one; a kept draft passes its own.
+	bool bDraft = false;
+	int32 Seed = -1;
+	// The full render of a kept draft. It stays on the regular ComfyUI template so the seed reproduces the draft,
+	// and renders only the draft's slot of its batch (DraftBatchSize 0: the template's default batch).
+	bool bKeptDraft = false;
+	int32 DraftBatchSize = 0;
+	int32 DraftBatchIndex = 0;
+
+	// ImageToPBR: the encoded source image and the gallery item it belongs to. Label names the maps.
+	TArray<uint8> SourcePng;
+	FGuid SourceImageId;
+	TWeakObjectPtr<UTexture2D> SourceTexture;
+	// Copies of the source image already on a server (keyed by URL); the upload is skipped on those.
+	TMap<FString, FComfyImageReference> PreUploadedSources;
+
+	// ImageToPBRBatch: the images to run, in branch order.
+	TArray<FChordJobBatchImage> BatchImages;
+
+	FChordJobReattach Reattach;
+};
+
+/** One step of a job. Stages run in order; the first failure or a cancellation ends the job. */
+struct FChordJobStage
+{
+	FString Name;
+	// Stages that create UObjects run on the game thread, everything else on the thread pool.
+	bool bGameThread = false;
+	TFunction<bool(FChordJob& Job, FString& OutError)> Run;
+};
+
+struct FChordJobStageTiming
+{
+	FString Name;
+	double Seconds = 0.0;
+};
+
+struct FChordJobImageOutput
+{
+	FString Label;
+	TStrongObjectPtr<UTexture2D> Texture;
+	// Seed the ComfyUI prompt ran with, -1 when unknown (Gemini, resumed prompts).
+	int32 Seed = -1;
+	// Generated by Gemini; with failover a Gemini job may still have come from ComfyUI.
+	bool bGemini = false;
+	// First image of a fused prompt: its PBR maps arrive in OutputPBRMaps when the job finishes.
+	bool bFusedMaps = false;
+};
+
+struct FChordJobBatchOutput
+{
+	FGuid ImageId;
+	FChordPBRMapSet Maps;
+};
+
+/**
+ * A single generation request and its progress. Created by FChordJobScheduler, which owns the stage list and
+ * the state; observers read status and outputs on the game thread.
+ */
+class FChordJob : public TSharedFromThis<FChordJob, ESPMode::ThreadSafe>
+{
+public:
+	FChordJob(FChordJobRequest&& InRequest, UChordPBRSettings* InSettingsSnapshot);
+	~FChordJob();
+
+	FChordJob(const FChordJob&) = delete;
+	FChordJob& operator=(const FChordJob&) = delete;
+
+	const FGuid& GetId() const { return Id; }
+	// Key of the job's journal entry; a resumed job keeps the one it was journaled under.
+	const FGuid& GetJournalId() const { return Request.Reattach.JournalId.IsValid() ? Request.Reattach.JournalId : Id; }
+	EChordJobType GetType() const { return Request.Type; }
+	const FChordJobRequest& GetRequest() const { return Request; }
+
+	// Settings as they were when the job was submitted; later edits in Project Settings do not affect it.
+	const UChordPBRSettings& GetSettings() const { return *Settings; }
+
+	EChordJobState GetState() const { return State; }
+	bool IsFinished() const { return State == EChordJobState::Succeeded || State == EChordJobState::Failed || State == EChordJobState::Cancelled; }
+	FString GetStatus() const;
+	const FString& GetError() const { return Error; }
+	const TArray<FChordJobStageTiming>& GetStageTimings() const { return StageTimings; }
+
+	const FChordCancellationTokenPtr& GetCancellationToken() const { return CancellationToken; }
+	bool IsCancelled() const { return CancellationToken->IsCancelled(); }
+
+	// Requested priority, or Interactive once someone started waiting on a background job.
+	EComfyJobPriority GetPriority() const { return PromotionSignal->IsCancelled() ? EComfyJobPriority::Interactive : Request.Priority; }
+	const FChordCancellationTokenPtr& GetPromotionSignal() const { return PromotionSignal; }
+
+	// Aborts the running stage and removes the job's prompt from the ComfyUI queue. Any thread.
+	void Cancel();
+
+	// Stops waiting but leaves the prompt running and journaled, so the next editor session can pick it up.
+	void Detach();
+	bool IsDetached() const { return bDetached; }
+
+	// Stage helpers, callable from any thread.
+	void SetStatus(const FString& InStatus);
+	void NoteQueuedPrompt(const TSharedRef<FComfyUIClient>& Client, const FComfyPromptResponse& Queued);
+	void ClearQueuedPrompt();
+
+	// Outputs, filled by the last stage on the game thread.
+	TArray<FChordJobImageOutput> OutputImages;
+	FChordPBRMapSet OutputPBRMaps;
+	// ImageToPBRBatch: maps for each image that completed, in request order.
+	TArray<FChordJobBatchOutput> OutputPBRBatch;
+
+private:
+	friend class FChordJobScheduler;
+
+	void CancelQueuedPrompt();
+
+	FGuid Id;
+	FChordJobRequest Request;
+	UChordPBRSettings* Settings = nullptr;
+	FChordCancellationTokenPtr CancellationToken;
+	// One-shot latch fired by the scheduler when the job is promoted; its clients watch it.
+	FChordCancellationTokenPtr PromotionSignal;
+	TAtomic<bool> bDetached{ false };
+
+	// Fixed at submission. Timings are appended by whichever thread runs the stage; stages never overlap.
+	TArray<FChordJobStage> Stages;
+	TArray<FChordJobStageTiming> StageTimings;
+
+	// Owned by the scheduler, game thread only.
+	EChordJobState State = EChordJobState::Pending;
+	FString Error;
+	double StartTime = 0.0;
+	// Identifies equivalent work (source image hash and template) so duplicate requests can share the job.
+	FString CoalesceKey;
+	int32 NumRequesters = 1;
+
+	mutable FCriticalSection Mutex;
+	FString Status;
+	TSharedPtr<FComfyUIClient> QueuedClient;
+	FString QueuedPromptId;
+};
+
+namespace FChordJobStages
+{
+	// Builds the stage list for a job from its request type and settings snapshot.
+	TArray<FChordJobStage> Build(const FChordJob& Job);
+
+	// ImageToPBR requests whose source exceeds ChordTileSize run per tile and are stitched afterwards.
+	bool ShouldTile(const FChordJobRequest& Request, const UChordPBRSettings& Settings);
+}
@@ -0,0 +1,55 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChordJob.h"
+#include "HAL/CriticalSection.h"
+
+struct FChordJournalEntry
+{
+	FGuid JobId;
+	EChordJobType Type = EChordJobType::TextToImage;
+	FString PromptId;
+	FString ClientId;
+	FString ServerUrl;
+	FString Label;
+	FString Stage;
+	// ImageToPBR: copy of the source image, so the gallery item can be rebuilt after a restart.
+	FString SourceImagePath;
+	// TextToImage: the template of the prompt, and whether it is the fused one that also runs CHORD.
+	FString TemplatePath;
+	bool bFused = false;
+	// CHORD channels the prompt was pruned to (FChordPBRChannelSelection::ToKey). Empty in older journals.
+	FString ChordOutputChannels;
+};
+
+/**
+ * On-disk list of prompts that are queued on a ComfyUI server but whose results have not reached the editor yet.
+ * Lives in <SavedCacheRoot>/Jobs and is rewritten on every change, so a crash loses at most the entry being written.
+ * Entries found on disk when the editor starts belong to an earlier session and can be resumed.
+ */
+class FChordJobJournal
+{
+public:
+	static FChordJobJournal& Get();
+
+	// Called once the server accepted the job's prompt, built from TemplatePath. Any thread.
+	void Record(const FChordJob& Job, const FString& ServerUrl, const FComfyPromptResponse& Queued, const FString& TemplatePath, bool bFused);
+	void UpdateStage(const FGuid& JobId, const FString& Stage);
+	void Remove(const FGuid& JobId);
+
+	// Entries left behind by an earlier editor session. Each is handed out once.
+	TArray<FChordJournalEntry> TakeOrphanedEntries();
+
+private:
+	void LoadIfNeeded();
+	void Save() const;
+	FString GetJournalPath() const;
+
+	mutable FCriticalSection Mutex;
+	bool bLoaded = false;
+	FString JournalDir;
+	TArray<FChordJournalEntry> Entries;
+	TSet<FGuid> OrphanedIds;
+};
@@ -0,0 +1,79 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ChordJob.h"
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnChordJobChanged, const FChordJobRef& /*Job*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnChordJobPreviewFrame, const FChordJobRef& /*Job*/, const TArray<uint8>& /*ImageData*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnChordJobImageReady, const FChordJobRef& /*Job*/, int32 /*OutputIndex*/);
+
+/**
+ * Runs generation jobs independently of any UI.
+ * Jobs wait in submission order until one of MaxConcurrentJobs slots frees up, then walk their stages on the
+ * thread pool (or the game thread for stages that create UObjects). Interactive jobs start ahead of background
+ * ones, which never take the last free slot. With a single slot, background work only runs while the scheduler is
+ * otherwise idle, and an interactive job starts alongside it rather than waiting. Every event is broadcast on the
+ * game thread.
+ */
+class FChordJobScheduler
+{
+public:
+	static FChordJobScheduler& Get();
+
+	// Game thread. Snapshots the current settings into the job before queueing it. A PBR request for an image
+	// and template that an unfinished job already covers returns that job instead of queueing the work again.
+	FChordJobRef Submit(FChordJobRequest&& Request);
+
+	// Cancels a job; one still waiting for a slot finishes right away.
+	void Cancel(const FChordJobRef& Job);
+
+	// Lifts a background job to Interactive, ahead of other waiting work and of the server's queue if not yet submitted.
+	void Promote(const FChordJobRef& Job);
+
+	// Drops one requester of a shared job; it is cancelled once nobody is waiting for it. Returns true if it was.
+	bool Release(const FChordJobRef& Job);
+	void CancelAll();
+
+	// Editor shutdown: drops waiting jobs but leaves queued prompts running on the server and in the journal.
+	// Returns once the running stages have wound down and their jobs finished, so none of them calls back into a
+	// module that is being unloaded.
+	void DetachAll();
+
+	// Game thread. Submits a job for every prompt an earlier session left in the journal.
+	TArray<FChordJobRef> ResumeJournaledJobs();
+
+	// Pending and running jobs, oldest first.
+	TArray<FChordJobRef> GetActiveJobs() const;
+	int32 GetNumActiveJobs() const { return PendingJobs.Num() + RunningJobs.Num(); }
+	// Whether someone is waiting on a running job; idle-time work holds back until nobody is.
+	bool HasRunningInteractiveJobs() const;
+
+	// Fires on status changes, on start and once when the job finishes.
+	FOnChordJobChanged& OnJobChanged() { return JobChangedEvent; }
+	FOnChordJobPreviewFrame& OnJobPreviewFrame() { return PreviewFrameEvent; }
+	// Fires when a running job adds Job->OutputImages[OutputIndex], before the job itself finishes.
+	FOnChordJobImageReady& OnJobImageReady() { return ImageReadyEvent; }
+
+	// Any thread; the broadcast is deferred to the game thread.
+	void NotifyJobChanged(const FChordJobRef& Job);
+	void NotifyPreviewFrame(const FChordJobRef& Job, const TArray<uint8>& ImageData);
+	void NotifyImageReady(const FChordJobRef& Job, int32 OutputIndex);
+
+private:
+	FChordJobPtr FindCoalescableJob(const FString& CoalesceKey) const;
+	void PumpQueue();
+	void RunStage(const FChordJobRef& Job, int32 StageIndex);
+	void FinishJob(const FChordJobRef& Job, EChordJobState FinalState, const FString& Error);
+
+	// Stage bodies dispatched and not yet returned, on any thread.
+	TAtomic<int32> NumStagesInFlight{ 0 };
+
+	// Game thread only.
+	TArray<FChordJobRef> PendingJobs;
+	TArray<FChordJobRef> RunningJobs;
+	FOnChordJobChanged JobChangedEvent;
+	FOnChordJobPreviewFrame PreviewFrameEvent;
+	FOnChordJobImageReady ImageReadyEvent;
+};
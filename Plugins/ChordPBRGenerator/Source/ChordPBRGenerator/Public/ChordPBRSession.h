@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ComfyUIClient.h"
 #include "Engine/Texture2D.h"
 #include "Materials/MaterialInstanceDynamic.h"
 
@@ -26,14 +27,28 @@ struct FChordPBRMapSet
 	FString RoughnessPath;
 	FString MetallicPath;
 	FString HeightPath;
+
+	bool HasAnyMap() const { return BaseColor.IsValid() || Normal.IsValid() || Roughness.IsValid() || Metallic.IsValid() || Height.IsValid(); }
 };
 
 struct FChordGeneratedImageItem
 {
+	// Stable across deletions, unlike the index; jobs use it to find the image they were started for.
+	FGuid Id;
 	TStrongObjectPtr<UTexture2D> Image;
 	FString Label;
+	// Server URL -> the image as uploaded there ahead of time, so a PBR request can skip the upload.
+	TMap<FString, FComfyImageReference> UploadedSources;
 	bool bHasPBR = false;
 	FChordPBRMapSet PBRMaps;
+	// A fast preview (bDraftFirst); keeping it renders the full-quality image from the same prompt and seed.
+	bool bDraft = false;
+	FString DraftPrompt;
+	int32 DraftSeed = -1;
+	// Position in the draft's batch and that batch's size (0: the template's default), so the final render can
+	// reproduce just this image.
+	int32 DraftBatchIndex = 0;
+	int32 DraftBatchSize = 0;
 	TStrongObjectPtr<UMaterialInstanceDynamic> PreviewMID;
 };
 
@@ -50,6 +65,7 @@ public:
 	bool HasPBRForImage(int32 ImageIndex) const;
 	const FChordPBRMapSet* GetPBRMapsForImage(int32 ImageIndex) const;
 	FChordGeneratedImageItem* GetMutableImageItem(int32 ImageIndex);
+	int32 FindImageIndexById(const FGuid& ImageId) const;
 
 private:
 	TArray<FChordGeneratedImageItem> GeneratedImages;
@@ -12,7 +12,17 @@ UENUM()
 enum class ETxt2ImgBackend : uint8
 {
 	ComfyUI UMETA(DisplayName = "Local ComfyUI"),
-	GeminiAPI UMETA(DisplayName = "Gemini API")
+	GeminiAPI UMETA(DisplayName = "Gemini API"),
+	Auto UMETA(DisplayName = "Auto (fastest healthy)")
+};
+
+// How good an image generation route is expected to look; the Auto backend never routes below the chosen floor.
+UENUM()
+enum class EChordQualityTier : uint8
+{
+	Draft,
+	Standard,
+	High
 };
 
 USTRUCT()
@@ -33,6 +43,21 @@ struct FComfyTxt2ImgBinding
 	FString SeedInputName = TEXT("seed");
 };
 
+USTRUCT()
+struct FChordTxt2ImgRouteTemplate
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Config, Category = "Routing", meta = (ToolTip = "Txt2Img API prompt template path (JSON). Plugin-relative or absolute."))
+	FString TemplatePath;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Routing")
+	FComfyTxt2ImgBinding Binding;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Routing")
+	EChordQualityTier Quality = EChordQualityTier::Standard;
+};
+
 USTRUCT()
 struct FComfyPBRChannelBinding
 {
@@ -75,6 +100,65 @@ struct FComfyChordBinding
 	FComfyPBRChannelBinding Height;
 };
 
+/** Which CHORD maps a job asks for. Unselected maps are pruned from the graph and never downloaded. */
+USTRUCT()
+struct FChordPBRChannelSelection
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Config, Category = "Channels")
+	bool bBaseColor = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Channels")
+	bool bNormal = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Channels")
+	bool bRoughness = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Channels")
+	bool bMetallic = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Channels")
+	bool bHeight = true;
+
+	// Channel names as used by the CHORD bindings: BaseColor, Normal, Roughness, Metallic, Height.
+	bool IsEnabled(const FString& Channel) const
+	{
+		return Channel == TEXT("BaseColor") ? bBaseColor
+			: Channel == TEXT("Normal") ? bNormal
+			: Channel == TEXT("Roughness") ? bRoughness
+			: Channel == TEXT("Metallic") ? bMetallic
+			: Channel == TEXT("Height") ? bHeight
+			: true;
+	}
+
+	bool IsEverything() const { return bBaseColor && bNormal && bRoughness && bMetallic && bHeight; }
+
+	FString ToKey() const
+	{
+		return FString::Printf(TEXT("%d%d%d%d%d"), bBaseColor, bNormal, bRoughness, bMetallic, bHeight);
+	}
+
+	// Inverse of ToKey; false for anything ToKey could not have produced.
+	static bool FromKey(const FString& Key, FChordPBRChannelSelection& OutSelection)
+	{
+		if (Key.Len() != 5)
+		{
+			return false;
+		}
+		bool* const Flags[] = { &OutSelection.bBaseColor, &OutSelection.bNormal, &OutSelection.bRoughness, &OutSelection.bMetallic, &OutSelection.bHeight };
+		for (int32 Index = 0; Index < 5; ++Index)
+		{
+			if (Key[Index] != TEXT('0') && Key[Index] != TEXT('1'))
+			{
+				return false;
+			}
+			*Flags[Index] = Key[Index] == TEXT('1');
+		}
+		return true;
+	}
+};
+
 UCLASS(Config = Editor, DefaultConfig)
 class UChordPBRSettings : public UDeveloperSettings
 {
@@ -91,42 +175,160 @@ public:
 	ETxt2ImgBackend Txt2ImgBackend = ETxt2ImgBackend::ComfyUI;
 
 	// ComfyUI Workflow Settings for Text-to-Image (only shown when ComfyUI is selected)
-	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::ComfyUI", EditConditionHides, ToolTip = "Txt2Img API prompt template path (JSON). Plugin-relative or absolute."))
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI", EditConditionHides, ToolTip = "Txt2Img API prompt template path (JSON). Plugin-relative or absolute."))
 	FString Txt2ImgApiPromptPath;
 
-	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::ComfyUI", EditConditionHides))
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI", EditConditionHides))
 	FComfyTxt2ImgBinding Txt2ImgBinding;
 
-	// Gemini API Settings for Text-to-Image (only shown when Gemini API is selected)
-	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::GeminiAPI", EditConditionHides, DisplayName = "Gemini API Key", PasswordField = true, ToolTip = "Your Gemini API key from Google AI Studio."))
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI", EditConditionHides, ToolTip = "Show the sampler's latent preview frames while an image generates. The ComfyUI server must run with a preview method (e.g. --preview-method auto)."))
+	bool bShowLivePreviews = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (ClampMin = "0", ClampMax = "16", ToolTip = "Images per Generate Images click, patched into the template's latent batch_size; Gemini sends this many requests in parallel. Each image appears in the gallery as soon as it has downloaded. 0 keeps the template's batch size (one Gemini image)."))
+	int32 Txt2ImgBatchSize = 0;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI", EditConditionHides, ToolTip = "Append the CHORD template to the image prompt so the server generates the image and its PBR maps in one run. Saves the image download, re-encode and upload before CHORD. Maps are made for the first image of a batch."))
+	bool bFuseChordIntoTxt2Img = false;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI", EditConditionHides, ToolTip = "Generate Images first renders a cheap draft. Keep Draft re-renders it with the full template and the same prompt and seed; rejected drafts never cost a full render."))
+	bool bDraftFirst = false;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI && bDraftFirst", EditConditionHides, ToolTip = "Optional fast template for drafts (e.g. chord_zimage_turbo_t2i.json). Empty drafts with the regular template, reduced as below."))
+	FString DraftTxt2ImgApiPromptPath;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI && bDraftFirst", EditConditionHides))
+	FComfyTxt2ImgBinding DraftTxt2ImgBinding;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI && bDraftFirst", EditConditionHides, ClampMin = "0.1", ClampMax = "1.0", ToolTip = "Scales the latent width and height of a draft."))
+	float DraftResolutionScale = 0.5f;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::GeminiAPI && bDraftFirst", EditConditionHides, ClampMin = "0.05", ClampMax = "1.0", ToolTip = "Scales the sampler steps of a draft (at least 4 steps)."))
+	float DraftStepScale = 0.35f;
+
+	// Gemini API Settings for Text-to-Image (shown when Gemini API or Auto is selected)
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, DisplayName = "Gemini API Key", PasswordField = true, ToolTip = "Your Gemini API key from Google AI Studio."))
 	FString GeminiApiKey;
 
-	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::GeminiAPI", EditConditionHides, DisplayName = "Gemini Model", ToolTip = "Gemini model to use for image generation."))
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, DisplayName = "Gemini Model", ToolTip = "Gemini model to use for image generation."))
 	FString GeminiModel = TEXT("gemini-2.5-flash-image");
 
-	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::GeminiAPI", EditConditionHides, DisplayName = "Gemini API Endpoint", ToolTip = "Gemini API endpoint URL."))
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, DisplayName = "Gemini API Endpoint", ToolTip = "Gemini API endpoint URL."))
 	FString GeminiApiEndpoint = TEXT("https://generativelanguage.googleapis.com/v1beta/models");
 
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, ClampMin = "1", ClampMax = "32", ToolTip = "Gemini requests that may be in flight at once, across all jobs. Further requests wait their turn."))
+	int32 GeminiMaxConcurrentRequests = 4;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, ClampMin = "0", ToolTip = "Gemini requests started per minute at most; match your API key's quota so bursts wait instead of collecting HTTP 429s. 0 is unlimited."))
+	int32 GeminiRequestsPerMinute = 10;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, ClampMin = "0", ClampMax = "10", ToolTip = "Retries for a Gemini request that got no response, HTTP 429 or 5xx. Waits the delay the API asks for, otherwise backs off exponentially."))
+	int32 GeminiMaxRetries = 3;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI", EditConditionHides, ToolTip = "When a Gemini request fails, is rate-limited or takes longer than the timeout below, generate the image on ComfyUI instead."))
+	bool bFailoverGeminiToComfyUI = true;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend != ETxt2ImgBackend::ComfyUI && bFailoverGeminiToComfyUI", EditConditionHides, ClampMin = "0", ToolTip = "Seconds to wait for Gemini before failing over. 0 waits as long as the request runs."))
+	float GeminiFailoverTimeoutSeconds = 60.0f;
+
+	// Auto backend: routes each request by the latency and failures observed this session
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::Auto", EditConditionHides, ToolTip = "ComfyUI templates Auto may route to, each with the quality it stands for. Empty routes to the image template above as Standard."))
+	TArray<FChordTxt2ImgRouteTemplate> Txt2ImgRouteTemplates;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::Auto", EditConditionHides, ToolTip = "Quality Auto treats Gemini as. Gemini is only a candidate with an API key set."))
+	EChordQualityTier GeminiQuality = EChordQualityTier::Standard;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::Auto", EditConditionHides, ToolTip = "Auto never routes to a lower quality than this while a healthy option at or above it exists."))
+	EChordQualityTier MinRouteQuality = EChordQualityTier::Draft;
+
+	UPROPERTY(EditAnywhere, Config, Category = "Text-to-Image", meta = (EditCondition = "Txt2ImgBackend == ETxt2ImgBackend::Auto", EditConditionHides, ClampMin = "0", ToolTip = "With a target, Auto picks the highest quality expected to finish within it (the fastest option if none is). 0 always picks the fastest."))
+	float RouteLatencyTargetSeconds = 0.0f;
+
 	// ========== PBR Map Generation (Always uses ComfyUI) ==========
 	
 	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (DisplayName = "ComfyUI HTTP Base URL", ToolTip = "ComfyUI server address for PBR generation."))
 	FString ComfyHttpBaseUrl;
 
-	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1.0"))
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (DisplayName = "Additional ComfyUI Servers", ToolTip = "More ComfyUI servers with the same models installed. Each job goes to the least loaded one, preferring a server that last ran the same template."))
+	TArray<FString> AdditionalComfyHttpBaseUrls;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0", ToolTip = "With several servers, refuse new jobs while every server has at least this many prompts queued. 0 disables load shedding."))
+	int32 MaxQueueDepthPerServer;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0.5", ToolTip = "WebSocket connect and cheap status endpoints (/system_stats, /queue, /history). Keeps a dead server from stalling a job."))
+	float ConnectTimeoutSeconds;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1.0", ToolTip = "A single HTTP request such as a prompt submission, upload or download."))
 	float RequestTimeoutSeconds;
 
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1.0", ToolTip = "Waiting for the server to finish executing a prompt. Shared by the WebSocket wait and the history polling fallback."))
+	float ExecutionTimeoutSeconds;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0.0", ToolTip = "Overall budget for one job across upload, queueing, execution and downloads. 0 disables it."))
+	float JobTimeoutSeconds;
+
 	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation")
 	bool bUseWebSocketProgress;
 
 	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0.05"))
 	float PollingFallbackIntervalSeconds;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0", ClampMax = "10", ToolTip = "Retries for transient ComfyUI failures (no response, HTTP 429/5xx). Prompt submissions are only re-sent after confirming the server never queued them."))
+	int32 MaxRequestRetries;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0.05", ToolTip = "First retry delay; doubles on every attempt with random jitter."))
+	float RetryBaseDelaySeconds;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1", ToolTip = "Consecutive transport failures after which calls to that server fail fast until the cooldown elapses."))
+	int32 CircuitBreakerFailureThreshold;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1.0"))
+	float CircuitBreakerCooldownSeconds;
 	
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1", ClampMax = "16", ToolTip = "Jobs (image or PBR generation) that may run at once. Further jobs wait in the editor until one finishes. Background work leaves one slot for interactive requests; at 1 it only runs while nothing else does, and an interactive job may start next to it."))
+	int32 MaxConcurrentJobs;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1", ToolTip = "Background jobs are only submitted while the server has fewer than this many prompts queued, so interactive clicks never wait behind a deep batch."))
+	int32 MaxBackgroundQueueDepth;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ToolTip = "Queue CHORD for every new gallery image as a background job, so its maps are often ready before you ask. Clicking Generate PBR Maps promotes the job; deleting the image cancels it."))
+	bool bSpeculativePBRForNewImages;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ToolTip = "Upload every new gallery image to the ComfyUI server in the background, so Generate PBR Maps can queue CHORD without an upload first."))
+	bool bPreUploadSourceImages;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "1", ClampMax = "16", ToolTip = "PBR for All Images runs this many images through CHORD in one prompt, sharing a single model load. 1 queues one prompt per image."))
+	int32 MaxChordBatchSize;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0", ToolTip = "Sources are scaled down on the client until their longer side fits this before upload; the CHORD template resizes its input to 1024 anyway. Tiled sources keep their full resolution. 0 uploads the original."))
+	int32 ChordInputResolution;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0", ToolTip = "Source images larger than this are split into overlapping square tiles of this size, run through CHORD as one batched prompt and stitched back at full resolution. 0 disables tiling."))
+	int32 ChordTileSize;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0", EditCondition = "ChordTileSize > 0", ToolTip = "Pixels neighbouring tiles share. Maps are cross-faded across the overlap to hide seams."))
+	int32 ChordTileOverlap;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ToolTip = "Check that the ComfyUI server answers as soon as the tab opens."))
+	bool bProbeServerOnTabOpen;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (EditCondition = "bProbeServerOnTabOpen", ToolTip = "After a successful probe, queue tiny versions of the configured templates so the checkpoint and CHORD model are loaded before the first real job."))
+	bool bWarmUpModelsOnTabOpen;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ClampMin = "0.0", ToolTip = "Repeat the probe and warm-up every N minutes while the tab is open and idle, keeping models resident. 0 disables."))
+	float WarmUpIntervalMinutes;
+
 	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ToolTip = "CHORD image-to-PBR API prompt template path (JSON). User-provided."))
 	FString ChordImg2PbrApiPromptPath;
 
 	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation")
 	FComfyChordBinding ChordBinding;
 
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (ToolTip = "Maps to generate. Save nodes of unselected maps, and nodes only they depend on (e.g. normal-to-height), are removed before queuing and nothing is downloaded for them."))
+	FChordPBRChannelSelection ChordOutputChannels;
+
+	UPROPERTY(EditAnywhere, Config, Category = "PBR Generation", meta = (EditCondition = "bUseWebSocketProgress", ToolTip = "Swap the CHORD template's SaveImage nodes for SaveImageWebsocket so maps stream back as binary frames on the progress socket. Skips /view downloads and server-side PNG files; channels are matched by node id."))
+	bool bStreamChordOutputsOverWebSocket;
+
 	// ========== General Settings ==========
 	
 	UPROPERTY(EditAnywhere, Config, Category = "General", meta = (ToolTip = "Cache root. Allowed under Saved/ChordPBRGenerator only."))
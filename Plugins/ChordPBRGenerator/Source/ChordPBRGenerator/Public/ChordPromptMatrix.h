@@ -0,0 +1,26 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** One combination of a prompt matrix: the expanded prompt and what was picked on each axis. */
+struct FChordPromptMatrixCell
+{
+	FString Prompt;
+	// One value per {a|b} group, in the order the groups appear in the template.
+	TArray<FString> AxisValues;
+	// -1 without a seed group: the job picks a fresh seed.
+	int32 Seed = -1;
+};
+
+namespace FChordPromptMatrix
+{
+	// Expands every {a|b|c} group of the template into all combinations; one {seed:1-4,42} group adds a seed axis.
+	// Combinations that expand to the same prompt and seed are kept once. Fails on unbalanced braces, a bad seed
+	// list, or a grid larger than MaxCells.
+	bool Expand(const FString& Template, int32 MaxCells, TArray<FChordPromptMatrixCell>& OutCells, FString& OutError);
+
+	// Base label followed by the cell's axis values and seed, e.g. "IMG_2510191432_rusty-iron_worn_s3".
+	FString MakeLabel(const FString& BaseLabel, const FChordPromptMatrixCell& Cell);
+}
@@ -0,0 +1,37 @@
+// Copyright 2025 KaKAOnz. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+class FComfyUIClient;
+class UChordPBRSettings;
+
+/**
+ * Spreads jobs over the configured ComfyUI servers.
+ * Servers are ranked by live queue depth, then by whether they last ran the same template (a model swap costs
+ * more than a short wait), then by free VRAM.
+ */
+class FComfyServerPool
+{
+public:
+	static FComfyServerPool& Get();
+
+	// Primary URL first, then the additional ones, normalized and without duplicates.
+	static TArray<FString> GetServerUrls(const UChordPBRSettings& Settings);
+
+	/**
+	 * Returns a client bound to the best server for a job running TemplateKey.
+	 * Blocks on one status round-trip per server, so call it from a worker thread. With a single server the
+	 * default client is returned without probing. Fails when no server answers or every one is saturated.
+	 */
+	TSharedPtr<FComfyUIClient> AcquireClient(const TSharedRef<FComfyUIClient>& DefaultClient, const UChordPBRSettings& Settings, const FString& TemplateKey, FString& OutError);
+
+	// Records that a server accepted a prompt built from TemplateKey, so its models are now resident there.
+	void NoteTemplateQueued(const FString& BaseUrl, const FString& TemplateKey);
+
+private:
+	FCriticalSection Mutex;
+	TMap<FString, FString> LastTemplateByServer;
+};
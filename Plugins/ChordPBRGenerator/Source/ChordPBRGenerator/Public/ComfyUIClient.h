@@ -3,10 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ChordCancellationToken.h"
 #include "ChordPBRSettings.h"
 #include "Interfaces/IHttpRequest.h"
 #include "Interfaces/IHttpResponse.h"
 #include "Http.h"
+#include "Async/Future.h"
 
 class FJsonObject;
 
@@ -15,37 +17,177 @@ struct FComfyImageReference
 	FString Filename;
 	FString Subfolder;
 	FString Type;
+
+	FString GetKey() const { return FString::Printf(TEXT("%s|%s|%s"), *Type, *Subfolder, *Filename); }
+};
+
+// A node the server refused while validating a prompt.
+struct FComfyPromptNodeError
+{
+	FString NodeId;
+	FString ClassType;
+	// The input the error is about; empty when the server does not say.
+	FString InputName;
 };
 
 struct FComfyPromptResponse
 {
 	FString PromptId;
 	FString ClientId;
+	// Set when the server rejected the prompt instead of queueing it.
+	TArray<FComfyPromptNodeError> NodeErrors;
+};
+
+struct FComfyExecutionCallbacks
+{
+	// Normalized sampler progress (0..1), delivered on the game thread.
+	TFunction<void(float)> OnProgress;
+
+	// Images reported by an output node's 'executed' event, delivered as soon as that node finishes.
+	TFunction<void(const FString& /*NodeId*/, const TArray<FComfyImageReference>& /*Images*/)> OnOutputImages;
+
+	// Encoded images pushed as binary WebSocket frames (websocket save nodes, sampler previews), tagged with the
+	// node that was executing when the frame arrived. Delivered on the game thread; keep the handler cheap.
+	TFunction<void(const FString& /*NodeId*/, const TArray<uint8>& /*ImageData*/)> OnBinaryImage;
+
+	// Set when the frames above carry required outputs rather than optional previews: the job then fails
+	// instead of silently falling back to history polling when the socket is unavailable.
+	bool bBinaryImagesRequired = false;
+
+	// Called on the worker thread once the prompt is accepted by the server.
+	TFunction<void(const FComfyPromptResponse& /*Response*/)> OnQueued;
+};
+
+enum class EComfyJobPriority : uint8
+{
+	// Someone is waiting on the result: submitted to the front of the server queue.
+	Interactive,
+	// Batch or speculative work: held on the client until the server queue is shallow, then appended.
+	Background
+};
+
+struct FComfyServerLoad
+{
+	// Prompts running or waiting on the server.
+	int32 QueueDepth = 0;
+	// Summed over all devices; -1 when the server does not report it.
+	int64 VramFreeBytes = -1;
 };
 
-class FComfyUIClient
+enum class EComfyRequestFlags : uint8
+{
+	None = 0,
+	// Abort when the client's cancellation token fires.
+	Cancellable = 1 << 0,
+	// Safe to resend after a transport failure, 429 or 5xx.
+	Idempotent = 1 << 1,
+	// Cheap status endpoint: bounded by the connect timeout rather than the request timeout.
+	Quick = 1 << 2,
+	Default = Cancellable | Idempotent
+};
+ENUM_CLASS_FLAGS(EComfyRequestFlags);
+
+enum class EComfyPromptQueueState : uint8
+{
+	// Not in the server queue: finished, failed, deleted, or never accepted.
+	NotQueued,
+	Pending,
+	Running
+};
+
+class FComfyUIClient : public TSharedFromThis<FComfyUIClient>
 {
 public:
-	explicit FComfyUIClient(const UChordPBRSettings& InSettings);
+	// Blocking calls abort as soon as the token is cancelled or the job deadline (counted from construction, so create
+	// one client per job) passes. CancelPrompt and GetPromptQueueState ignore both so cleanup still runs.
+	explicit FComfyUIClient(const UChordPBRSettings& InSettings, const FChordCancellationTokenPtr& InCancellationToken = nullptr);
+
+	// Same timeouts, token and job deadline, aimed at another server.
+	TSharedRef<FComfyUIClient> WithBaseUrl(const FString& InBaseUrl) const;
+	const FString& GetBaseUrl() const { return BaseUrl; }
+	void SetJobPriority(EComfyJobPriority InPriority) { Priority = InPriority; }
+	// Once the signal fires the client behaves as Interactive; a prompt held back in admission is submitted at once.
+	void SetPromotionSignal(const FChordCancellationTokenPtr& InSignal) { PromotionSignal = InSignal; }
+	EComfyJobPriority GetJobPriority() const;
 
 	bool HealthCheck(FString& OutError) const;
-	bool QueuePrompt(const TSharedPtr<FJsonObject>& PromptObject, FComfyPromptResponse& OutResponse, FString& OutError) const;
-	bool WaitForCompletion(const FString& PromptId, const FString& ClientId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, TFunction<void(float)> OnProgress = nullptr) const;
+	bool GetServerLoad(FComfyServerLoad& OutLoad, FString& OutError) const;
+	bool QueuePromptAndWait(const TSharedPtr<FJsonObject>& PromptObject, FComfyPromptResponse& OutResponse, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, const FComfyExecutionCallbacks& Callbacks = FComfyExecutionCallbacks()) const;
+	// Picks up a prompt queued earlier, possibly by another editor session using the same ClientId. Returns the
+	// history right away if it already finished and fails if the server no longer knows it.
+	bool ReattachToPrompt(const FString& PromptId, const FString& ClientId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError, const FComfyExecutionCallbacks& Callbacks = FComfyExecutionCallbacks()) const;
 	bool GetHistory(const FString& PromptId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const;
 	bool DownloadImage(const FComfyImageReference& Ref, TArray<uint8>& OutData, FString& OutError) const;
-	bool UploadImage(const TArray<uint8>& ImageData, const FString& FileName, FComfyImageReference& OutRef, FString& OutError) const;
-	bool Cancel(FString& OutError) const;
+	// Uploads under a name derived from the content, so concurrent jobs and other artists on the same server can
+	// never replace each other's inputs and a retried upload just rewrites the same file.
+	bool UploadImage(const TArray<uint8>& ImageData, FComfyImageReference& OutRef, FString& OutError) const;
+	static FString GetUploadName(const TArray<uint8>& ImageData);
+	bool GetPromptQueueState(const FString& PromptId, EComfyPromptQueueState& OutState, FString& OutError) const;
+	// Removes the prompt from the pending queue, or interrupts it if it is the one executing. Never touches other prompts.
+	bool CancelPrompt(const FString& PromptId, FString& OutError) const;
 
 private:
-	bool ExecuteJsonRequestBlocking(const FString& Url, const FString& Verb, const FString& ContentType, const FString& Body, FHttpResponsePtr& OutResponse, FString& OutError) const;
-	bool ExecuteBinaryRequestBlocking(const FString& Url, const FString& Verb, const TArray<uint8>& Body, FHttpResponsePtr& OutResponse, FString& OutError, const FString& ContentType = TEXT("application/octet-stream")) const;
-	bool WaitOnWebSocket(const FString& PromptId, const FString& ClientId, FString& OutError, TFunction<void(float)> OnProgress = nullptr) const;
-	bool PollHistoryUntilComplete(const FString& PromptId, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const;
+	bool IsCancelled() const;
+	bool ExecuteJsonRequestBlocking(const FString& Url, const FString& Verb, const FString& ContentType, const FString& Body, FHttpResponsePtr& OutResponse, FString& OutError, EComfyRequestFlags Flags = EComfyRequestFlags::Default) const;
+	bool ExecuteBinaryRequestBlocking(const FString& Url, const FString& Verb, const TArray<uint8>& Body, FHttpResponsePtr& OutResponse, FString& OutError, const FString& ContentType = TEXT("application/octet-stream"), EComfyRequestFlags Flags = EComfyRequestFlags::Default) const;
+	bool ExecuteWithRetries(TFunctionRef<TSharedRef<IHttpRequest, ESPMode::ThreadSafe>()> MakeRequest, FHttpResponsePtr& OutResponse, FString& OutError, EComfyRequestFlags Flags) const;
+	bool ProcessRequestBlocking(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request, FHttpResponsePtr& OutResponse, FString& OutError, bool bCancellable, float TimeoutSeconds) const;
+	double MakeDeadline(float StageTimeoutSeconds) const;
+	FString DescribeTimeout(const TCHAR* Stage, float StageTimeoutSeconds) const;
+	bool WaitBeforeRetry(int32 Attempt, const FHttpResponsePtr& Response, bool bCancellable) const;
+	bool IsPromptKnownToServer(const FString& PromptId) const;
+	struct FExecutionSocket;
+
+	bool QueuePromptInternal(const TSharedPtr<FJsonObject>& PromptObject, const FString& ClientId, FComfyPromptResponse& OutResponse, FString& OutError) const;
+	bool SubmitPrompt(const TSharedPtr<FJsonObject>& PromptObject, const FString& ClientId, FComfyPromptResponse& OutResponse, FString& OutError) const;
+	TSharedPtr<FExecutionSocket, ESPMode::ThreadSafe> ConnectExecutionSocket(const FString& ClientId, const FComfyExecutionCallbacks& Callbacks, FString& OutError) const;
+	bool WaitOnExecutionSocket(const TSharedRef<FExecutionSocket, ESPMode::ThreadSafe>& Session, double Deadline, TSharedPtr<FJsonObject>& OutOutputs, FString& OutError) const;
+	bool FinishFromSocket(const TSharedRef<FExecutionSocket, ESPMode::ThreadSafe>& Session, const FString& PromptId, double Deadline, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const;
+	bool PollHistoryUntilComplete(const FString& PromptId, double Deadline, TSharedPtr<FJsonObject>& OutHistory, FString& OutError) const;
 	bool ParseImageOutputs(const TSharedPtr<FJsonObject>& History, TArray<FComfyImageReference>& OutImages) const;
 
 private:
 	FString BaseUrl;
-	float RequestTimeoutSeconds = 300.0f;
+	float ConnectTimeoutSeconds = 5.0f;
+	float RequestTimeoutSeconds = 60.0f;
+	float ExecutionTimeoutSeconds = 600.0f;
+	// Absolute FPlatformTime::Seconds() after which every stage fails; MAX_dbl when unbounded.
+	// Background jobs restart it once admitted so time spent held back does not count.
+	mutable double JobDeadline = MAX_dbl;
+	float JobTimeoutSeconds = 0.0f;
+	EComfyJobPriority Priority = EComfyJobPriority::Interactive;
+	FChordCancellationTokenPtr PromotionSignal;
+	int32 MaxBackgroundQueueDepth = 1;
 	bool bUseWebSocket = true;
 	float PollingIntervalSeconds = 0.5f;
+	int32 MaxRetries = 3;
+	float RetryBaseDelaySeconds = 0.5f;
+	int32 CircuitFailureThreshold = 5;
+	float CircuitCooldownSeconds = 15.0f;
+	FChordCancellationTokenPtr CancellationToken;
+};
+
+// Starts downloads for output images as soon as a node reports them, so transfers overlap with the rest of the graph.
+class FComfyOutputPrefetcher
+{
+public:
+	explicit FComfyOutputPrefetcher(const TSharedRef<FComfyUIClient>& InClient);
+
+	// Safe to call from any thread; images already requested are ignored.
+	void Prefetch(const TArray<FComfyImageReference>& Images);
+
+	// Returns the prefetched bytes, or downloads synchronously if the image was never prefetched.
+	bool Fetch(const FComfyImageReference& Ref, TArray<uint8>& OutData, FString& OutError);
+
+private:
+	struct FDownloadResult
+	{
+		bool bSuccess = false;
+		TArray<uint8> Data;
+		FString Error;
+	};
+
+	TSharedRef<FComfyUIClient> Client;
+	FCriticalSection Mutex;
+	TMap<FString, TFuture<TSharedPtr<FDownloadResult, ESPMode::ThreadSafe>>> Pending;
 };
@@ -8,14 +8,51 @@
 
 class FJsonObject;
 
+/** Where the pieces of a fused txt2img + CHORD prompt ended up. */
+struct FComfyFusedPromptLayout
+{
+	// Added to the CHORD template's node ids so they cannot collide with the txt2img ones.
+	int32 ChordNodeOffset = 0;
+	// txt2img SaveImage node whose image feeds CHORD; its outputs are the generated images.
+	FString ImageNodeKey;
+};
+
 namespace FComfyWorkflowUtils
 {
 	bool LoadPromptTemplate(const FString& Path, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
 
 	bool PatchTxt2ImgPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
+	// Cheap preview of the same prompt and seed: the draft template if one is set, else the regular one, with the
+	// latent size and sampler steps scaled down by the draft settings.
+	bool PatchTxt2ImgDraftPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
+	bool PatchTxt2ImgTemplate(const FString& TemplatePath, const FComfyTxt2ImgBinding& Binding, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
+	// Sets batch_size on every empty-latent node of a patched txt2img prompt. Returns false if the prompt has none.
+	bool SetTxt2ImgBatchSize(const TSharedPtr<FJsonObject>& Prompt, int32 BatchSize);
+	// Samples only image BatchIndex of the empty latent's batch, through a LatentFromBatch node, with the noise that
+	// image gets in the full batch. Returns false if the prompt has no empty-latent node.
+	bool SelectTxt2ImgBatchImage(const TSharedPtr<FJsonObject>& Prompt, int32 BatchIndex);
 
 	bool PatchChordPrompt(const UChordPBRSettings& Settings, const FComfyImageReference& UploadedImage, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
 
-	bool ExtractImagesFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TArray<FComfyImageReference>& OutImages, FString& OutError);
-	bool ExtractPBRFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TMap<FString, FComfyImageReference>& OutChannels, FString& OutError);
+	// One graph that generates the image and runs CHORD on it server-side: the CHORD template is appended to the
+	// patched txt2img template with its LoadImage node replaced by the generated image.
+	bool BuildFusedTxt2ImgChordPrompt(const UChordPBRSettings& Settings, const FString& Prompt, int32 Seed, const FString& FilenamePrefix, TSharedPtr<FJsonObject>& OutPrompt, FString& OutError);
+	// One graph that runs CHORD on every uploaded image as parallel branches sharing the model loader. Branch i's
+	// node ids are the template's plus i * OutBranchStride. Outputs are always SaveImage files, never streamed.
+	bool BuildBatchedChordPrompt(const UChordPBRSettings& Settings, const TArray<FComfyImageReference>& UploadedImages, TSharedPtr<FJsonObject>& OutPrompt, int32& OutBranchStride, FString& OutError);
+	// Layout BuildFusedTxt2ImgChordPrompt produces for the current templates, for reading its outputs back.
+	bool GetFusedPromptLayout(const UChordPBRSettings& Settings, FComfyFusedPromptLayout& OutLayout, FString& OutError);
+
+	// Shrinks a patched prompt into a cheap run that still loads every model: outputs become PreviewImage
+	// (temp files only), samplers take one step and latent images drop to 64x64.
+	void ConvertToWarmUpPrompt(const TSharedPtr<FJsonObject>& Prompt);
+
+	// OnlyNodeKey limits the search to one output node; empty takes every image output.
+	bool ExtractImagesFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TArray<FComfyImageReference>& OutImages, FString& OutError, const FString& OnlyNodeKey = FString());
+	// Maps an output node id back to its PBR channel name through the CHORD bindings.
+	bool ResolvePBRChannelForNode(const UChordPBRSettings& Settings, const FString& NodeId, FString& OutChannelName);
+	// NodeIdOffset shifts the bound channel node ids, for CHORD graphs embedded in a fused or batched prompt.
+	// A positive NodeIdRange ignores outputs of nodes outside [NodeIdOffset, NodeIdOffset + NodeIdRange).
+	// Only channels enabled in ChordOutputChannels are required and returned.
+	bool ExtractPBRFromHistory(const UChordPBRSettings& Settings, const TSharedPtr<FJsonObject>& History, TMap<FString, FComfyImageReference>& OutChannels, FString& OutError, int32 NodeIdOffset = 0, int32 NodeIdRange = 0);
 }
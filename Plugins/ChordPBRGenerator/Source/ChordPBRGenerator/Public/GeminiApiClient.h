@@ -3,40 +3,90 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ChordCancellationToken.h"
+#include "HAL/CriticalSection.h"
+
+class IHttpRequest;
+class IHttpResponse;
+class UChordPBRSettings;
 
 DECLARE_DELEGATE_TwoParams(FOnGeminiImageGenerated, UTexture2D* /*GeneratedTexture*/, const FString& /*Error*/);
 
+using FGeminiRequestHandle = uint64;
+
 /**
- * Client for Gemini API image generation
+ * Shared client for Gemini API image generation.
+ * Requests run in parallel, up to GeminiMaxConcurrentRequests at once and GeminiRequestsPerMinute started per
+ * minute; the rest wait in submission order. HTTP 429 and 5xx are retried with backoff, and a 429 holds back
+ * every request until the delay the API asked for has passed. Thread-safe.
  */
-class FGeminiApiClient : public TSharedFromThis<FGeminiApiClient>
+class FGeminiApiClient
 {
 public:
-	FGeminiApiClient() = default;
-	~FGeminiApiClient() = default;
+	static FGeminiApiClient& Get();
 
 	/**
-	 * Generate an image from a text prompt using Gemini API
-	 * @param ApiEndpoint The Gemini API endpoint URL
-	 * @param ApiKey The Gemini API key
-	 * @param Model The Gemini model name (e.g., gemini-2.5-flash-image)
+	 * Queue an image generation for a text prompt
+	 * @param Settings Endpoint, key and model of the request; the limits of the latest request apply to all
 	 * @param Prompt The text prompt for image generation
-	 * @param OnComplete Callback when generation completes
+	 * @param OnComplete Runs once on the game thread, also when the request is cancelled
+	 * @param CancellationToken Optional token that cancels the request
+	 * @param TimeoutSeconds Fails an attempt that has not answered this long after it was sent, without retrying.
+	 *        Time spent waiting for the rate budget does not count. 0 waits as long as the request runs.
+	 * @return Handle for CancelRequest
 	 */
-	void GenerateImageAsync(
-		const FString& ApiEndpoint,
-		const FString& ApiKey,
-		const FString& Model,
+	FGeminiRequestHandle GenerateImageAsync(
+		const UChordPBRSettings& Settings,
 		const FString& Prompt,
-		FOnGeminiImageGenerated OnComplete);
+		FOnGeminiImageGenerated OnComplete,
+		const FChordCancellationTokenPtr& CancellationToken = nullptr,
+		float TimeoutSeconds = 0.0f);
 
-	/** Cancel any pending request */
-	void CancelRequest();
-
-	/** Check if a request is in progress */
-	bool IsRequestInProgress() const { return bIsRequestInProgress; }
+	/** Cancel a queued or running request; its completion reports "Cancelled." */
+	void CancelRequest(FGeminiRequestHandle Handle);
 
 private:
-	bool bIsRequestInProgress = false;
-	TSharedPtr<class IHttpRequest, ESPMode::ThreadSafe> PendingRequest;
+	struct FRequest
+	{
+		FGeminiRequestHandle Handle = 0;
+		FString Url;
+		FString ApiKey;
+		FString Body;
+		FOnGeminiImageGenerated OnComplete;
+		FChordCancellationTokenPtr CancellationToken;
+		FChordCancellationToken::FCallbackHandle CancelHook = 0;
+		int32 Attempt = 0;
+		// A retry waits until then.
+		double NotBefore = 0.0;
+		float TimeoutSeconds = 0.0f;
+		bool bCancelled = false;
+		bool bTimedOut = false;
+		TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+	};
+	using FRequestRef = TSharedRef<FRequest, ESPMode::ThreadSafe>;
+
+	FGeminiApiClient() = default;
+
+	// Starts whatever the concurrency and per-minute budget allow, and schedules a wake-up for the rest.
+	void Pump();
+	void StartRequest(const FRequestRef& Request);
+	// Aborts the given attempt of a running request if it is still the current one.
+	void TimeOutRequest(FGeminiRequestHandle Handle, int32 Attempt);
+	void HandleResponse(const FRequestRef& Request, const TSharedPtr<IHttpResponse, ESPMode::ThreadSafe>& Response, bool bSucceeded);
+	void Finish(const FRequestRef& Request, TArray<uint8>&& ImageData, const FString& Error);
+	float GetRetryDelaySeconds(int32 Attempt, const TSharedPtr<IHttpResponse, ESPMode::ThreadSafe>& Response) const;
+
+	mutable FCriticalSection Mutex;
+	TArray<FRequestRef> Waiting;
+	TMap<FGeminiRequestHandle, FRequestRef> Running;
+	// Start times within the last minute, oldest first.
+	TArray<double> RecentStarts;
+	// Set by a 429: nothing new starts before then.
+	double PausedUntil = 0.0;
+	double ScheduledWakeAt = 0.0;
+	FGeminiRequestHandle NextHandle = 1;
+
+	int32 MaxConcurrentRequests = 4;
+	int32 RequestsPerMinute = 0;
+	int32 MaxRetries = 3;
 };